@@ -0,0 +1,193 @@
+#include "AccelerationStructure.h"
+
+const char * AccelerationStructure::GetTypeName(Type type) {
+	switch (type) {
+	case Type::BVH:
+		return "BVH";
+	case Type::WIDE_BVH:
+		return "Wide BVH";
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return "Wide BVH (8 bit)";
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return "Wide BVH (16 bit)";
+	case Type::OCTREE:
+		return "Octree";
+	default:
+		return "Linear";
+	}
+}
+
+const char * AccelerationStructure::GetBuildQualityName(BVH::BuildQuality quality) {
+	switch (quality) {
+	case BVH::BuildQuality::PREVIEW:
+		return "Preview (LBVH)";
+	case BVH::BuildQuality::FINAL:
+		return "Final (full SAH)";
+	default:
+		return "Standard (binned SAH)";
+	}
+}
+
+void AccelerationStructure::Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & _items) {
+	// Only keep the data of the used backend.
+	items.clear();
+	bvh = BVH();
+	wideBVH = WideBVH();
+	quantizedWideBVH8 = QuantizedWideBVH<unsigned char>();
+	quantizedWideBVH16 = QuantizedWideBVH<unsigned short>();
+	octree = Octree();
+	statistics = BVH::Statistics();
+
+	if (settings.type == Type::LINEAR) {
+		items = _items;
+		return;
+	}
+	if (settings.type == Type::OCTREE) {
+		octree.Build(itemAABBs, _items, settings.octreeMaxDepth, settings.octreeMaxLeafSize);
+		UpdateStatistics();
+		return;
+	}
+
+	// Every hierarchy starts out as a binary BVH.
+	bvh.Build(itemAABBs, _items, settings.buildQuality);
+	if (settings.type != Type::BVH) {
+		CollapseBVH();
+		bvh = BVH();
+	}
+	UpdateStatistics();
+}
+
+void AccelerationStructure::Refit(const std::vector<AABB> & itemAABBs) {
+	switch (settings.type) {
+	case Type::LINEAR:
+		return; // The items are tested anyway.
+	case Type::OCTREE: {
+		// Moved items may belong in other nodes, and building an octree is cheap anyway.
+		const std::vector<unsigned int> octreeItems = octree.itemIndices;
+		octree.Build(itemAABBs, octreeItems, settings.octreeMaxDepth, settings.octreeMaxLeafSize);
+		UpdateStatistics();
+		return;
+	}
+	case Type::BVH:
+		bvh.Refit(itemAABBs, settings.buildQuality);
+		break;
+	case Type::WIDE_BVH:
+		if (bvh.nodes.empty()) {
+			bvh.Build(itemAABBs, wideBVH.itemIndices, settings.buildQuality);
+		}
+		else {
+			bvh.Refit(itemAABBs, settings.buildQuality);
+		}
+		CollapseBVH();
+		break;
+	case Type::QUANTIZED_WIDE_BVH_8:
+		if (bvh.nodes.empty()) {
+			bvh.Build(itemAABBs, quantizedWideBVH8.itemIndices, settings.buildQuality);
+		}
+		else {
+			bvh.Refit(itemAABBs, settings.buildQuality);
+		}
+		CollapseBVH();
+		break;
+	case Type::QUANTIZED_WIDE_BVH_16:
+		if (bvh.nodes.empty()) {
+			bvh.Build(itemAABBs, quantizedWideBVH16.itemIndices, settings.buildQuality);
+		}
+		else {
+			bvh.Refit(itemAABBs, settings.buildQuality);
+		}
+		CollapseBVH();
+		break;
+	}
+	UpdateStatistics();
+}
+
+void AccelerationStructure::UpdateStatistics() {
+	switch (settings.type) {
+	case Type::BVH:
+		statistics = bvh.GetStatistics();
+		break;
+	case Type::WIDE_BVH:
+		statistics = wideBVH.GetStatistics();
+		break;
+	case Type::QUANTIZED_WIDE_BVH_8:
+		statistics = quantizedWideBVH8.GetStatistics();
+		break;
+	case Type::QUANTIZED_WIDE_BVH_16:
+		statistics = quantizedWideBVH16.GetStatistics();
+		break;
+	case Type::OCTREE:
+		statistics = octree.GetStatistics();
+		break;
+	default:
+		statistics = BVH::Statistics();
+		break;
+	}
+}
+
+void AccelerationStructure::CollapseBVH() {
+	switch (settings.type) {
+	case Type::WIDE_BVH:
+		wideBVH.Build(bvh);
+		break;
+	case Type::QUANTIZED_WIDE_BVH_8:
+		quantizedWideBVH8.Build(bvh);
+		break;
+	case Type::QUANTIZED_WIDE_BVH_16:
+		quantizedWideBVH16.Build(bvh);
+		break;
+	default:
+		break;
+	}
+}
+
+bool AccelerationStructure::IsEmpty() const {
+	switch (settings.type) {
+	case Type::BVH:
+		return bvh.nodes.empty();
+	case Type::WIDE_BVH:
+		return wideBVH.itemIndices.empty();
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return quantizedWideBVH8.itemIndices.empty();
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return quantizedWideBVH16.itemIndices.empty();
+	case Type::OCTREE:
+		return octree.nodes.empty();
+	default:
+		return items.empty();
+	}
+}
+
+const std::vector<unsigned int> & AccelerationStructure::GetItemIndices() const {
+	switch (settings.type) {
+	case Type::BVH:
+		return bvh.itemIndices;
+	case Type::WIDE_BVH:
+		return wideBVH.itemIndices;
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return quantizedWideBVH8.itemIndices;
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return quantizedWideBVH16.itemIndices;
+	case Type::OCTREE:
+		return octree.itemIndices;
+	default:
+		return items;
+	}
+}
+
+size_t AccelerationStructure::GetMemoryUsage() const {
+	switch (settings.type) {
+	case Type::BVH:
+		return bvh.GetMemoryUsage();
+	case Type::WIDE_BVH:
+		return wideBVH.GetMemoryUsage() + bvh.GetMemoryUsage();
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return quantizedWideBVH8.GetMemoryUsage() + bvh.GetMemoryUsage();
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return quantizedWideBVH16.GetMemoryUsage() + bvh.GetMemoryUsage();
+	case Type::OCTREE:
+		return octree.GetMemoryUsage();
+	default:
+		return items.size() * sizeof(unsigned int);
+	}
+}
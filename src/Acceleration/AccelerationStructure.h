@@ -0,0 +1,212 @@
+#pragma once
+
+#include <vector>
+#include <cassert>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "../Geometry/RayPacket.h"
+#include "BVH.h"
+#include "WideBVH.h"
+#include "QuantizedWideBVH.h"
+#include "Octree.h"
+
+/// <summary>
+/// Ray casting acceleration over a set of items described by their AABBs. Wraps the available
+/// backends so that they can be swapped (and benchmarked against each other) without touching the callers.
+/// </summary>
+class AccelerationStructure {
+public:
+	/// <summary> The available backends. </summary>
+	enum class Type {
+		/// <summary> No acceleration: every item is tested. </summary>
+		LINEAR,
+		/// <summary> Binary SAH bounding volume hierarchy. </summary>
+		BVH,
+		/// <summary> 4-ary bounding volume hierarchy with SSE node tests. </summary>
+		WIDE_BVH,
+		/// <summary> 4-ary bounding volume hierarchy with child AABBs quantized to 8 bits. </summary>
+		QUANTIZED_WIDE_BVH_8,
+		/// <summary> 4-ary bounding volume hierarchy with child AABBs quantized to 16 bits. </summary>
+		QUANTIZED_WIDE_BVH_16,
+		/// <summary> Loose octree. </summary>
+		OCTREE
+	};
+
+	/// <summary> Selects and configures the backend. </summary>
+	struct Settings {
+		/// <summary> The backend which is used. </summary>
+		Type type = Type::BVH;
+
+		/// <summary> The algorithm used to build the hierarchy (BVH backends only). </summary>
+		BVH::BuildQuality buildQuality = BVH::BuildQuality::STANDARD;
+
+		/// <summary> Octree nodes at this depth are never subdivided (the root has depth 0). At most Octree::MAX_DEPTH. </summary>
+		unsigned int octreeMaxDepth = Octree::DEFAULT_MAX_DEPTH;
+
+		/// <summary> Octree nodes with more items than this are subdivided. </summary>
+		unsigned int octreeMaxLeafSize = Octree::DEFAULT_MAX_LEAF_SIZE;
+	};
+
+	/// <summary> Returns a human readable name of a backend. </summary>
+	static const char * GetTypeName(Type type);
+
+	/// <summary> Returns a human readable name of a build quality. </summary>
+	static const char * GetBuildQualityName(BVH::BuildQuality quality);
+
+	/// <summary> The backend which is used and its configuration. Call Build after changing this. </summary>
+	Settings settings;
+
+	/// <summary> Builds the structure over a subset of the given items. </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The item index is the index in this vector. </param>
+	/// <param name='items'> The indices of the items which should be added to the structure. </param>
+	void Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & items);
+
+	/// <summary>
+	/// Updates the structure after the AABBs of its items have changed. See BVH::Refit. The wide backends are collapsed
+	/// from a binary hierarchy which is normally thrown away, so their first refit is a full build which keeps the binary
+	/// hierarchy. Later refits update the binary hierarchy and collapse it again. The octree is rebuilt.
+	/// </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The items are the same as in the last call to Build. </param>
+	void Refit(const std::vector<AABB> & itemAABBs);
+
+	/// <summary> Returns true if the structure contains no items. </summary>
+	bool IsEmpty() const;
+
+	/// <summary> Returns the number of bytes used by the structure (nodes and item indices, including a kept binary hierarchy). </summary>
+	size_t GetMemoryUsage() const;
+
+	/// <summary>
+	/// Returns the shape of the structure which is traversed: the binary or wide hierarchy (see
+	/// WideBVHTraversal::GetStatistics) or the octree. Everything is 0 for the LINEAR backend.
+	/// </summary>
+	const BVH::Statistics & GetStatistics() const { return statistics; }
+
+	/// <summary>
+	/// Calls intersectItem for the items which the ray might intersect (front to back when possible).
+	/// See BVH::RayCast.
+	/// </summary>
+	template<typename IntersectItem>
+	bool RayCast(Ray & ray, IntersectItem intersectItem) const;
+
+	/// <summary>
+	/// Calls intersectItem for the items which the ray might intersect until it returns true.
+	/// See BVH::AnyHit.
+	/// </summary>
+	template<typename IntersectItem>
+	bool AnyHit(const Ray & ray, IntersectItem intersectItem) const;
+
+	/// <summary>
+	/// Returns the item indices in the order used by the backend. Every leaf visited by RayCastLeaves and AnyHitLeaves
+	/// is a contiguous range in this vector. The order changes when the structure is built or refit.
+	/// </summary>
+	const std::vector<unsigned int> & GetItemIndices() const;
+
+	/// <summary>
+	/// Same as RayCast, but intersectLeaf is called once for every visited leaf (see BVH::RayCast), so that the items
+	/// of a leaf can be tested together. The leaf ranges refer to GetItemIndices.
+	/// </summary>
+	template<typename IntersectLeaf>
+	bool RayCastLeaves(Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary> Same as AnyHit, but intersectLeaf is called once for every visited leaf (see BVH::AnyHit). </summary>
+	template<typename IntersectLeaf>
+	bool AnyHitLeaves(const Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary> Returns true if the backend can cast ray packets (currently only the BVH backend). </summary>
+	bool SupportsRayPackets() const { return settings.type == Type::BVH; }
+
+	/// <summary>
+	/// Casts a packet of rays, calling intersectLeaf for every visited leaf together with the rays which entered it
+	/// (see BVH::RayCastPacket). The hierarchy is walked once for the whole packet. Requires SupportsRayPackets().
+	/// </summary>
+	template<typename IntersectLeaf>
+	void RayCastPacket(RayPacket & packet, RayPacket::Mask mask, IntersectLeaf intersectLeaf) const;
+
+private:
+	/// <summary> The items of the linear backend. </summary>
+	std::vector<unsigned int> items;
+
+	/// <summary> The BVH backend, or the binary hierarchy of a wide backend if it has been refit. </summary>
+	BVH bvh;
+	WideBVH wideBVH;
+	QuantizedWideBVH<unsigned char> quantizedWideBVH8;
+	QuantizedWideBVH<unsigned short> quantizedWideBVH16;
+	Octree octree;
+	BVH::Statistics statistics;
+
+	/// <summary> Collapses bvh into the used wide backend. </summary>
+	void CollapseBVH();
+
+	/// <summary> Sets statistics from the used backend. </summary>
+	void UpdateStatistics();
+};
+
+template<typename IntersectLeaf>
+bool AccelerationStructure::RayCastLeaves(Ray & ray, IntersectLeaf intersectLeaf) const {
+	switch (settings.type) {
+	case Type::BVH:
+		return bvh.RayCast(ray, intersectLeaf);
+	case Type::WIDE_BVH:
+		return wideBVH.RayCast(ray, intersectLeaf);
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return quantizedWideBVH8.RayCast(ray, intersectLeaf);
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return quantizedWideBVH16.RayCast(ray, intersectLeaf);
+	case Type::OCTREE:
+		return octree.RayCast(ray, intersectLeaf);
+	default:
+		return !items.empty() && intersectLeaf(0, static_cast<unsigned int>(items.size()), ray);
+	}
+}
+
+template<typename IntersectLeaf>
+bool AccelerationStructure::AnyHitLeaves(const Ray & ray, IntersectLeaf intersectLeaf) const {
+	switch (settings.type) {
+	case Type::BVH:
+		return bvh.AnyHit(ray, intersectLeaf);
+	case Type::WIDE_BVH:
+		return wideBVH.AnyHit(ray, intersectLeaf);
+	case Type::QUANTIZED_WIDE_BVH_8:
+		return quantizedWideBVH8.AnyHit(ray, intersectLeaf);
+	case Type::QUANTIZED_WIDE_BVH_16:
+		return quantizedWideBVH16.AnyHit(ray, intersectLeaf);
+	case Type::OCTREE:
+		return octree.AnyHit(ray, intersectLeaf);
+	default:
+		return !items.empty() && intersectLeaf(0, static_cast<unsigned int>(items.size()));
+	}
+}
+
+template<typename IntersectItem>
+bool AccelerationStructure::RayCast(Ray & ray, IntersectItem intersectItem) const {
+	const std::vector<unsigned int> & itemIndices = GetItemIndices();
+	return RayCastLeaves(ray, [&](unsigned int offset, unsigned int count, Ray & currentRay) {
+		bool intersectionFound = false;
+		for (unsigned int i = offset; i < offset + count; ++i) {
+			if (intersectItem(itemIndices[i], currentRay)) {
+				intersectionFound = true;
+			}
+		}
+		return intersectionFound;
+	});
+}
+
+template<typename IntersectItem>
+bool AccelerationStructure::AnyHit(const Ray & ray, IntersectItem intersectItem) const {
+	const std::vector<unsigned int> & itemIndices = GetItemIndices();
+	return AnyHitLeaves(ray, [&](unsigned int offset, unsigned int count) {
+		for (unsigned int i = offset; i < offset + count; ++i) {
+			if (intersectItem(itemIndices[i])) {
+				return true;
+			}
+		}
+		return false;
+	});
+}
+
+template<typename IntersectLeaf>
+void AccelerationStructure::RayCastPacket(RayPacket & packet, RayPacket::Mask mask, IntersectLeaf intersectLeaf) const {
+	assert(SupportsRayPackets());
+	bvh.RayCastPacket(packet, mask, intersectLeaf);
+}
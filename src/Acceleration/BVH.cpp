@@ -0,0 +1,640 @@
+#include "BVH.h"
+
+#include <numeric>
+#include <cassert>
+#include <future>
+#include <thread>
+#include <utility>
+
+namespace {
+	// Relative costs used by the surface area heuristic.
+	const float TRAVERSAL_COST = 1.0f;
+	const float INTERSECTION_COST = 1.0f;
+
+	// The number of candidate split planes per axis is BIN_COUNT - 1 for the binned SAH.
+	const unsigned int BIN_COUNT = 32;
+
+	// Ranges this small are split using the full sweep even with binning, since it is just as cheap.
+	const unsigned int SWEEP_THRESHOLD = 2 * BIN_COUNT;
+
+	// Subtrees with at least this many items are built on a separate thread.
+	const unsigned int PARALLEL_SUBTREE_THRESHOLD = 4096;
+
+	// Ranges with at least this many items are binned and partitioned by all threads.
+	const unsigned int PARALLEL_RANGE_THRESHOLD = 65536;
+
+	// The number of bits per axis in a Morton code.
+	const unsigned int MORTON_BITS = 10;
+
+	/// <summary> Spreads out the lowest 10 bits so that there are two zero bits between every bit. </summary>
+	unsigned int ExpandBits(unsigned int value) {
+		value = (value * 0x00010001u) & 0xFF0000FFu;
+		value = (value * 0x00000101u) & 0x0F00F00Fu;
+		value = (value * 0x00000011u) & 0xC30C30C3u;
+		value = (value * 0x00000005u) & 0x49249249u;
+		return value;
+	}
+
+	/// <summary> Returns the index of the highest set bit. </summary>
+	unsigned int HighestBit(unsigned int value) {
+		unsigned int bit = 0;
+		while (value >>= 1) {
+			++bit;
+		}
+		return bit;
+	}
+
+	/// <summary> Builds BVH nodes over ranges of itemIndices using the algorithm of the given quality. </summary>
+	class Builder {
+	public:
+		Builder(const std::vector<AABB> & itemAABBs, std::vector<unsigned int> & itemIndices, BVH::BuildQuality quality);
+
+		/// <summary>
+		/// Builds a subtree over itemIndices[begin, end) and appends it to nodes. Only that range of itemIndices is reordered.
+		/// The depth of the subtree root is used to limit the depth of the subtree.
+		/// </summary>
+		void Build(std::vector<BVH::Node> & nodes, unsigned int begin, unsigned int end, unsigned int depth);
+
+	private:
+		/// <summary> A candidate split. Position is the number of items to the left (sweep) or the first bin to the right (binned). </summary>
+		struct Split {
+			float cost = FLT_MAX;
+			unsigned int axis = 0, position = 0;
+		};
+
+		struct Bin {
+			AABB bounds = AABB(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			unsigned int count = 0;
+		};
+
+		/// <summary> The bins of every axis. </summary>
+		struct Bins {
+			Bin bins[3][BIN_COUNT];
+
+			void Merge(const Bins & other);
+		};
+
+		/// <summary> 
+		/// Calculates the bounds of the items in itemIndices[begin, end) and the bounds of their centers.
+		/// Chunks is the number of parts the range is split into (see GetChunkCount), here and below.
+		/// </summary>
+		void CalculateBounds(unsigned int begin, unsigned int end, unsigned int chunks, AABB & bounds, AABB & centerBounds) const;
+
+		/// <summary> Finds the best split by sweeping over the items sorted along every axis. </summary>
+		Split FindSweepSplit(unsigned int begin, unsigned int end, const AABB & bounds, const AABB & centerBounds) const;
+
+		/// <summary> Finds the best split between BIN_COUNT bins of equal width along every axis. </summary>
+		Split FindBinnedSplit(unsigned int begin, unsigned int end, unsigned int chunks, const AABB & bounds, const AABB & centerBounds) const;
+
+		/// <summary> Sorts itemIndices[begin, end) along a Morton curve through the bounds of the item centers, and stores the Morton codes. </summary>
+		void SortAlongMortonCurve(unsigned int begin, unsigned int end, unsigned int chunks);
+
+		/// <summary> Finds the highest bit in which the Morton codes of the range differ and splits there. </summary>
+		unsigned int FindMortonSplit(unsigned int begin, unsigned int end) const;
+
+		/// <summary> Moves the items of bins below split.position to the front. Returns the index of the first item in the right part. </summary>
+		unsigned int PartitionBinned(unsigned int begin, unsigned int end, unsigned int chunks, const AABB & centerBounds, const Split & split) const;
+
+		/// <summary>
+		/// Recursively builds the subtree over itemIndices[begin, end) and appends it to nodes.
+		/// Returns the index of the subtree root.
+		/// </summary>
+		unsigned int BuildRecursive(std::vector<BVH::Node> & nodes, unsigned int begin, unsigned int end, unsigned int depth) const;
+
+		/// <summary> Returns the bin of the given center along an axis. </summary>
+		static unsigned int GetBin(const glm::vec3 & center, const AABB & centerBounds, unsigned int axis);
+
+		/// <summary> 
+		/// Returns the number of parts to split [begin, end) of a node at the given depth into, one per thread. The subtrees
+		/// above maxParallelDepth are built on threads of their own, so the node gets its share of the threads.
+		/// </summary>
+		unsigned int GetChunkCount(unsigned int begin, unsigned int end, unsigned int depth) const {
+			if (end - begin < PARALLEL_RANGE_THRESHOLD) {
+				return 1;
+			}
+			const unsigned int parallelDepth = glm::min(depth, maxParallelDepth) - glm::min(rootDepth, maxParallelDepth);
+			return glm::max<unsigned int>(chunkCount >> parallelDepth, 1);
+		}
+
+		/// <summary> Calls function(chunkBegin, chunkEnd, chunk) for every one of the given number of parts of [begin, end) in parallel. </summary>
+		template<typename Function>
+		void ParallelFor(unsigned int begin, unsigned int end, unsigned int chunks, Function function) const;
+
+		const std::vector<AABB> & itemAABBs;
+		std::vector<unsigned int> & itemIndices;
+		const BVH::BuildQuality quality;
+
+		std::vector<glm::vec3> centers;
+
+		/// <summary> The Morton codes of the items in the range which is built (same order). Only used by the PREVIEW quality. </summary>
+		std::vector<unsigned int> mortonCodes;
+
+		/// <summary> The first index of the range which is built, i.e. the index in itemIndices of mortonCodes[0]. </summary>
+		unsigned int rangeBegin;
+
+		/// <summary> The depth of the root of the subtree which is built. </summary>
+		unsigned int rootDepth;
+
+		/// <summary> The number of threads used for ranges of at least PARALLEL_RANGE_THRESHOLD items at the subtree root. </summary>
+		unsigned int chunkCount;
+
+		/// <summary> Subtrees are only built on separate threads above this depth to avoid spawning too many threads. </summary>
+		unsigned int maxParallelDepth;
+	};
+
+	Builder::Builder(const std::vector<AABB> & _itemAABBs, std::vector<unsigned int> & _itemIndices, BVH::BuildQuality _quality) :
+		itemAABBs(_itemAABBs), itemIndices(_itemIndices), quality(_quality), centers(_itemAABBs.size()), rangeBegin(0), rootDepth(0) {
+		chunkCount = glm::max<unsigned int>(std::thread::hardware_concurrency(), 1);
+		maxParallelDepth = HighestBit(chunkCount) + 2;
+	}
+
+	void Builder::Build(std::vector<BVH::Node> & nodes, unsigned int begin, unsigned int end, unsigned int depth) {
+		rootDepth = depth;
+
+		// Precompute the item centers since they are used for sorting.
+		const int itemCount = static_cast<int>(end - begin);
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < itemCount; ++i) {
+			centers[itemIndices[begin + i]] = itemAABBs[itemIndices[begin + i]].GetCenter();
+		}
+
+		if (quality == BVH::BuildQuality::PREVIEW) {
+			SortAlongMortonCurve(begin, end, GetChunkCount(begin, end, depth));
+		}
+		BuildRecursive(nodes, begin, end, depth);
+	}
+
+	void Builder::SortAlongMortonCurve(unsigned int begin, unsigned int end, unsigned int chunks) {
+		AABB bounds, centerBounds;
+		CalculateBounds(begin, end, chunks, bounds, centerBounds);
+		const glm::vec3 extent = centerBounds.maximum - centerBounds.minimum;
+		const float maxCoordinate = static_cast<float>((1 << MORTON_BITS) - 1);
+		const int itemCount = static_cast<int>(end - begin);
+		std::vector<std::pair<unsigned int, unsigned int>> sortedItems(itemCount);
+#pragma omp parallel for schedule(static)
+		for (int i = 0; i < itemCount; ++i) {
+			unsigned int code = 0;
+			for (unsigned int axis = 0; axis < 3; ++axis) {
+				const float relative = extent[axis] > 0.0f ? (centers[itemIndices[begin + i]][axis] - centerBounds.minimum[axis]) / extent[axis] : 0.0f;
+				code |= ExpandBits(static_cast<unsigned int>(glm::clamp(relative * maxCoordinate, 0.0f, maxCoordinate))) << (2 - axis);
+			}
+			sortedItems[i] = std::make_pair(code, itemIndices[begin + i]);
+		}
+		std::sort(sortedItems.begin(), sortedItems.end());
+
+		rangeBegin = begin;
+		mortonCodes.resize(itemCount);
+		for (int i = 0; i < itemCount; ++i) {
+			mortonCodes[i] = sortedItems[i].first;
+			itemIndices[begin + i] = sortedItems[i].second;
+		}
+	}
+
+	unsigned int Builder::BuildRecursive(std::vector<BVH::Node> & nodes, unsigned int begin, unsigned int end, unsigned int depth) const {
+		assert(begin < end);
+		const unsigned int nodeIndex = static_cast<unsigned int>(nodes.size());
+		nodes.push_back(BVH::Node());
+
+		const unsigned int chunks = GetChunkCount(begin, end, depth);
+		AABB bounds, centerBounds;
+		CalculateBounds(begin, end, chunks, bounds, centerBounds);
+		nodes[nodeIndex].axisAlignedBoundingBox = bounds;
+
+		const unsigned int count = end - begin;
+		const glm::vec3 centerExtent = centerBounds.maximum - centerBounds.minimum;
+		const bool splittable = centerExtent.x > 0.0f || centerExtent.y > 0.0f || centerExtent.z > 0.0f;
+		if (count == 1 || !splittable || depth + 1 >= BVH::MAX_DEPTH ||
+			(quality == BVH::BuildQuality::PREVIEW && count <= BVH::MAX_LEAF_SIZE)) {
+			nodes[nodeIndex].offset = begin;
+			nodes[nodeIndex].count = count;
+			return nodeIndex;
+		}
+
+		unsigned int middle;
+		if (quality == BVH::BuildQuality::PREVIEW) {
+			// The items are already sorted, so the split is all there is to it.
+			middle = FindMortonSplit(begin, end);
+		}
+		else {
+			const bool sweep = quality == BVH::BuildQuality::FINAL || count <= SWEEP_THRESHOLD;
+			const Split split = sweep ? FindSweepSplit(begin, end, bounds, centerBounds) : FindBinnedSplit(begin, end, chunks, bounds, centerBounds);
+
+			// Create a leaf if splitting is not worth it.
+			if (count <= BVH::MAX_LEAF_SIZE && split.cost >= INTERSECTION_COST * count) {
+				nodes[nodeIndex].offset = begin;
+				nodes[nodeIndex].count = count;
+				return nodeIndex;
+			}
+
+			// Partition the items along the best axis.
+			if (sweep) {
+				middle = begin + split.position;
+				std::nth_element(itemIndices.begin() + begin, itemIndices.begin() + middle, itemIndices.begin() + end, [&](unsigned int a, unsigned int b) {
+					return centers[a][split.axis] < centers[b][split.axis];
+				});
+			}
+			else {
+				middle = PartitionBinned(begin, end, chunks, centerBounds, split);
+			}
+		}
+		assert(begin < middle && middle < end);
+
+		// Build children. The first child is always placed directly after its parent.
+		unsigned int secondChild;
+		if (count >= PARALLEL_SUBTREE_THRESHOLD && depth < maxParallelDepth) {
+			// Build the second child on another thread into a separate array, and append it once both children are done.
+			std::vector<BVH::Node> secondChildNodes;
+			secondChildNodes.reserve(2 * (end - middle));
+			auto secondChildBuild = std::async(std::launch::async, [&]() {
+				BuildRecursive(secondChildNodes, middle, end, depth + 1);
+			});
+			BuildRecursive(nodes, begin, middle, depth + 1);
+			secondChildBuild.get();
+
+			secondChild = static_cast<unsigned int>(nodes.size());
+			for (BVH::Node & node : secondChildNodes) {
+				if (!node.IsLeaf()) {
+					node.offset += secondChild;
+				}
+			}
+			nodes.insert(nodes.end(), secondChildNodes.begin(), secondChildNodes.end());
+		}
+		else {
+			BuildRecursive(nodes, begin, middle, depth + 1);
+			secondChild = BuildRecursive(nodes, middle, end, depth + 1);
+		}
+		nodes[nodeIndex].offset = secondChild;
+		nodes[nodeIndex].count = 0;
+		return nodeIndex;
+	}
+
+	void Builder::Bins::Merge(const Bins & other) {
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			for (unsigned int i = 0; i < BIN_COUNT; ++i) {
+				bins[axis][i].bounds.Expand(other.bins[axis][i].bounds);
+				bins[axis][i].count += other.bins[axis][i].count;
+			}
+		}
+	}
+
+	void Builder::CalculateBounds(unsigned int begin, unsigned int end, unsigned int chunks, AABB & bounds, AABB & centerBounds) const {
+		std::vector<AABB> chunkBounds(chunks, AABB(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)));
+		std::vector<AABB> chunkCenterBounds(chunkBounds);
+		ParallelFor(begin, end, chunks, [&](unsigned int chunkBegin, unsigned int chunkEnd, unsigned int chunk) {
+			for (unsigned int i = chunkBegin; i < chunkEnd; ++i) {
+				chunkBounds[chunk].Expand(itemAABBs[itemIndices[i]]);
+				chunkCenterBounds[chunk].Expand(centers[itemIndices[i]]);
+			}
+		});
+
+		bounds = chunkBounds[0];
+		centerBounds = chunkCenterBounds[0];
+		for (unsigned int chunk = 1; chunk < chunks; ++chunk) {
+			bounds.Expand(chunkBounds[chunk]);
+			centerBounds.Expand(chunkCenterBounds[chunk]);
+		}
+	}
+
+	Builder::Split Builder::FindSweepSplit(unsigned int begin, unsigned int end, const AABB & bounds, const AABB & centerBounds) const {
+		const unsigned int count = end - begin;
+		const glm::vec3 centerExtent = centerBounds.maximum - centerBounds.minimum;
+		const float inverseArea = 1.0f / glm::max<float>(bounds.GetSurfaceArea(), FLT_EPSILON);
+		std::vector<float> rightAreas(count);
+		Split best;
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			if (centerExtent[axis] <= 0.0f) {
+				continue;
+			}
+			std::sort(itemIndices.begin() + begin, itemIndices.begin() + end, [&](unsigned int a, unsigned int b) {
+				return centers[a][axis] < centers[b][axis];
+			});
+
+			AABB right(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			for (unsigned int i = count - 1; i > 0; --i) {
+				right.Expand(itemAABBs[itemIndices[begin + i]]);
+				rightAreas[i] = right.GetSurfaceArea();
+			}
+
+			AABB left(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			for (unsigned int i = 1; i < count; ++i) {
+				left.Expand(itemAABBs[itemIndices[begin + i - 1]]);
+				const float cost = TRAVERSAL_COST + INTERSECTION_COST * inverseArea *
+					(left.GetSurfaceArea() * i + rightAreas[i] * (count - i));
+				if (cost < best.cost) {
+					best.cost = cost;
+					best.axis = axis;
+					best.position = i;
+				}
+			}
+		}
+		return best;
+	}
+
+	Builder::Split Builder::FindBinnedSplit(unsigned int begin, unsigned int end, unsigned int chunks, const AABB & bounds, const AABB & centerBounds) const {
+		// Bin the items by their centers, one set of bins per chunk which are merged afterwards.
+		std::vector<Bins> chunkBins(chunks);
+		ParallelFor(begin, end, chunks, [&](unsigned int chunkBegin, unsigned int chunkEnd, unsigned int chunk) {
+			Bins & bins = chunkBins[chunk];
+			for (unsigned int i = chunkBegin; i < chunkEnd; ++i) {
+				const unsigned int item = itemIndices[i];
+				for (unsigned int axis = 0; axis < 3; ++axis) {
+					Bin & bin = bins.bins[axis][GetBin(centers[item], centerBounds, axis)];
+					bin.bounds.Expand(itemAABBs[item]);
+					++bin.count;
+				}
+			}
+		});
+		for (unsigned int chunk = 1; chunk < chunks; ++chunk) {
+			chunkBins[0].Merge(chunkBins[chunk]);
+		}
+
+		// Sweep over the planes between the bins.
+		const glm::vec3 centerExtent = centerBounds.maximum - centerBounds.minimum;
+		const float inverseArea = 1.0f / glm::max<float>(bounds.GetSurfaceArea(), FLT_EPSILON);
+		Split best;
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			if (centerExtent[axis] <= 0.0f) {
+				continue;
+			}
+			const Bin * bins = chunkBins[0].bins[axis];
+
+			float rightCosts[BIN_COUNT];
+			AABB right(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			unsigned int rightCount = 0;
+			for (unsigned int i = BIN_COUNT - 1; i > 0; --i) {
+				right.Expand(bins[i].bounds);
+				rightCount += bins[i].count;
+				rightCosts[i] = rightCount > 0 ? right.GetSurfaceArea() * rightCount : -1.0f;
+			}
+
+			AABB left(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+			unsigned int leftCount = 0;
+			for (unsigned int i = 1; i < BIN_COUNT; ++i) {
+				left.Expand(bins[i - 1].bounds);
+				leftCount += bins[i - 1].count;
+				if (leftCount == 0 || rightCosts[i] < 0.0f) {
+					continue;
+				}
+				const float cost = TRAVERSAL_COST + INTERSECTION_COST * inverseArea *
+					(left.GetSurfaceArea() * leftCount + rightCosts[i]);
+				if (cost < best.cost) {
+					best.cost = cost;
+					best.axis = axis;
+					best.position = i;
+				}
+			}
+		}
+		return best;
+	}
+
+	unsigned int Builder::FindMortonSplit(unsigned int begin, unsigned int end) const {
+		const unsigned int first = mortonCodes[begin - rangeBegin], last = mortonCodes[end - 1 - rangeBegin];
+		if (first == last) {
+			return (begin + end) / 2;
+		}
+
+		// Binary search for the first code which has the highest differing bit set.
+		const unsigned int bit = 1u << HighestBit(first ^ last);
+		unsigned int low = begin, high = end - 1;
+		while (low + 1 < high) {
+			const unsigned int middle = (low + high) / 2;
+			if (mortonCodes[middle - rangeBegin] & bit) {
+				high = middle;
+			}
+			else {
+				low = middle;
+			}
+		}
+		return high;
+	}
+
+	unsigned int Builder::PartitionBinned(unsigned int begin, unsigned int end, unsigned int chunks, const AABB & centerBounds, const Split & split) const {
+		const auto isLeft = [&](unsigned int item) {
+			return GetBin(centers[item], centerBounds, split.axis) < split.position;
+		};
+		if (chunks == 1) {
+			return static_cast<unsigned int>(std::partition(itemIndices.begin() + begin, itemIndices.begin() + end, isLeft) - itemIndices.begin());
+		}
+
+		// Count the left items of every chunk, so that each chunk knows where to write its items.
+		std::vector<unsigned int> leftCounts(chunks, 0);
+		ParallelFor(begin, end, chunks, [&](unsigned int chunkBegin, unsigned int chunkEnd, unsigned int chunk) {
+			for (unsigned int i = chunkBegin; i < chunkEnd; ++i) {
+				leftCounts[chunk] += isLeft(itemIndices[i]) ? 1 : 0;
+			}
+		});
+		std::vector<unsigned int> leftOffsets(chunks);
+		unsigned int leftCount = 0;
+		for (unsigned int chunk = 0; chunk < chunks; ++chunk) {
+			leftOffsets[chunk] = leftCount;
+			leftCount += leftCounts[chunk];
+		}
+		const unsigned int middle = begin + leftCount;
+
+		// Scatter the items into a temporary array and copy them back. The right items of a chunk
+		// follow the right items of the previous chunks, of which there are (chunkBegin - begin) - leftOffsets[chunk].
+		std::vector<unsigned int> partitioned(end - begin);
+		ParallelFor(begin, end, chunks, [&](unsigned int chunkBegin, unsigned int chunkEnd, unsigned int chunk) {
+			unsigned int left = leftOffsets[chunk];
+			unsigned int right = leftCount + (chunkBegin - begin) - leftOffsets[chunk];
+			for (unsigned int i = chunkBegin; i < chunkEnd; ++i) {
+				const unsigned int item = itemIndices[i];
+				partitioned[isLeft(item) ? left++ : right++] = item;
+			}
+		});
+		std::copy(partitioned.begin(), partitioned.end(), itemIndices.begin() + begin);
+		return middle;
+	}
+
+	unsigned int Builder::GetBin(const glm::vec3 & center, const AABB & centerBounds, unsigned int axis) {
+		const float extent = centerBounds.maximum[axis] - centerBounds.minimum[axis];
+		if (extent <= 0.0f) {
+			return 0;
+		}
+		const float bin = (center[axis] - centerBounds.minimum[axis]) * (BIN_COUNT / extent);
+		return glm::min<unsigned int>(static_cast<unsigned int>(glm::max<float>(bin, 0.0f)), BIN_COUNT - 1);
+	}
+
+	template<typename Function>
+	void Builder::ParallelFor(unsigned int begin, unsigned int end, unsigned int chunks, Function function) const {
+		if (chunks == 1) {
+			function(begin, end, 0);
+			return;
+		}
+		const int parts = static_cast<int>(chunks);
+		const long long size = end - begin;
+#pragma omp parallel for schedule(static, 1) num_threads(parts)
+		for (int chunk = 0; chunk < parts; ++chunk) {
+			function(begin + static_cast<unsigned int>(size * chunk / parts), begin + static_cast<unsigned int>(size * (chunk + 1) / parts), chunk);
+		}
+	}
+}
+
+void BVH::Build(const std::vector<AABB> & itemAABBs, BuildQuality quality) {
+	std::vector<unsigned int> items(itemAABBs.size());
+	std::iota(items.begin(), items.end(), 0);
+	Build(itemAABBs, items, quality);
+}
+
+void BVH::Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & items, BuildQuality quality) {
+	nodes.clear();
+	referenceAreas.clear();
+	itemIndices = items;
+	if (items.empty()) {
+		return;
+	}
+
+	Builder builder(itemAABBs, itemIndices, quality);
+	nodes.reserve(2 * items.size());
+	builder.Build(nodes, 0, static_cast<unsigned int>(items.size()), 0);
+}
+
+size_t BVH::GetMemoryUsage() const {
+	return nodes.size() * sizeof(Node) + itemIndices.size() * sizeof(unsigned int) + referenceAreas.size() * sizeof(float);
+}
+
+unsigned int BVH::Refit(const std::vector<AABB> & itemAABBs, BuildQuality quality, float maxAreaGrowth) {
+	if (nodes.empty()) {
+		return 0;
+	}
+
+	// The areas before the first refit are the areas of the built hierarchy.
+	if (referenceAreas.size() != nodes.size()) {
+		referenceAreas.resize(nodes.size());
+		for (unsigned int i = 0; i < nodes.size(); ++i) {
+			referenceAreas[i] = nodes[i].axisAlignedBoundingBox.GetSurfaceArea();
+		}
+	}
+
+	// Children are always stored after their parent, so a reverse sweep refits the nodes bottom-up.
+	for (unsigned int i = static_cast<unsigned int>(nodes.size()); i-- > 0;) {
+		Node & node = nodes[i];
+		AABB bounds(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+		if (node.IsLeaf()) {
+			for (unsigned int j = node.offset; j < node.offset + node.count; ++j) {
+				bounds.Expand(itemAABBs[itemIndices[j]]);
+			}
+		}
+		else {
+			bounds = nodes[i + 1].axisAlignedBoundingBox;
+			bounds.Expand(nodes[node.offset].axisAlignedBoundingBox);
+		}
+		node.axisAlignedBoundingBox = bounds;
+	}
+
+	// Find the topmost subtrees which have degraded too much since they were built.
+	std::vector<std::pair<unsigned int, unsigned int>> degradedSubtrees;
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, std::make_pair(0u, 0u));
+	while (!stack.empty()) {
+		const unsigned int nodeIndex = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+
+		const Node & node = nodes[nodeIndex];
+		if (node.axisAlignedBoundingBox.GetSurfaceArea() > maxAreaGrowth * referenceAreas[nodeIndex] && node.count != 1) {
+			degradedSubtrees.push_back(std::make_pair(nodeIndex, depth));
+		}
+		else if (!node.IsLeaf()) {
+			stack.push_back(std::make_pair(nodeIndex + 1, depth + 1));
+			stack.push_back(std::make_pair(node.offset, depth + 1));
+		}
+	}
+
+	if (degradedSubtrees.empty()) {
+		return 0;
+	}
+
+	// Rebuild the degraded subtrees into separate arrays. A subtree occupies the nodes from its root up to and
+	// including its last leaf, and the items from its first leaf up to and including its last leaf.
+	std::sort(degradedSubtrees.begin(), degradedSubtrees.end());
+	Builder builder(itemAABBs, itemIndices, quality);
+	std::vector<std::vector<Node>> subtreeNodes(degradedSubtrees.size());
+	std::vector<unsigned int> subtreeEnds(degradedSubtrees.size());
+	std::vector<int> shifts(degradedSubtrees.size());
+	int shift = 0;
+	for (unsigned int i = 0; i < degradedSubtrees.size(); ++i) {
+		const unsigned int root = degradedSubtrees[i].first;
+		unsigned int first = root, last = root;
+		while (!nodes[first].IsLeaf()) {
+			++first;
+		}
+		while (!nodes[last].IsLeaf()) {
+			last = nodes[last].offset;
+		}
+		const unsigned int itemBegin = nodes[first].offset, itemEnd = nodes[last].offset + nodes[last].count;
+		builder.Build(subtreeNodes[i], itemBegin, itemEnd, degradedSubtrees[i].second);
+
+		// The nodes after the subtree move by the total change in size of the subtrees before them.
+		subtreeEnds[i] = last + 1;
+		shift += static_cast<int>(subtreeNodes[i].size()) - static_cast<int>(subtreeEnds[i] - root);
+		shifts[i] = shift;
+	}
+	const auto GetNewIndex = [&](unsigned int index) {
+		const auto subtreesBefore = std::upper_bound(subtreeEnds.begin(), subtreeEnds.end(), index) - subtreeEnds.begin();
+		return subtreesBefore == 0 ? index : index + shifts[subtreesBefore - 1];
+	};
+
+	// Copy the unchanged nodes and the rebuilt subtrees into new arrays.
+	std::vector<Node> newNodes;
+	std::vector<float> newReferenceAreas;
+	newNodes.reserve(nodes.size() + shift);
+	newReferenceAreas.reserve(nodes.size() + shift);
+	unsigned int nextSubtree = 0;
+	for (unsigned int i = 0; i < nodes.size();) {
+		if (nextSubtree < degradedSubtrees.size() && degradedSubtrees[nextSubtree].first == i) {
+			const unsigned int base = static_cast<unsigned int>(newNodes.size());
+			for (Node node : subtreeNodes[nextSubtree]) {
+				if (!node.IsLeaf()) {
+					node.offset += base;
+				}
+				newNodes.push_back(node);
+				newReferenceAreas.push_back(node.axisAlignedBoundingBox.GetSurfaceArea());
+			}
+			i = subtreeEnds[nextSubtree++];
+			continue;
+		}
+		Node node = nodes[i];
+		if (!node.IsLeaf()) {
+			node.offset = GetNewIndex(node.offset);
+		}
+		newNodes.push_back(node);
+		newReferenceAreas.push_back(referenceAreas[i]);
+		++i;
+	}
+	nodes.swap(newNodes);
+	referenceAreas.swap(newReferenceAreas);
+	return static_cast<unsigned int>(degradedSubtrees.size());
+}
+
+BVH::Statistics BVH::GetStatistics() const {
+	Statistics statistics;
+	if (nodes.empty()) {
+		return statistics;
+	}
+
+	// Walk the tree and sum up the SAH cost of every node relative to the root.
+	const float inverseRootArea = 1.0f / glm::max<float>(nodes[0].axisAlignedBoundingBox.GetSurfaceArea(), FLT_EPSILON);
+	unsigned int itemCount = 0;
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, std::make_pair(0u, 1u));
+	while (!stack.empty()) {
+		const unsigned int nodeIndex = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+
+		const Node & node = nodes[nodeIndex];
+		const float relativeArea = node.axisAlignedBoundingBox.GetSurfaceArea() * inverseRootArea;
+		statistics.maxDepth = glm::max(statistics.maxDepth, depth);
+		++statistics.nodeCount;
+		if (node.IsLeaf()) {
+			++statistics.leafCount;
+			itemCount += node.count;
+			statistics.maxLeafSize = glm::max(statistics.maxLeafSize, node.count);
+			statistics.sahCost += INTERSECTION_COST * relativeArea * node.count;
+		}
+		else {
+			statistics.sahCost += TRAVERSAL_COST * relativeArea;
+			stack.push_back(std::make_pair(nodeIndex + 1, depth + 1));
+			stack.push_back(std::make_pair(node.offset, depth + 1));
+		}
+	}
+	statistics.averageLeafSize = static_cast<float>(itemCount) / statistics.leafCount;
+	return statistics;
+}
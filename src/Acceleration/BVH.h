@@ -0,0 +1,284 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+
+#include <glm.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "../Geometry/RayPacket.h"
+
+/// <summary>
+/// A bounding volume hierarchy built using the surface area heuristic (SAH), or along a Morton curve for previews.
+/// The hierarchy is built over a set of items described by their AABBs and is stored
+/// as a flat array of nodes in depth first order (the first child of an interior node
+/// is always the node directly after it).
+/// </summary>
+class BVH {
+public:
+	/// <summary> A node in the hierarchy. </summary>
+	struct Node {
+		AABB axisAlignedBoundingBox;
+
+		/// <summary> Leaf: index of the first item in itemIndices. Interior: index of the second child. </summary>
+		unsigned int offset;
+
+		/// <summary> The number of items in a leaf. Always 0 for interior nodes. </summary>
+		unsigned int count;
+
+		bool IsLeaf() const { return count > 0; }
+	};
+
+	/// <summary> The maximum depth of the hierarchy (nodes deeper than this are turned into leaves). </summary>
+	static const unsigned int MAX_DEPTH = 64;
+
+	/// <summary> The maximum number of items in a leaf (unless the items cannot be split). </summary>
+	static const unsigned int MAX_LEAF_SIZE = 4;
+
+	/// <summary> Trades build time for ray casting performance. </summary>
+	enum class BuildQuality {
+		/// <summary> Linear BVH: the items are sorted along a Morton curve and split at the highest differing bit. Fastest build, for previews. </summary>
+		PREVIEW,
+		/// <summary> Surface area heuristic evaluated at a fixed number of bins per axis. Built in parallel. </summary>
+		STANDARD,
+		/// <summary> Surface area heuristic evaluated at every item along every axis. Slowest build, for final renders. </summary>
+		FINAL
+	};
+
+	/// <summary> Describes the shape of a built hierarchy. </summary>
+	struct Statistics {
+		unsigned int nodeCount = 0, leafCount = 0;
+
+		/// <summary> The number of nodes on the longest path from the root to a leaf (including both). </summary>
+		unsigned int maxDepth = 0;
+
+		unsigned int maxLeafSize = 0;
+		float averageLeafSize = 0.0f;
+
+		/// <summary>
+		/// The expected cost of casting a random ray which hits the root AABB, according to the surface area heuristic
+		/// (traversal and intersection cost 1 per node and item).
+		/// </summary>
+		float sahCost = 0.0f;
+	};
+
+	std::vector<Node> nodes;
+
+	/// <summary> Item indices ordered so that every leaf references a contiguous range. </summary>
+	std::vector<unsigned int> itemIndices;
+
+	/// <summary> The surface area of every node when it was (re)built. Only kept once Refit has been called. </summary>
+	std::vector<float> referenceAreas;
+
+	/// <summary> Builds the hierarchy over all given items. </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The item index is the index in this vector. </param>
+	/// <param name='quality'> Which build algorithm to use. </param>
+	void Build(const std::vector<AABB> & itemAABBs, BuildQuality quality = BuildQuality::STANDARD);
+
+	/// <summary> Builds the hierarchy over a subset of the given items. </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The item index is the index in this vector. </param>
+	/// <param name='items'> The indices of the items which should be added to the hierarchy. </param>
+	/// <param name='quality'> Which build algorithm to use. </param>
+	void Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & items, BuildQuality quality = BuildQuality::STANDARD);
+
+	/// <summary>
+	/// Updates the hierarchy after the AABBs of its items have changed, e.g. because items moved or were disabled
+	/// (give disabled items an empty AABB). The bounds are refit bottom-up, and subtrees whose surface area has grown
+	/// too much since they were built are rebuilt. Items never move between subtrees that are not rebuilt.
+	/// Returns the number of rebuilt subtrees.
+	/// </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The items are the same as in the last call to Build. </param>
+	/// <param name='quality'> Which build algorithm to use for rebuilt subtrees. </param>
+	/// <param name='maxAreaGrowth'> Subtrees whose surface area has grown by more than this factor are rebuilt. </param>
+	unsigned int Refit(const std::vector<AABB> & itemAABBs, BuildQuality quality = BuildQuality::STANDARD, float maxAreaGrowth = 2.0f);
+
+	/// <summary> Returns the number of bytes used by the nodes, item indices and reference areas. </summary>
+	size_t GetMemoryUsage() const;
+
+	/// <summary> Returns the shape of the hierarchy. </summary>
+	Statistics GetStatistics() const;
+
+	/// <summary>
+	/// Walks the hierarchy front to back and calls intersectLeaf for every visited leaf.
+	/// Returns true if intersectLeaf returned true for any leaf.
+	/// </summary>
+	/// <param name='ray'>
+	/// IN/OUT: The ray which we cast. Nodes further away than ray.tMax are skipped. 
+	/// intersectLeaf should decrease ray.tMax when a closer intersection is found.
+	/// </param>
+	/// <param name='intersectLeaf'>
+	/// Callable on the form bool(unsigned int offset, unsigned int count, Ray & ray), where the items of the leaf
+	/// are itemIndices[offset, offset + count). Should return true (and set ray.tMax to the intersection distance)
+	/// if a closer intersection was found.
+	/// </param>
+	template<typename IntersectLeaf>
+	bool RayCast(Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary>
+	/// Walks every node which the ray enters before ray.tMax (in no particular order) and calls intersectLeaf
+	/// for every visited leaf. Stops and returns true as soon as intersectLeaf returns true.
+	/// </summary>
+	/// <param name='ray'> The ray which we cast. </param>
+	/// <param name='intersectLeaf'> Callable on the form bool(unsigned int offset, unsigned int count) (see RayCast). </param>
+	template<typename IntersectLeaf>
+	bool AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary>
+	/// Walks the hierarchy once for a packet of rays: a node is visited if any of the given rays enters it within
+	/// its ray interval, and intersectLeaf is called for every visited leaf together with the rays which entered it.
+	/// The children are visited in the order of the first of those rays.
+	/// </summary>
+	/// <param name='packet'> 
+	/// IN/OUT: The rays which we cast. intersectLeaf should decrease rays[i].tMax when a closer intersection is found.
+	/// </param>
+	/// <param name='mask'> The rays in the packet which are cast. </param>
+	/// <param name='intersectLeaf'> Callable on the form void(unsigned int offset, unsigned int count, RayPacket::Mask mask) (see RayCast). </param>
+	template<typename IntersectLeaf>
+	void RayCastPacket(RayPacket & packet, RayPacket::Mask mask, IntersectLeaf intersectLeaf) const;
+};
+
+template<typename IntersectLeaf>
+bool BVH::RayCast(Ray & ray, IntersectLeaf intersectLeaf) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	float entryDistance;
+	if (!nodes[0].axisAlignedBoundingBox.RayIntersection(ray, entryDistance) || entryDistance > ray.tMax) {
+		return false;
+	}
+
+	// Nodes which are still to be visited together with their entry distances.
+	unsigned int stackNodes[MAX_DEPTH + 1];
+	float stackDistances[MAX_DEPTH + 1];
+	unsigned int stackSize = 0;
+
+	bool intersectionFound = false;
+	unsigned int current = 0;
+	while (true) {
+		const Node & node = nodes[current];
+		if (node.IsLeaf()) {
+			if (intersectLeaf(node.offset, node.count, ray)) {
+				intersectionFound = true;
+			}
+		}
+		else {
+			// Visit the closest child first and postpone the other one.
+			unsigned int first = current + 1;
+			unsigned int second = node.offset;
+			float firstDistance, secondDistance;
+			const bool firstHit = nodes[first].axisAlignedBoundingBox.RayIntersection(ray, firstDistance) && firstDistance <= ray.tMax;
+			const bool secondHit = nodes[second].axisAlignedBoundingBox.RayIntersection(ray, secondDistance) && secondDistance <= ray.tMax;
+			if (firstHit && secondHit) {
+				if (secondDistance < firstDistance) {
+					std::swap(first, second);
+					std::swap(firstDistance, secondDistance);
+				}
+				stackNodes[stackSize] = second;
+				stackDistances[stackSize] = secondDistance;
+				++stackSize;
+				current = first;
+				continue;
+			}
+			if (firstHit) {
+				current = first;
+				continue;
+			}
+			if (secondHit) {
+				current = second;
+				continue;
+			}
+		}
+
+		// Pop the next node which is not further away than the closest intersection.
+		while (stackSize > 0 && stackDistances[stackSize - 1] > ray.tMax) {
+			--stackSize;
+		}
+		if (stackSize == 0) {
+			break;
+		}
+		current = stackNodes[--stackSize];
+	}
+
+	return intersectionFound;
+}
+
+template<typename IntersectLeaf>
+bool BVH::AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	unsigned int stack[MAX_DEPTH + 1];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const unsigned int current = stack[--stackSize];
+		const Node & node = nodes[current];
+		float entryDistance;
+		if (!node.axisAlignedBoundingBox.RayIntersection(ray, entryDistance) || entryDistance > ray.tMax) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			if (intersectLeaf(node.offset, node.count)) {
+				return true;
+			}
+		}
+		else {
+			stack[stackSize++] = node.offset;
+			stack[stackSize++] = current + 1;
+		}
+	}
+	return false;
+}
+
+template<typename IntersectLeaf>
+void BVH::RayCastPacket(RayPacket & packet, RayPacket::Mask mask, IntersectLeaf intersectLeaf) const {
+	if (nodes.empty()) {
+		return;
+	}
+
+	// Nodes which are still to be visited together with the rays which entered their parent.
+	// Nodes are tested when they are popped, so that the test uses the closest intersections found so far.
+	unsigned int stackNodes[MAX_DEPTH + 2];
+	RayPacket::Mask stackMasks[MAX_DEPTH + 2];
+	unsigned int stackSize = 0;
+	stackNodes[stackSize] = 0;
+	stackMasks[stackSize] = mask;
+	++stackSize;
+
+	while (stackSize > 0) {
+		--stackSize;
+		const unsigned int current = stackNodes[stackSize];
+		const Node & node = nodes[current];
+		const RayPacket::Mask nodeMask = packet.IntersectAABB(node.axisAlignedBoundingBox, stackMasks[stackSize]);
+		if (nodeMask == 0) {
+			continue;
+		}
+		if (node.IsLeaf()) {
+			intersectLeaf(node.offset, node.count, nodeMask);
+			packet.UpdateIntervals(nodeMask);
+			continue;
+		}
+
+		// Push the far child first. The near child is the one whose center comes first along the direction
+		// of the first ray which entered the node (the rays are coherent, so this is a good guess for all of them).
+		unsigned int first = current + 1;
+		unsigned int second = node.offset;
+		unsigned int firstRay = 0;
+		while (!RayPacket::Contains(nodeMask, firstRay)) {
+			++firstRay;
+		}
+		const glm::vec3 separation = nodes[second].axisAlignedBoundingBox.GetCenter() - nodes[first].axisAlignedBoundingBox.GetCenter();
+		if (glm::dot(separation, packet.rays[firstRay].direction) < 0.0f) {
+			std::swap(first, second);
+		}
+		stackNodes[stackSize] = second;
+		stackMasks[stackSize] = nodeMask;
+		++stackSize;
+		stackNodes[stackSize] = first;
+		stackMasks[stackSize] = nodeMask;
+		++stackSize;
+	}
+}
@@ -0,0 +1,153 @@
+#include "Octree.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+	// Relative costs used for the SAH cost of the statistics (same as for the BVH).
+	const float TRAVERSAL_COST = 1.0f;
+	const float INTERSECTION_COST = 1.0f;
+
+	// The octant of items which do not fit into any octant of a node.
+	const unsigned int NO_OCTANT = 8;
+}
+
+void Octree::Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & items,
+				   unsigned int maxDepth, unsigned int maxLeafSize) {
+	nodes.clear();
+	itemIndices = items;
+	if (items.empty()) {
+		return;
+	}
+
+	// The root is the smallest cube around the AABB of all items.
+	AABB bounds(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+	for (unsigned int item : items) {
+		bounds.Expand(itemAABBs[item]);
+	}
+	const glm::vec3 extent = bounds.maximum - bounds.minimum;
+	const float size = glm::max<float>(glm::max<float>(extent.x, extent.y), glm::max<float>(extent.z, 0.0f));
+
+	nodes.reserve(items.size() / glm::max<unsigned int>(maxLeafSize, 1) * 2 + 1);
+	nodes.push_back(Node());
+	BuildRecursive(itemAABBs, 0, bounds.GetCenter(), size, 0, static_cast<unsigned int>(items.size()),
+				   0, glm::min<unsigned int>(maxDepth, MAX_DEPTH), maxLeafSize);
+}
+
+void Octree::BuildRecursive(const std::vector<AABB> & itemAABBs, unsigned int nodeIndex, const glm::vec3 & center, float size,
+							unsigned int begin, unsigned int end, unsigned int depth, unsigned int maxDepth, unsigned int maxLeafSize) {
+	const unsigned int count = end - begin;
+	nodes[nodeIndex].offset = begin;
+	nodes[nodeIndex].count = count;
+	nodes[nodeIndex].firstChild = 0;
+	nodes[nodeIndex].childCount = 0;
+
+	if (count > maxLeafSize && depth < maxDepth) {
+		// An item fits into the loose cube of an octant if it is not larger than the octant itself.
+		// Sort the items so that the items which stay in this node come first, followed by the items of every octant.
+		const float childSize = 0.5f * size;
+		std::vector<unsigned int> octants(count);
+		unsigned int octantCounts[NO_OCTANT + 1] = {};
+		for (unsigned int i = begin; i < end; ++i) {
+			const AABB & aabb = itemAABBs[itemIndices[i]];
+			const glm::vec3 itemExtent = aabb.maximum - aabb.minimum;
+			unsigned int octant = NO_OCTANT;
+			if (itemExtent.x <= childSize && itemExtent.y <= childSize && itemExtent.z <= childSize) {
+				const glm::vec3 itemCenter = aabb.GetCenter();
+				octant = (itemCenter.x >= center.x ? 1 : 0) | (itemCenter.y >= center.y ? 2 : 0) | (itemCenter.z >= center.z ? 4 : 0);
+			}
+			octants[i - begin] = octant;
+			++octantCounts[octant];
+		}
+
+		unsigned int octantBegins[NO_OCTANT + 1];
+		octantBegins[NO_OCTANT] = begin;
+		unsigned int octantBegin = begin + octantCounts[NO_OCTANT];
+		for (unsigned int octant = 0; octant < NO_OCTANT; ++octant) {
+			octantBegins[octant] = octantBegin;
+			octantBegin += octantCounts[octant];
+		}
+
+		std::vector<unsigned int> sortedItems(count);
+		unsigned int octantEnds[NO_OCTANT + 1];
+		std::copy(octantBegins, octantBegins + NO_OCTANT + 1, octantEnds);
+		for (unsigned int i = begin; i < end; ++i) {
+			sortedItems[octantEnds[octants[i - begin]]++ - begin] = itemIndices[i];
+		}
+		std::copy(sortedItems.begin(), sortedItems.end(), itemIndices.begin() + begin);
+
+		nodes[nodeIndex].count = octantCounts[NO_OCTANT];
+
+		// Create the children of the octants which contain items and build them.
+		unsigned int childCount = 0;
+		for (unsigned int octant = 0; octant < NO_OCTANT; ++octant) {
+			childCount += octantCounts[octant] > 0 ? 1 : 0;
+		}
+		if (childCount > 0) {
+			const unsigned int firstChild = static_cast<unsigned int>(nodes.size());
+			nodes.resize(nodes.size() + childCount);
+			nodes[nodeIndex].firstChild = firstChild;
+			nodes[nodeIndex].childCount = childCount;
+
+			unsigned int child = firstChild;
+			for (unsigned int octant = 0; octant < NO_OCTANT; ++octant) {
+				if (octantCounts[octant] == 0) {
+					continue;
+				}
+				const glm::vec3 childCenter = center + 0.5f * childSize * glm::vec3(
+					(octant & 1) ? 1.0f : -1.0f, (octant & 2) ? 1.0f : -1.0f, (octant & 4) ? 1.0f : -1.0f);
+				BuildRecursive(itemAABBs, child++, childCenter, childSize, octantBegins[octant], octantEnds[octant],
+							   depth + 1, maxDepth, maxLeafSize);
+			}
+		}
+	}
+
+	// The AABB of the node encloses its own items and its children.
+	Node & node = nodes[nodeIndex];
+	AABB bounds(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+	for (unsigned int i = node.offset; i < node.offset + node.count; ++i) {
+		bounds.Expand(itemAABBs[itemIndices[i]]);
+	}
+	for (unsigned int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+		bounds.Expand(nodes[child].axisAlignedBoundingBox);
+	}
+	node.axisAlignedBoundingBox = bounds;
+}
+
+size_t Octree::GetMemoryUsage() const {
+	return nodes.size() * sizeof(Node) + itemIndices.size() * sizeof(unsigned int);
+}
+
+BVH::Statistics Octree::GetStatistics() const {
+	BVH::Statistics statistics;
+	if (nodes.empty()) {
+		return statistics;
+	}
+
+	const float inverseRootArea = 1.0f / glm::max<float>(nodes[0].axisAlignedBoundingBox.GetSurfaceArea(), FLT_EPSILON);
+	unsigned int leafItemCount = 0;
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, std::make_pair(0u, 1u));
+	while (!stack.empty()) {
+		const unsigned int nodeIndex = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+
+		const Node & node = nodes[nodeIndex];
+		const float relativeArea = node.axisAlignedBoundingBox.GetSurfaceArea() * inverseRootArea;
+		statistics.maxDepth = glm::max(statistics.maxDepth, depth);
+		++statistics.nodeCount;
+		statistics.sahCost += INTERSECTION_COST * relativeArea * node.count;
+		if (node.IsLeaf()) {
+			++statistics.leafCount;
+			leafItemCount += node.count;
+			statistics.maxLeafSize = glm::max(statistics.maxLeafSize, node.count);
+		}
+		else {
+			statistics.sahCost += TRAVERSAL_COST * relativeArea;
+			for (unsigned int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+				stack.push_back(std::make_pair(child, depth + 1));
+			}
+		}
+	}
+	statistics.averageLeafSize = static_cast<float>(leafItemCount) / statistics.leafCount;
+	return statistics;
+}
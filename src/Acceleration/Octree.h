@@ -0,0 +1,165 @@
+#pragma once
+
+#include <vector>
+
+#include <glm.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "BVH.h"
+
+/// <summary>
+/// A loose octree over a set of items described by their AABBs. Every node covers a cube which is split into
+/// 8 octants. An item is stored in the deepest node whose loose cube (the cube grown by half its size on every side)
+/// contains it, so every item is stored exactly once and large items (e.g. walls) stay close to the root.
+/// Nodes are culled using the tight AABB of the items in their subtree.
+/// </summary>
+class Octree {
+public:
+	/// <summary> A node in the tree. </summary>
+	struct Node {
+		/// <summary> The AABB of all items in the subtree. </summary>
+		AABB axisAlignedBoundingBox;
+
+		/// <summary> Index of the first child. The children of a node are stored next to each other. </summary>
+		unsigned int firstChild;
+
+		/// <summary> The number of children (only octants which contain items get a child). </summary>
+		unsigned int childCount;
+
+		/// <summary> The items of this node (not including the items of the children): itemIndices[offset, offset + count). </summary>
+		unsigned int offset, count;
+
+		bool IsLeaf() const { return childCount == 0; }
+	};
+
+	/// <summary> The largest allowed maximum depth. </summary>
+	static const unsigned int MAX_DEPTH = 16;
+
+	/// <summary> The default maximum depth (the root has depth 0). </summary>
+	static const unsigned int DEFAULT_MAX_DEPTH = 8;
+
+	/// <summary> The default number of items above which a node is subdivided. </summary>
+	static const unsigned int DEFAULT_MAX_LEAF_SIZE = 8;
+
+	std::vector<Node> nodes;
+
+	/// <summary> Item indices ordered so that every node references a contiguous range. </summary>
+	std::vector<unsigned int> itemIndices;
+
+	/// <summary> Builds the tree over a subset of the given items. </summary>
+	/// <param name='itemAABBs'> The AABB of every item. The item index is the index in this vector. </param>
+	/// <param name='items'> The indices of the items which should be added to the tree. </param>
+	/// <param name='maxDepth'> Nodes at this depth are never subdivided. Clamped to MAX_DEPTH. </param>
+	/// <param name='maxLeafSize'> Nodes with more items than this are subdivided. </param>
+	void Build(const std::vector<AABB> & itemAABBs, const std::vector<unsigned int> & items,
+			   unsigned int maxDepth = DEFAULT_MAX_DEPTH, unsigned int maxLeafSize = DEFAULT_MAX_LEAF_SIZE);
+
+	/// <summary> Returns the number of bytes used by the nodes and item indices. </summary>
+	size_t GetMemoryUsage() const;
+
+	/// <summary>
+	/// Returns the shape of the tree in the same terms as BVH::GetStatistics. Leaves are nodes without children,
+	/// and the SAH cost counts a traversal step for every node with children and an intersection for every item.
+	/// </summary>
+	BVH::Statistics GetStatistics() const;
+
+	/// <summary> Same as BVH::RayCast, where the items of every visited node with items count as a leaf. </summary>
+	template<typename IntersectLeaf>
+	bool RayCast(Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary> Same as BVH::AnyHit, where the items of every visited node with items count as a leaf. </summary>
+	template<typename IntersectLeaf>
+	bool AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const;
+
+private:
+	/// <summary> The maximum number of postponed nodes during traversal. </summary>
+	static const unsigned int MAX_STACK_SIZE = 7 * MAX_DEPTH + 1;
+
+	/// <summary> A postponed node and the distance at which the ray enters it. </summary>
+	struct StackEntry {
+		unsigned int node;
+		float distance;
+	};
+
+	/// <summary> Builds the subtree of a node covering the given cube over itemIndices[begin, end). </summary>
+	void BuildRecursive(const std::vector<AABB> & itemAABBs, unsigned int nodeIndex, const glm::vec3 & center, float size,
+						unsigned int begin, unsigned int end, unsigned int depth, unsigned int maxDepth, unsigned int maxLeafSize);
+};
+
+template<typename IntersectLeaf>
+bool Octree::RayCast(Ray & ray, IntersectLeaf intersectLeaf) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	float entryDistance;
+	if (!nodes[0].axisAlignedBoundingBox.RayIntersection(ray, entryDistance) || entryDistance > ray.tMax) {
+		return false;
+	}
+
+	StackEntry stack[MAX_STACK_SIZE];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, entryDistance };
+
+	bool intersectionFound = false;
+	while (stackSize > 0) {
+		const StackEntry entry = stack[--stackSize];
+		if (entry.distance > ray.tMax) {
+			continue;
+		}
+
+		const Node & node = nodes[entry.node];
+		if (node.count > 0 && intersectLeaf(node.offset, node.count, ray)) {
+			intersectionFound = true;
+		}
+
+		// Push the hit children so that the closest one is visited first.
+		const unsigned int firstPushed = stackSize;
+		for (unsigned int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+			float childDistance;
+			if (!nodes[child].axisAlignedBoundingBox.RayIntersection(ray, childDistance) || childDistance > ray.tMax) {
+				continue;
+			}
+
+			// Insertion sort by decreasing distance.
+			unsigned int i = stackSize++;
+			while (i > firstPushed && stack[i - 1].distance < childDistance) {
+				stack[i] = stack[i - 1];
+				--i;
+			}
+			stack[i] = { child, childDistance };
+		}
+	}
+
+	return intersectionFound;
+}
+
+template<typename IntersectLeaf>
+bool Octree::AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const {
+	if (nodes.empty()) {
+		return false;
+	}
+
+	float entryDistance;
+	if (!nodes[0].axisAlignedBoundingBox.RayIntersection(ray, entryDistance) || entryDistance > ray.tMax) {
+		return false;
+	}
+
+	unsigned int stack[MAX_STACK_SIZE];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const Node & node = nodes[stack[--stackSize]];
+		if (node.count > 0 && intersectLeaf(node.offset, node.count)) {
+			return true;
+		}
+		for (unsigned int child = node.firstChild; child < node.firstChild + node.childCount; ++child) {
+			float childDistance;
+			if (nodes[child].axisAlignedBoundingBox.RayIntersection(ray, childDistance) && childDistance <= ray.tMax) {
+				stack[stackSize++] = child;
+			}
+		}
+	}
+	return false;
+}
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <cassert>
+
+#include <emmintrin.h>
+#include <glm.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "WideBVH.h"
+#include "WideBVHTraversal.h"
+
+/// <summary>
+/// A compressed version of WideBVH. The child AABBs of a node are quantized to 8 or 16 bits
+/// (QuantizedType = unsigned char or unsigned short) relative to the AABB of the node itself.
+/// The quantized boxes are rounded outwards, so they always contain the full precision boxes.
+/// Traversal therefore finds the same intersections as the full precision tree, at the cost
+/// of a few more node visits. With 8 bits a node takes one cache line, half of a full precision node.
+/// </summary>
+template<typename QuantizedType>
+class QuantizedWideBVH : public WideBVHTraversal<QuantizedWideBVH<QuantizedType>> {
+public:
+	using Traversal = WideBVHTraversal<QuantizedWideBVH<QuantizedType>>;
+	using TraversalRay = typename Traversal::TraversalRay;
+	static const unsigned int WIDTH = Traversal::WIDTH;
+	static const unsigned int EMPTY = Traversal::EMPTY;
+
+	/// <summary> The largest quantized value. </summary>
+	static const unsigned int LEVELS = std::numeric_limits<QuantizedType>::max();
+
+	/// <summary>
+	/// The largest number of items in a leaf. BVH leaves only grow beyond BVH::MAX_LEAF_SIZE when their items
+	/// cannot be split (i.e. they have the same center), so this is never reached in practice.
+	/// </summary>
+	static const unsigned int MAX_LEAF_COUNT = 0xffff;
+
+	/// <summary> A node in the hierarchy. Child i is described by the i:th element of every array. </summary>
+	struct Node {
+		/// <summary> The minimum corner of the node AABB. </summary>
+		float origin[3];
+
+		/// <summary>
+		/// The size of a quantization step along each axis is 2^exponent, which is cheaper to store than a float
+		/// and makes the dequantization exact.
+		/// </summary>
+		signed char exponent[3];
+
+		/// <summary>
+		/// The quantized child AABBs stored per axis: minimum[axis][child].
+		/// A quantized value q corresponds to the coordinate q * 2^exponent + origin.
+		/// </summary>
+		QuantizedType minimum[3][WIDTH];
+		QuantizedType maximum[3][WIDTH];
+
+		/// <summary> Leaf: index of the first item in itemIndices. Interior: index of the child node. Unused: EMPTY. </summary>
+		unsigned int offset[WIDTH];
+
+		/// <summary> The number of items in a leaf child (at most MAX_LEAF_COUNT). Always 0 for interior and unused children. </summary>
+		unsigned short count[WIDTH];
+	};
+
+	std::vector<Node> nodes;
+
+	/// <summary> Item indices ordered so that every leaf references a contiguous range. </summary>
+	std::vector<unsigned int> itemIndices;
+
+	/// <summary> Builds the hierarchy by collapsing and quantizing a binary hierarchy. </summary>
+	void Build(const BVH & bvh);
+
+	/// <summary> Returns the number of bytes used by the nodes and item indices. </summary>
+	size_t GetMemoryUsage() const;
+
+	/// <summary> Returns the (dequantized) AABB of a used child slot of a node. </summary>
+	static AABB GetChildAABB(const Node & node, unsigned int child) {
+		glm::vec3 minimum, maximum;
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			minimum[axis] = Dequantize(node.minimum[axis][child], node.origin[axis], node.exponent[axis]);
+			maximum[axis] = Dequantize(node.maximum[axis][child], node.origin[axis], node.exponent[axis]);
+		}
+		return AABB(minimum, maximum);
+	}
+
+	/// <summary> See WideBVH::IntersectChildren. </summary>
+	static int IntersectChildren(const Node & node, const TraversalRay & ray, const float maxDistance, float entryDistances[WIDTH]);
+
+private:
+	/// <summary> The range of the step exponents, within which 2^exponent is a normal float. </summary>
+	static const int MIN_EXPONENT = -126, MAX_EXPONENT = 127;
+
+	/// <summary> Returns 2^exponent, for exponents in [MIN_EXPONENT, MAX_EXPONENT]. </summary>
+	static float GetStep(int exponent) {
+		const int bits = (exponent + 127) << 23;
+		float step;
+		std::memcpy(&step, &bits, sizeof(step));
+		return step;
+	}
+
+	/// <summary> Returns the coordinate of a quantized value. Must match the decoding in IntersectChildren exactly. </summary>
+	static float Dequantize(unsigned int value, float origin, int exponent) {
+		return static_cast<float>(value) * GetStep(exponent) + origin;
+	}
+
+	/// <summary> Loads 4 quantized values as floats. </summary>
+	static __m128 LoadQuantized(const unsigned char values[WIDTH]) {
+		int packed;
+		std::memcpy(&packed, values, sizeof(packed));
+		const __m128i zero = _mm_setzero_si128();
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+	}
+	static __m128 LoadQuantized(const unsigned short values[WIDTH]) {
+		const __m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i *>(values));
+		return _mm_cvtepi32_ps(_mm_unpacklo_epi16(packed, _mm_setzero_si128()));
+	}
+};
+
+template<typename QuantizedType>
+void QuantizedWideBVH<QuantizedType>::Build(const BVH & bvh) {
+	// Build a full precision tree and quantize it node by node. The topology is kept as is.
+	WideBVH wideBVH;
+	wideBVH.Build(bvh);
+	itemIndices = wideBVH.itemIndices;
+	nodes.resize(wideBVH.nodes.size());
+
+	for (unsigned int n = 0; n < wideBVH.nodes.size(); ++n) {
+		const WideBVH::Node & source = wideBVH.nodes[n];
+		Node & node = nodes[n];
+		for (unsigned int i = 0; i < WIDTH; ++i) {
+			assert(source.count[i] <= MAX_LEAF_COUNT);
+			node.offset[i] = source.offset[i];
+			node.count[i] = static_cast<unsigned short>(source.count[i]);
+		}
+
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			// The node AABB is the union of the used child AABBs.
+			float low = FLT_MAX, high = -FLT_MAX;
+			for (unsigned int i = 0; i < WIDTH; ++i) {
+				if (source.offset[i] != EMPTY) {
+					low = glm::min<float>(low, source.minimum[axis][i]);
+					high = glm::max<float>(high, source.maximum[axis][i]);
+				}
+			}
+
+			// Nodes over empty items only (e.g. disabled ones) get an arbitrary range, in which all children end up empty.
+			if (low > high) {
+				low = 0.0f;
+				high = 1.0f;
+			}
+
+			// Use the smallest power of two step with which the largest quantized value reaches the maximum.
+			int exponent = MIN_EXPONENT;
+			if (high > low) {
+				std::frexp((high - low) / LEVELS, &exponent);
+				exponent = glm::clamp(exponent - 1, MIN_EXPONENT, MAX_EXPONENT);
+			}
+			while (exponent < MAX_EXPONENT && Dequantize(LEVELS, low, exponent) < high) {
+				++exponent;
+			}
+			const float step = GetStep(exponent);
+			node.origin[axis] = low;
+			node.exponent[axis] = static_cast<signed char>(exponent);
+
+			// Round the child boxes outwards.
+			for (unsigned int i = 0; i < WIDTH; ++i) {
+				if (source.offset[i] == EMPTY) {
+					node.minimum[axis][i] = static_cast<QuantizedType>(LEVELS);
+					node.maximum[axis][i] = 0;
+					continue;
+				}
+				unsigned int minimum = static_cast<unsigned int>(glm::clamp<float>(std::floor((source.minimum[axis][i] - low) / step), 0.0f, static_cast<float>(LEVELS)));
+				unsigned int maximum = static_cast<unsigned int>(glm::clamp<float>(std::ceil((source.maximum[axis][i] - low) / step), 0.0f, static_cast<float>(LEVELS)));
+				while (minimum > 0 && Dequantize(minimum, low, exponent) > source.minimum[axis][i]) {
+					--minimum;
+				}
+				while (maximum < LEVELS && Dequantize(maximum, low, exponent) < source.maximum[axis][i]) {
+					++maximum;
+				}
+				node.minimum[axis][i] = static_cast<QuantizedType>(minimum);
+				node.maximum[axis][i] = static_cast<QuantizedType>(maximum);
+			}
+		}
+	}
+}
+
+template<typename QuantizedType>
+size_t QuantizedWideBVH<QuantizedType>::GetMemoryUsage() const {
+	return nodes.size() * sizeof(Node) + itemIndices.size() * sizeof(unsigned int);
+}
+
+template<typename QuantizedType>
+inline int QuantizedWideBVH<QuantizedType>::IntersectChildren(const Node & node, const TraversalRay & ray,
+															  const float maxDistance, float entryDistances[WIDTH]) {
+	// Same slab test as WideBVH::IntersectChildren, on the dequantized child boxes.
+	__m128 entry = _mm_setzero_ps();
+	__m128 exit = _mm_set1_ps(maxDistance);
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		const __m128 origin = _mm_set1_ps(node.origin[axis]);
+		const __m128 step = _mm_set1_ps(GetStep(node.exponent[axis]));
+		const QuantizedType * nearPlanes = ray.negativeDirection[axis] ? node.maximum[axis] : node.minimum[axis];
+		const QuantizedType * farPlanes = ray.negativeDirection[axis] ? node.minimum[axis] : node.maximum[axis];
+		const __m128 nearCoordinates = _mm_add_ps(_mm_mul_ps(LoadQuantized(nearPlanes), step), origin);
+		const __m128 farCoordinates = _mm_add_ps(_mm_mul_ps(LoadQuantized(farPlanes), step), origin);
+		const __m128 nearDistances = _mm_mul_ps(_mm_sub_ps(nearCoordinates, ray.from[axis]), ray.inverseDirection[axis]);
+		const __m128 farDistances = _mm_mul_ps(_mm_sub_ps(farCoordinates, ray.from[axis]), ray.inverseDirection[axis]);
+		entry = _mm_max_ps(nearDistances, entry);
+		exit = _mm_min_ps(farDistances, exit);
+	}
+	_mm_storeu_ps(entryDistances, entry);
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+}
@@ -0,0 +1,81 @@
+#include "WideBVH.h"
+
+#include <cassert>
+
+void WideBVH::Build(const BVH & bvh) {
+	nodes.clear();
+	itemIndices = bvh.itemIndices;
+
+	// A single leaf needs no node (see WideBVHTraversal), which saves most of the memory of small render groups.
+	if (bvh.nodes.empty() || bvh.nodes[0].IsLeaf()) {
+		return;
+	}
+
+	nodes.reserve(bvh.nodes.size() / 2 + 1);
+	CollapseRecursive(bvh, 0);
+}
+
+size_t WideBVH::GetMemoryUsage() const {
+	return nodes.size() * sizeof(Node) + itemIndices.size() * sizeof(unsigned int);
+}
+
+unsigned int WideBVH::CollapseRecursive(const BVH & bvh, unsigned int binaryNodeIndex) {
+	const unsigned int nodeIndex = static_cast<unsigned int>(nodes.size());
+	nodes.push_back(Node());
+
+	// Pull up grandchildren until the node is full, always opening the child with the largest surface area.
+	assert(!bvh.nodes[binaryNodeIndex].IsLeaf());
+	std::vector<unsigned int> children;
+	children.push_back(binaryNodeIndex + 1);
+	children.push_back(bvh.nodes[binaryNodeIndex].offset);
+	while (children.size() < WIDTH) {
+		int largest = -1;
+		float largestArea = -1.0f;
+		for (unsigned int i = 0; i < children.size(); ++i) {
+			const BVH::Node & child = bvh.nodes[children[i]];
+			const float area = child.axisAlignedBoundingBox.GetSurfaceArea();
+			if (!child.IsLeaf() && area > largestArea) {
+				largest = i;
+				largestArea = area;
+			}
+		}
+		if (largest < 0) {
+			break;
+		}
+		const unsigned int opened = children[largest];
+		children[largest] = opened + 1;
+		children.push_back(bvh.nodes[opened].offset);
+	}
+
+	// Fill the child slots. Interior children are collapsed recursively.
+	for (unsigned int i = 0; i < WIDTH; ++i) {
+		Node & node = nodes[nodeIndex];
+		if (i >= children.size()) {
+			for (unsigned int axis = 0; axis < 3; ++axis) {
+				node.minimum[axis][i] = FLT_MAX;
+				node.maximum[axis][i] = -FLT_MAX;
+			}
+			node.offset[i] = EMPTY;
+			node.count[i] = 0;
+			continue;
+		}
+
+		const BVH::Node & child = bvh.nodes[children[i]];
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			node.minimum[axis][i] = child.axisAlignedBoundingBox.minimum[axis];
+			node.maximum[axis][i] = child.axisAlignedBoundingBox.maximum[axis];
+		}
+		node.count[i] = child.count;
+		if (child.IsLeaf()) {
+			node.offset[i] = child.offset;
+		}
+		else {
+			// Note that the recursion may reallocate the nodes, so the node reference is fetched again.
+			const unsigned int childIndex = CollapseRecursive(bvh, children[i]);
+			nodes[nodeIndex].offset[i] = childIndex;
+		}
+	}
+
+	assert(nodes[nodeIndex].offset[0] != EMPTY);
+	return nodeIndex;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vector>
+
+#include <xmmintrin.h>
+#include <glm.hpp>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "BVH.h"
+#include "WideBVHTraversal.h"
+
+/// <summary>
+/// A 4-ary bounding volume hierarchy. It is built by collapsing a binary hierarchy so that every
+/// node has up to 4 children, whose AABBs are stored as a structure of arrays. This way a ray is tested
+/// against all children of a node at once using SSE instructions.
+/// </summary>
+class WideBVH : public WideBVHTraversal<WideBVH> {
+public:
+	/// <summary> A node in the hierarchy. Child i is described by the i:th element of every array. </summary>
+	struct Node {
+		/// <summary> The child AABBs stored per axis: minimum[axis][child]. Unused slots are empty boxes. </summary>
+		float minimum[3][WIDTH];
+		float maximum[3][WIDTH];
+
+		/// <summary> Leaf: index of the first item in itemIndices. Interior: index of the child node. Unused: EMPTY. </summary>
+		unsigned int offset[WIDTH];
+
+		/// <summary> The number of items in a leaf child. Always 0 for interior and unused children. </summary>
+		unsigned int count[WIDTH];
+	};
+
+	std::vector<Node> nodes;
+
+	/// <summary> Item indices ordered so that every leaf references a contiguous range. </summary>
+	std::vector<unsigned int> itemIndices;
+
+	/// <summary>
+	/// Builds the hierarchy by collapsing a binary hierarchy. The leaves (and thereby the item order) are kept as is.
+	/// A binary hierarchy which is a single leaf gives no nodes at all.
+	/// </summary>
+	void Build(const BVH & bvh);
+
+	/// <summary> Returns the number of bytes used by the nodes and item indices. </summary>
+	size_t GetMemoryUsage() const;
+
+	/// <summary> Returns the AABB of a used child slot of a node. </summary>
+	static AABB GetChildAABB(const Node & node, unsigned int child) {
+		return AABB(node.minimum[0][child], node.minimum[1][child], node.minimum[2][child],
+					node.maximum[0][child], node.maximum[1][child], node.maximum[2][child]);
+	}
+
+	/// <summary>
+	/// Tests the ray against all children of a node. Returns a bit mask of the hit children
+	/// and stores the entry distance of every child in entryDistances.
+	/// </summary>
+	static int IntersectChildren(const Node & node, const TraversalRay & ray, const float maxDistance, float entryDistances[WIDTH]);
+
+private:
+	/// <summary> Collapses the subtree of a binary interior node into a wide node. Returns the index of the wide node. </summary>
+	unsigned int CollapseRecursive(const BVH & bvh, unsigned int binaryNodeIndex);
+};
+
+inline int WideBVH::IntersectChildren(const Node & node, const TraversalRay & ray, const float maxDistance, float entryDistances[WIDTH]) {
+	// Slab test against all children at once. The near and far planes are picked by the direction sign.
+	__m128 entry = _mm_setzero_ps();
+	__m128 exit = _mm_set1_ps(maxDistance);
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		const float * nearPlanes = ray.negativeDirection[axis] ? node.maximum[axis] : node.minimum[axis];
+		const float * farPlanes = ray.negativeDirection[axis] ? node.minimum[axis] : node.maximum[axis];
+		const __m128 nearDistances = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(nearPlanes), ray.from[axis]), ray.inverseDirection[axis]);
+		const __m128 farDistances = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(farPlanes), ray.from[axis]), ray.inverseDirection[axis]);
+
+		// The accumulated distance is the second operand so that NaNs (0 * inf) are ignored.
+		entry = _mm_max_ps(nearDistances, entry);
+		exit = _mm_min_ps(farDistances, exit);
+	}
+	_mm_storeu_ps(entryDistances, entry);
+	return _mm_movemask_ps(_mm_cmple_ps(entry, exit));
+}
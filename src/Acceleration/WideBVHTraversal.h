@@ -0,0 +1,214 @@
+#pragma once
+
+#include <xmmintrin.h>
+#include <glm.hpp>
+
+#include <vector>
+#include <utility>
+
+#include "../Geometry/AABB.h"
+#include "../Geometry/Ray.h"
+#include "BVH.h"
+
+/// <summary>
+/// Traversal shared by the 4-ary hierarchies (WideBVH and QuantizedWideBVH). The hierarchies only differ
+/// in how the child AABBs are stored, so Tree must provide:
+/// - nodes: the nodes, where every node has the arrays offset[WIDTH] and count[WIDTH] (see WideBVH::Node).
+///   A hierarchy with items but no nodes is a single leaf over all the items. Its bounds are not tested: such a
+///   leaf has few items (see BVH::MAX_LEAF_SIZE), which cost about as much to test as a node.
+/// - itemIndices: item indices ordered so that every leaf references a contiguous range.
+/// - static AABB GetChildAABB(const Node & node, unsigned int child), the AABB of a used child slot.
+/// - static int IntersectChildren(const Node & node, const TraversalRay & ray, float maxDistance, float entryDistances[WIDTH]),
+///   which returns a bit mask of the children hit before maxDistance together with their entry distances.
+/// </summary>
+template<typename Tree>
+class WideBVHTraversal {
+public:
+	/// <summary> The maximum number of children of a node (one per SSE lane). </summary>
+	static const unsigned int WIDTH = 4;
+
+	/// <summary> Marks an unused child slot. </summary>
+	static const unsigned int EMPTY = 0xffffffff;
+
+	/// <summary> Per ray data shared by all node tests. </summary>
+	struct TraversalRay {
+		__m128 from[3], inverseDirection[3];
+		bool negativeDirection[3];
+
+		TraversalRay(const Ray & ray);
+	};
+
+	/// <summary> Same as BVH::RayCast. </summary>
+	template<typename IntersectLeaf>
+	bool RayCast(Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary> Same as BVH::AnyHit. </summary>
+	template<typename IntersectLeaf>
+	bool AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const;
+
+	/// <summary>
+	/// Returns the shape of the hierarchy in the same terms as BVH::GetStatistics. The nodes are the wide nodes and
+	/// the leaves are their leaf children, so the depth counts the wide nodes on a path plus its leaf. The SAH cost
+	/// counts a traversal step for every wide node.
+	/// </summary>
+	BVH::Statistics GetStatistics() const;
+
+private:
+	/// <summary> The maximum number of postponed children during traversal. </summary>
+	static const unsigned int MAX_STACK_SIZE = (WIDTH - 1) * BVH::MAX_DEPTH + 1;
+
+	/// <summary> A postponed child: a leaf if count > 0, otherwise the index of an interior node. </summary>
+	struct StackEntry {
+		unsigned int offset, count;
+		float distance;
+	};
+};
+
+template<typename Tree>
+WideBVHTraversal<Tree>::TraversalRay::TraversalRay(const Ray & ray) {
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		const float inverse = 1.0f / ray.direction[axis];
+		from[axis] = _mm_set1_ps(ray.from[axis]);
+		inverseDirection[axis] = _mm_set1_ps(inverse);
+		negativeDirection[axis] = inverse < 0.0f; // Also handles -0.
+	}
+}
+
+template<typename Tree>
+template<typename IntersectLeaf>
+bool WideBVHTraversal<Tree>::RayCast(Ray & ray, IntersectLeaf intersectLeaf) const {
+	const Tree & tree = static_cast<const Tree &>(*this);
+	if (tree.nodes.empty()) {
+		return !tree.itemIndices.empty() && intersectLeaf(0u, static_cast<unsigned int>(tree.itemIndices.size()), ray);
+	}
+
+	const TraversalRay traversalRay(ray);
+	StackEntry stack[MAX_STACK_SIZE];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = { 0, 0, 0.0f };
+
+	bool intersectionFound = false;
+	while (stackSize > 0) {
+		const StackEntry entry = stack[--stackSize];
+		if (entry.distance > ray.tMax) {
+			continue;
+		}
+		if (entry.count > 0) {
+			if (intersectLeaf(entry.offset, entry.count, ray)) {
+				intersectionFound = true;
+			}
+			continue;
+		}
+
+		// Push the hit children so that the closest one is visited first.
+		const auto & node = tree.nodes[entry.offset];
+		float entryDistances[WIDTH];
+		const int hitMask = Tree::IntersectChildren(node, traversalRay, ray.tMax, entryDistances);
+		const unsigned int firstPushed = stackSize;
+		for (unsigned int child = 0; child < WIDTH; ++child) {
+			if ((hitMask & (1 << child)) == 0 || node.offset[child] == EMPTY) {
+				continue;
+			}
+			StackEntry childEntry = { node.offset[child], node.count[child], entryDistances[child] };
+
+			// Insertion sort by decreasing distance.
+			unsigned int i = stackSize++;
+			while (i > firstPushed && stack[i - 1].distance < childEntry.distance) {
+				stack[i] = stack[i - 1];
+				--i;
+			}
+			stack[i] = childEntry;
+		}
+	}
+
+	return intersectionFound;
+}
+
+template<typename Tree>
+template<typename IntersectLeaf>
+bool WideBVHTraversal<Tree>::AnyHit(const Ray & ray, IntersectLeaf intersectLeaf) const {
+	const Tree & tree = static_cast<const Tree &>(*this);
+	if (tree.nodes.empty()) {
+		return !tree.itemIndices.empty() && intersectLeaf(0u, static_cast<unsigned int>(tree.itemIndices.size()));
+	}
+
+	const TraversalRay traversalRay(ray);
+	unsigned int stack[MAX_STACK_SIZE];
+	unsigned int stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0) {
+		const auto & node = tree.nodes[stack[--stackSize]];
+		float entryDistances[WIDTH];
+		const int hitMask = Tree::IntersectChildren(node, traversalRay, ray.tMax, entryDistances);
+		for (unsigned int child = 0; child < WIDTH; ++child) {
+			if ((hitMask & (1 << child)) == 0 || node.offset[child] == EMPTY) {
+				continue;
+			}
+			if (node.count[child] == 0) {
+				stack[stackSize++] = node.offset[child];
+				continue;
+			}
+			if (intersectLeaf(node.offset[child], node.count[child])) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+template<typename Tree>
+BVH::Statistics WideBVHTraversal<Tree>::GetStatistics() const {
+	const float TRAVERSAL_COST = 1.0f, INTERSECTION_COST = 1.0f;
+	const Tree & tree = static_cast<const Tree &>(*this);
+	BVH::Statistics statistics;
+	if (tree.nodes.empty()) {
+		if (!tree.itemIndices.empty()) {
+			// A single leaf.
+			statistics.leafCount = statistics.maxDepth = 1;
+			statistics.maxLeafSize = static_cast<unsigned int>(tree.itemIndices.size());
+			statistics.averageLeafSize = static_cast<float>(statistics.maxLeafSize);
+			statistics.sahCost = INTERSECTION_COST * statistics.maxLeafSize;
+		}
+		return statistics;
+	}
+
+	const auto getNodeAABB = [&](const typename Tree::Node & node) {
+		AABB aabb = Tree::GetChildAABB(node, 0);
+		for (unsigned int child = 1; child < WIDTH; ++child) {
+			if (node.offset[child] != EMPTY) {
+				aabb.Expand(Tree::GetChildAABB(node, child));
+			}
+		}
+		return aabb;
+	};
+
+	// Walk the tree and sum up the SAH cost of every node and leaf relative to the root.
+	const float inverseRootArea = 1.0f / glm::max<float>(getNodeAABB(tree.nodes[0]).GetSurfaceArea(), FLT_EPSILON);
+	unsigned int itemCount = 0;
+	std::vector<std::pair<unsigned int, unsigned int>> stack(1, std::make_pair(0u, 1u));
+	while (!stack.empty()) {
+		const unsigned int nodeIndex = stack.back().first, depth = stack.back().second;
+		stack.pop_back();
+
+		const auto & node = tree.nodes[nodeIndex];
+		++statistics.nodeCount;
+		statistics.sahCost += TRAVERSAL_COST * getNodeAABB(node).GetSurfaceArea() * inverseRootArea;
+		for (unsigned int child = 0; child < WIDTH; ++child) {
+			if (node.offset[child] == EMPTY) {
+				continue;
+			}
+			if (node.count[child] == 0) {
+				stack.push_back(std::make_pair(node.offset[child], depth + 1));
+				continue;
+			}
+			const unsigned int count = node.count[child];
+			++statistics.leafCount;
+			itemCount += count;
+			statistics.maxDepth = glm::max(statistics.maxDepth, depth + 1);
+			statistics.maxLeafSize = glm::max(statistics.maxLeafSize, count);
+			statistics.sahCost += INTERSECTION_COST * Tree::GetChildAABB(node, child).GetSurfaceArea() * inverseRootArea * count;
+		}
+	}
+	statistics.averageLeafSize = static_cast<float>(itemCount) / statistics.leafCount;
+	return statistics;
+}
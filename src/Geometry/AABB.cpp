@@ -22,9 +22,61 @@ bool AABB::IsPointInsideAABB(const glm::vec3 & p) const {
 
 glm::vec3 AABB::GetCenter() const { return 0.5f * (minimum + maximum); }
 
-bool AABB::RayIntersection(const Ray & ray) {
+float AABB::GetSurfaceArea() const {
+	const glm::vec3 d = maximum - minimum;
+	if (d.x < 0.0f || d.y < 0.0f || d.z < 0.0f) {
+		return 0.0f; // Empty AABB.
+	}
+	return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+void AABB::Expand(const AABB & other) {
+	minimum = glm::min(minimum, other.minimum);
+	maximum = glm::max(maximum, other.maximum);
+}
+
+void AABB::Expand(const glm::vec3 & point) {
+	minimum = glm::min(minimum, point);
+	maximum = glm::max(maximum, point);
+}
+
+bool AABB::RayIntersection(const Ray & ray) const {
+	float intersectionDistance;
+	return RayIntersection(ray, intersectionDistance);
+}
+
+bool AABB::RayIntersection(const Ray & ray, float & intersectionDistance) const {
 	// Using the fast ray AABB overlap test using ray slopes as described by M. Eisemann et al.
 	// http://www.cg.cs.tu-bs.de/media/publications/fast-rayaxis-aligned-bounding-box-overlap-tests-using-ray-slopes.pdf
-	std::cerr << "AABB ray intersection has not been implemented yet (AABB.cpp)." << std::endl;
-	return false;
+	// The ray data is precomputed in a mirrored coordinate system where the direction is non-positive 
+	// along every axis, so we only need to handle the MMM case (after mirroring the AABB as well).
+	const float x0 = ray.mirrored[0] ? -maximum.x : minimum.x;
+	const float y0 = ray.mirrored[1] ? -maximum.y : minimum.y;
+	const float z0 = ray.mirrored[2] ? -maximum.z : minimum.z;
+	const float x1 = ray.mirrored[0] ? -minimum.x : maximum.x;
+	const float y1 = ray.mirrored[1] ? -minimum.y : maximum.y;
+	const float z1 = ray.mirrored[2] ? -minimum.z : maximum.z;
+	const glm::vec3 & from = ray.mirroredFrom;
+
+	// Most boxes are rejected by one of the first tests, so bail out early.
+	const bool miss = (from.x < x0) || (from.y < y0) || (from.z < z0) ||
+		(ray.slopeYX * x0 - y1 + ray.interceptXY > 0) ||
+		(ray.slopeXY * y0 - x1 + ray.interceptYX > 0) ||
+		(ray.slopeYZ * z0 - y1 + ray.interceptZY > 0) ||
+		(ray.slopeZY * y0 - z1 + ray.interceptYZ > 0) ||
+		(ray.slopeZX * x0 - z1 + ray.interceptXZ > 0) ||
+		(ray.slopeXZ * z0 - x1 + ray.interceptZX > 0);
+	if (miss) {
+		return false;
+	}
+
+	// The ray enters the AABB at the last of the three (mirrored) maximum planes.
+	intersectionDistance = 0.0f;
+	const float tx = (x1 - from.x) * ray.mirroredInverseDirection.x;
+	if (tx > intersectionDistance) { intersectionDistance = tx; }
+	const float ty = (y1 - from.y) * ray.mirroredInverseDirection.y;
+	if (ty > intersectionDistance) { intersectionDistance = ty; }
+	const float tz = (z1 - from.z) * ray.mirroredInverseDirection.z;
+	if (tz > intersectionDistance) { intersectionDistance = tz; }
+	return intersectionDistance < FLT_MAX;
 }
@@ -24,6 +24,24 @@ public:
 	/// <summary> Returns the center of the AABB. </summary>
 	glm::vec3 GetCenter() const;
 
+	/// <summary> Returns the surface area of the AABB. </summary>
+	float GetSurfaceArea() const;
+
+	/// <summary> Grows this AABB so that it also encloses the given AABB. </summary>
+	void Expand(const AABB & other);
+
+	/// <summary> Grows this AABB so that it also encloses the given point. </summary>
+	void Expand(const glm::vec3 & point);
+
 	/// <summary> Returns true if a given ray intersects this AABB. </summary>
-	bool RayIntersection(const Ray & ray);
+	bool RayIntersection(const Ray & ray) const;
+
+	/// <summary> 
+	/// Returns true if a given ray intersects this AABB.
+	/// </summary>
+	/// <param name='ray'> The ray for which we compute AABB intersection. </param>
+	/// <param name='intersectionDistance'> 
+	/// OUT: The distance to where the ray enters the AABB (0 if the ray starts inside the AABB).
+	/// </param>
+	bool RayIntersection(const Ray & ray, float & intersectionDistance) const;
 };
\ No newline at end of file
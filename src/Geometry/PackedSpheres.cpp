@@ -0,0 +1,101 @@
+#include "PackedSpheres.h"
+
+#include <cmath>
+#include <limits>
+#include <immintrin.h>
+
+#include "../Utility/Other.h"
+
+namespace {
+	const bool AVX_SUPPORTED = Utility::IsAVXSupported();
+}
+
+void PackedSpheres::Pack(const std::vector<const Sphere *> & spheres) {
+	const size_t size = spheres.size() + WIDTH - 1;
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		center[axis].assign(size, std::numeric_limits<float>::quiet_NaN());
+	}
+	squaredRadius.assign(size, std::numeric_limits<float>::quiet_NaN());
+	packed.assign(spheres.size(), 0);
+	packedCount = 0;
+
+	for (unsigned int position = 0; position < spheres.size(); ++position) {
+		const Sphere * sphere = spheres[position];
+		if (sphere == nullptr) {
+			continue;
+		}
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			center[axis][position] = sphere->center[axis];
+		}
+		squaredRadius[position] = sphere->radius * sphere->radius;
+		packed[position] = 1;
+		++packedCount;
+	}
+}
+
+unsigned int PackedSpheres::Intersect(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	return AVX_SUPPORTED ? IntersectAVX(ray, offset, count, distances) : IntersectScalar(ray, offset, count, distances);
+}
+
+// Same operations in the same order as Sphere::RayIntersection (no FMA, exact square root), so that both give
+// bit identical results. Lanes with NaN data fail every comparison.
+unsigned int PackedSpheres::IntersectAVX(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	// m = from - center.
+	const __m256 mx = _mm256_sub_ps(_mm256_set1_ps(ray.from.x), _mm256_loadu_ps(&center[0][offset]));
+	const __m256 my = _mm256_sub_ps(_mm256_set1_ps(ray.from.y), _mm256_loadu_ps(&center[1][offset]));
+	const __m256 mz = _mm256_sub_ps(_mm256_set1_ps(ray.from.z), _mm256_loadu_ps(&center[2][offset]));
+
+	const __m256 mDotD = _mm256_add_ps(_mm256_add_ps(
+		_mm256_mul_ps(mx, _mm256_set1_ps(ray.direction.x)),
+		_mm256_mul_ps(my, _mm256_set1_ps(ray.direction.y))),
+		_mm256_mul_ps(mz, _mm256_set1_ps(ray.direction.z)));
+	const __m256 mDotM = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(mx, mx), _mm256_mul_ps(my, my)), _mm256_mul_ps(mz, mz));
+	const __m256 u = _mm256_mul_ps(_mm256_set1_ps(2.0f), mDotD);
+	const __m256 v = _mm256_sub_ps(mDotM, _mm256_loadu_ps(&squaredRadius[offset]));
+	const __m256 discriminant = _mm256_sub_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_set1_ps(0.25f), u), u), v);
+	const __m256 d = _mm256_sqrt_ps(discriminant);
+
+	// Use the closest root inside the ray interval (t1 <= t2).
+	const __m256 negativeHalfU = _mm256_mul_ps(_mm256_set1_ps(-0.5f), u);
+	const __m256 t1 = _mm256_sub_ps(negativeHalfU, d);
+	const __m256 t2 = _mm256_add_ps(negativeHalfU, d);
+	const __m256 tMin = _mm256_set1_ps(ray.tMin);
+	const __m256 t = _mm256_blendv_ps(t2, t1, _mm256_cmp_ps(t1, tMin, _CMP_GT_OQ));
+
+	__m256 hit = _mm256_cmp_ps(discriminant, _mm256_set1_ps(FLT_EPSILON), _CMP_GE_OQ);
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, tMin, _CMP_GT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(ray.tMax), _CMP_LT_OQ));
+
+	_mm256_storeu_ps(distances, t);
+	const unsigned int hitMask = static_cast<unsigned int>(_mm256_movemask_ps(hit)) & ((1u << count) - 1);
+
+	// Avoid the penalty of mixing AVX and legacy SSE code in the caller.
+	_mm256_zeroupper();
+	return hitMask;
+}
+
+unsigned int PackedSpheres::IntersectScalar(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	unsigned int hitMask = 0;
+	for (unsigned int lane = 0; lane < count; ++lane) {
+		const unsigned int i = offset + lane;
+		const glm::vec3 m = ray.from - glm::vec3(center[0][i], center[1][i], center[2][i]);
+		const float u = 2 * glm::dot(m, ray.direction);
+		const float v = glm::dot(m, m) - squaredRadius[i];
+		float d = 0.25f * u * u - v;
+		if (!(d >= FLT_EPSILON)) {
+			continue;
+		}
+		d = std::sqrt(d);
+		const float t1 = -0.5f * u - d;
+		const float t2 = -0.5f * u + d;
+		distances[lane] = t1 > ray.tMin ? t1 : t2;
+		if (distances[lane] > ray.tMin && distances[lane] < ray.tMax) {
+			hitMask |= 1u << lane;
+		}
+	}
+	return hitMask;
+}
+
+size_t PackedSpheres::GetMemoryUsage() const {
+	return 4 * squaredRadius.size() * sizeof(float) + packed.size() * sizeof(unsigned char);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "Sphere.h"
+#include "Ray.h"
+
+/// <summary>
+/// Spheres stored as a structure of arrays (centers and squared radii), so that a ray can be tested against
+/// WIDTH spheres at a time using AVX. Like PackedTriangles, the spheres are stored at given positions
+/// (the item order of an acceleration structure), and positions without a sphere never intersect.
+/// </summary>
+class PackedSpheres {
+public:
+	/// <summary> The number of spheres tested at once (one per AVX lane). </summary>
+	static const unsigned int WIDTH = 8;
+
+	/// <summary>
+	/// Packs the given spheres, where position i holds spheres[i] (nullptr if there is no sphere at the position).
+	/// Call this again after the order has changed or the spheres have moved.
+	/// </summary>
+	void Pack(const std::vector<const Sphere *> & spheres);
+
+	/// <summary> Returns true if there is a sphere at the given position. </summary>
+	bool IsPacked(unsigned int position) const { return packed[position] != 0; }
+
+	/// <summary> Returns true if no position holds a sphere. </summary>
+	bool IsEmpty() const { return packedCount == 0; }
+
+	/// <summary>
+	/// Intersects a ray with the spheres at positions [offset, offset + count), where count is at most WIDTH.
+	/// Gives the same results as Sphere::RayIntersection.
+	/// Returns a bit mask of the spheres which intersect within the ray interval (bit i for position offset + i).
+	/// </summary>
+	/// <param name='distances'> OUT: The intersection distance of every intersecting sphere. </param>
+	unsigned int Intersect(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+
+	/// <summary> Returns the number of bytes used by the packed data. </summary>
+	size_t GetMemoryUsage() const;
+
+private:
+	/// <summary>
+	/// The centers per axis and the squared radii, padded with WIDTH - 1 extra elements so that WIDTH elements
+	/// can be loaded from any position. Positions without a sphere hold NaN.
+	/// </summary>
+	std::vector<float> center[3], squaredRadius;
+
+	std::vector<unsigned char> packed;
+	unsigned int packedCount = 0;
+
+	unsigned int IntersectAVX(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+	unsigned int IntersectScalar(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+};
@@ -0,0 +1,148 @@
+#include "PackedTriangles.h"
+
+#include <cmath>
+#include <limits>
+#include <immintrin.h>
+
+#include "Triangle.h"
+#include "Quad.h"
+#include "../Utility/Other.h"
+
+namespace {
+	const bool AVX_SUPPORTED = Utility::IsAVXSupported();
+}
+
+void PackedTriangles::Reset(unsigned int positionCount) {
+	const size_t size = positionCount + WIDTH - 1;
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		v0[axis].assign(size, std::numeric_limits<float>::quiet_NaN());
+		edge1[axis].assign(size, std::numeric_limits<float>::quiet_NaN());
+		edge2[axis].assign(size, std::numeric_limits<float>::quiet_NaN());
+	}
+	uvSumLimit.assign(size, std::numeric_limits<float>::quiet_NaN());
+	packed.assign(positionCount, 0);
+	otherPrimitiveCount = 0;
+}
+
+void PackedTriangles::PackTriangle(unsigned int position, const glm::vec3 & vertex0, const glm::vec3 & vertex1, const glm::vec3 & vertex2) {
+	PackEdges(position, vertex0, vertex1 - vertex0, vertex2 - vertex0, 1.0f);
+}
+
+void PackedTriangles::PackEdges(unsigned int position, const glm::vec3 & vertex0, const glm::vec3 & E1, const glm::vec3 & E2, float limit) {
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		v0[axis][position] = vertex0[axis];
+		edge1[axis][position] = E1[axis];
+		edge2[axis][position] = E2[axis];
+	}
+	uvSumLimit[position] = limit;
+	packed[position] = 1;
+}
+
+void PackedTriangles::Pack(const std::vector<Primitive*> & primitives, const std::vector<unsigned int> & order) {
+	Reset(static_cast<unsigned int>(order.size()));
+	for (unsigned int position = 0; position < order.size(); ++position) {
+		const Primitive * primitive = primitives[order[position]];
+		if (primitive->type == Primitive::Type::TRIANGLE) {
+			const Triangle * triangle = static_cast<const Triangle *>(primitive);
+			PackTriangle(position, triangle->vertices[0], triangle->vertices[1], triangle->vertices[2]);
+		}
+		else if (primitive->type == Primitive::Type::QUAD) {
+			const Quad * quad = static_cast<const Quad *>(primitive);
+			PackEdges(position, quad->corner, quad->edge1, quad->edge2, 2.0f);
+		}
+		else {
+			++otherPrimitiveCount;
+		}
+	}
+}
+
+void PackedTriangles::Pack(const TriangleMesh & mesh, const std::vector<unsigned int> & order) {
+	Reset(static_cast<unsigned int>(order.size()));
+	for (unsigned int position = 0; position < order.size(); ++position) {
+		PackTriangle(position, mesh.GetVertex(order[position], 0), mesh.GetVertex(order[position], 1), mesh.GetVertex(order[position], 2));
+	}
+}
+
+unsigned int PackedTriangles::Intersect(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	return AVX_SUPPORTED ? IntersectAVX(ray, offset, count, distances) : IntersectScalar(ray, offset, count, distances);
+}
+
+// Same operations in the same order as Triangle::RayIntersection (no FMA, exact division), so that both give
+// bit identical results. The quads check v <= 1 instead of u + v <= 1 (Quad::RayIntersection), so both bounds
+// are tested: v <= 1 follows from u + v <= 1 for triangles, and u + v <= 2 from u, v <= 1 for quads.
+// Lanes with NaN data fail every comparison.
+unsigned int PackedTriangles::IntersectAVX(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	const __m256 Dx = _mm256_set1_ps(ray.direction.x);
+	const __m256 Dy = _mm256_set1_ps(ray.direction.y);
+	const __m256 Dz = _mm256_set1_ps(ray.direction.z);
+	const __m256 E1x = _mm256_loadu_ps(&edge1[0][offset]);
+	const __m256 E1y = _mm256_loadu_ps(&edge1[1][offset]);
+	const __m256 E1z = _mm256_loadu_ps(&edge1[2][offset]);
+	const __m256 E2x = _mm256_loadu_ps(&edge2[0][offset]);
+	const __m256 E2y = _mm256_loadu_ps(&edge2[1][offset]);
+	const __m256 E2z = _mm256_loadu_ps(&edge2[2][offset]);
+
+	// P = cross(D, E2), T = from - v0.
+	const __m256 Px = _mm256_sub_ps(_mm256_mul_ps(Dy, E2z), _mm256_mul_ps(E2y, Dz));
+	const __m256 Py = _mm256_sub_ps(_mm256_mul_ps(Dz, E2x), _mm256_mul_ps(E2z, Dx));
+	const __m256 Pz = _mm256_sub_ps(_mm256_mul_ps(Dx, E2y), _mm256_mul_ps(E2x, Dy));
+	const __m256 Tx = _mm256_sub_ps(_mm256_set1_ps(ray.from.x), _mm256_loadu_ps(&v0[0][offset]));
+	const __m256 Ty = _mm256_sub_ps(_mm256_set1_ps(ray.from.y), _mm256_loadu_ps(&v0[1][offset]));
+	const __m256 Tz = _mm256_sub_ps(_mm256_set1_ps(ray.from.z), _mm256_loadu_ps(&v0[2][offset]));
+
+	const __m256 one = _mm256_set1_ps(1.0f);
+	const __m256 zero = _mm256_setzero_ps();
+	const __m256 den = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(E1x, Px), _mm256_mul_ps(E1y, Py)), _mm256_mul_ps(E1z, Pz));
+	const __m256 inv_den = _mm256_div_ps(one, den);
+	const __m256 u = _mm256_mul_ps(inv_den, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Tx, Px), _mm256_mul_ps(Ty, Py)), _mm256_mul_ps(Tz, Pz)));
+
+	// Q = cross(T, E1).
+	const __m256 Qx = _mm256_sub_ps(_mm256_mul_ps(Ty, E1z), _mm256_mul_ps(E1y, Tz));
+	const __m256 Qy = _mm256_sub_ps(_mm256_mul_ps(Tz, E1x), _mm256_mul_ps(E1z, Tx));
+	const __m256 Qz = _mm256_sub_ps(_mm256_mul_ps(Tx, E1y), _mm256_mul_ps(E1x, Ty));
+	const __m256 v = _mm256_mul_ps(inv_den, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Dx, Qx), _mm256_mul_ps(Dy, Qy)), _mm256_mul_ps(Dz, Qz)));
+	const __m256 t = _mm256_mul_ps(inv_den, _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(E2x, Qx), _mm256_mul_ps(E2y, Qy)), _mm256_mul_ps(E2z, Qz)));
+
+	__m256 hit = _mm256_and_ps(_mm256_cmp_ps(u, zero, _CMP_GE_OQ), _mm256_cmp_ps(u, one, _CMP_LE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(v, zero, _CMP_GE_OQ), _mm256_cmp_ps(v, one, _CMP_LE_OQ)));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_add_ps(u, v), _mm256_loadu_ps(&uvSumLimit[offset]), _CMP_LE_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(ray.tMin), _CMP_GT_OQ));
+	hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, _mm256_set1_ps(ray.tMax), _CMP_LT_OQ));
+
+	_mm256_storeu_ps(distances, t);
+	const unsigned int hitMask = static_cast<unsigned int>(_mm256_movemask_ps(hit)) & ((1u << count) - 1);
+
+	// Avoid the penalty of mixing AVX and legacy SSE code in the caller.
+	_mm256_zeroupper();
+	return hitMask;
+}
+
+unsigned int PackedTriangles::IntersectScalar(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const {
+	unsigned int hitMask = 0;
+	for (unsigned int lane = 0; lane < count; ++lane) {
+		const unsigned int i = offset + lane;
+		const glm::vec3 E1(edge1[0][i], edge1[1][i], edge1[2][i]);
+		const glm::vec3 E2(edge2[0][i], edge2[1][i], edge2[2][i]);
+		const glm::vec3 P = glm::cross(ray.direction, E2);
+		const glm::vec3 T = ray.from - glm::vec3(v0[0][i], v0[1][i], v0[2][i]);
+		const float inv_den = 1.0f / glm::dot(E1, P);
+		const float u = inv_den * glm::dot(T, P);
+		if (!(u >= 0.0f && u <= 1.0f)) {
+			continue;
+		}
+		const glm::vec3 Q = glm::cross(T, E1);
+		const float v = inv_den * glm::dot(ray.direction, Q);
+		if (!(v >= 0.0f && v <= 1.0f && u + v <= uvSumLimit[i])) {
+			continue;
+		}
+		distances[lane] = inv_den * glm::dot(E2, Q);
+		if (distances[lane] > ray.tMin && distances[lane] < ray.tMax) {
+			hitMask |= 1u << lane;
+		}
+	}
+	return hitMask;
+}
+
+size_t PackedTriangles::GetMemoryUsage() const {
+	return 10 * v0[0].size() * sizeof(float) + packed.size() * sizeof(unsigned char);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <vector>
+
+#include "Primitive.h"
+#include "TriangleMesh.h"
+#include "Ray.h"
+
+/// <summary>
+/// The triangles of a render group stored as a structure of arrays, with the first vertex and the two edges
+/// used by the Mller-Trumbore test precomputed. Triangles are stored at the positions of their primitives
+/// in a given order (the item order of an acceleration structure), so that the triangles of a leaf are
+/// contiguous and can be tested against a ray WIDTH at a time using AVX. Quads are packed as well, since
+/// they use the same test with a different bound on the barycentric coordinates.
+/// </summary>
+class PackedTriangles {
+public:
+	/// <summary> The number of triangles tested at once (one per AVX lane). </summary>
+	static const unsigned int WIDTH = 8;
+
+	/// <summary>
+	/// Packs the triangles and quads among the given primitives. Position i holds primitives[order[i]].
+	/// Call this again after the order has changed or the triangles have moved.
+	/// </summary>
+	void Pack(const std::vector<Primitive*> & primitives, const std::vector<unsigned int> & order);
+
+	/// <summary> Same as above, but packs the triangles of a mesh. Position i holds triangle order[i] of the mesh. </summary>
+	void Pack(const TriangleMesh & mesh, const std::vector<unsigned int> & order);
+
+	/// <summary> Returns true if the primitive at the given position is a packed triangle or quad. </summary>
+	bool IsPacked(unsigned int position) const { return packed[position] != 0; }
+
+	/// <summary> Returns true if some of the packed positions are not triangles or quads (and have to be tested separately). </summary>
+	bool ContainsOtherPrimitives() const { return otherPrimitiveCount > 0; }
+
+	/// <summary>
+	/// Intersects a ray with the triangles and quads at positions [offset, offset + count), where count is at most WIDTH.
+	/// Gives the same results as Triangle::RayIntersection and Quad::RayIntersection. Other positions never intersect.
+	/// Returns a bit mask of the positions which intersect within the ray interval (bit i for position offset + i).
+	/// </summary>
+	/// <param name='distances'> OUT: The intersection distance of every intersecting triangle. </param>
+	unsigned int Intersect(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+
+	/// <summary> Returns the number of bytes used by the packed data. </summary>
+	size_t GetMemoryUsage() const;
+
+private:
+	/// <summary>
+	/// The first vertex and the edges E1 = v1 - v0 and E2 = v2 - v0 per axis (the corner and the edges of a quad),
+	/// padded with WIDTH - 1 extra elements so that WIDTH elements can be loaded from any position.
+	/// Positions without a triangle or quad hold NaN.
+	/// </summary>
+	std::vector<float> v0[3], edge1[3], edge2[3];
+
+	/// <summary> The bound on u + v of the barycentric coordinates: 1 for triangles and 2 (no bound) for quads. </summary>
+	std::vector<float> uvSumLimit;
+
+	std::vector<unsigned char> packed;
+	unsigned int otherPrimitiveCount = 0;
+
+	/// <summary> Fills the packed data with NaN for the given number of positions. </summary>
+	void Reset(unsigned int positionCount);
+
+	/// <summary> Packs the triangle with the given vertices at the given position. </summary>
+	void PackTriangle(unsigned int position, const glm::vec3 & vertex0, const glm::vec3 & vertex1, const glm::vec3 & vertex2);
+
+	/// <summary> Packs the first vertex (or corner), the edges and the bound on u + v at the given position. </summary>
+	void PackEdges(unsigned int position, const glm::vec3 & vertex0, const glm::vec3 & E1, const glm::vec3 & E2, float limit);
+
+	unsigned int IntersectAVX(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+	unsigned int IntersectScalar(const Ray & ray, unsigned int offset, unsigned int count, float distances[WIDTH]) const;
+};
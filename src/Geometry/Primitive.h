@@ -5,24 +5,40 @@
 #include "AABB.h"
 #include "../Rendering/Materials/Material.h"
 #include "Ray.h"
+#include "../Utility/Sampler.h"
 
 /// <summary> Abstract base class for geometrical primitives such as spheres and triangles </summary> 
 class Primitive {
 public:
+	/// <summary> The concrete primitive types. Hot loops switch on this instead of making virtual calls (see Primitives.h). </summary>
+	enum class Type { TRIANGLE, SPHERE, QUAD };
+
+	/// <summary> The concrete type of this primitive. </summary>
+	const Type type;
+
 	bool convex = true;
 	bool enabled = true;
 	virtual glm::vec3 GetNormal(const glm::vec3 & position) const = 0;
 	virtual glm::vec3 GetCenter() const = 0;
-	virtual glm::vec3 GetRandomPositionOnSurface() const = 0;
+	virtual glm::vec3 GetRandomPositionOnSurface(Utility::Sampler & sampler) const = 0;
 	virtual const AABB & GetAxisAlignedBoundingBox() const = 0;
 
+	/// <summary> 
+	/// Moves the primitive by the given offset. Refit the acceleration structures afterwards 
+	/// (see Scene::RefitAccelerationStructures).
+	/// </summary>
+	virtual void Translate(const glm::vec3 & offset) = 0;
+
 	/// <summary> 
 	/// Computes the ray intersection point.
-	/// Returns true if there is an intersection.
+	/// Returns true if there is an intersection within the ray interval (ray.tMin, ray.tMax).
 	/// </summary>
 	/// <param name='ray'> The ray for which we compute intersection. </param>
 	/// <param name='intersectionPoint'> 
 	/// The distance to the intersection point (if there is an intersection). 
 	/// </param>
 	virtual bool RayIntersection(const Ray& ray, float & intersectionDistance) const = 0;
+
+protected:
+	Primitive(const Type _type) : type(_type) { }
 };
\ No newline at end of file
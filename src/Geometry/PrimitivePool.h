@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <utility>
+
+/// <summary>
+/// Owns primitives of a single type, stored contiguously in blocks of BLOCK_SIZE primitives. The primitives never move,
+/// so render groups can keep pointers to them, and they are all destroyed together with the pool (no per-primitive
+/// allocation or delete).
+/// </summary>
+template<typename T>
+class PrimitivePool {
+public:
+	/// <summary> The number of primitives in every block. </summary>
+	static const size_t BLOCK_SIZE = 4096;
+
+	/// <summary> Constructs a primitive in the pool from the given constructor arguments and returns it. </summary>
+	template<typename... Arguments>
+	T * Add(Arguments &&... arguments);
+
+	/// <summary> Returns the number of primitives in the pool. </summary>
+	size_t Size() const { return size; }
+
+private:
+	/// <summary> Every block is reserved to BLOCK_SIZE primitives up front, so it is never reallocated. </summary>
+	std::vector<std::unique_ptr<std::vector<T>>> blocks;
+	size_t size = 0;
+};
+
+template<typename T>
+template<typename... Arguments>
+T * PrimitivePool<T>::Add(Arguments &&... arguments) {
+	if (blocks.empty() || blocks.back()->size() == BLOCK_SIZE) {
+		blocks.emplace_back(new std::vector<T>());
+		blocks.back()->reserve(BLOCK_SIZE);
+	}
+	blocks.back()->emplace_back(std::forward<Arguments>(arguments)...);
+	++size;
+	return &blocks.back()->back();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Primitive.h"
+#include "Triangle.h"
+#include "Sphere.h"
+#include "Quad.h"
+
+/// <summary>
+/// The primitive functions used in hot loops (ray casting, acceleration structure builds and shading), dispatched
+/// by switching on Primitive::type instead of through the virtual functions. Triangle, Sphere and Quad are final, so
+/// the calls below are direct calls.
+/// </summary>
+namespace Primitives {
+	/// <summary> Same as primitive.RayIntersection(ray, intersectionDistance). </summary>
+	inline bool RayIntersection(const Primitive & primitive, const Ray & ray, float & intersectionDistance) {
+		switch (primitive.type) {
+		case Primitive::Type::TRIANGLE:
+			return static_cast<const Triangle &>(primitive).RayIntersection(ray, intersectionDistance);
+		case Primitive::Type::SPHERE:
+			return static_cast<const Sphere &>(primitive).RayIntersection(ray, intersectionDistance);
+		case Primitive::Type::QUAD:
+			return static_cast<const Quad &>(primitive).RayIntersection(ray, intersectionDistance);
+		}
+		return primitive.RayIntersection(ray, intersectionDistance);
+	}
+
+	/// <summary> Same as primitive.GetNormal(position). </summary>
+	inline glm::vec3 GetNormal(const Primitive & primitive, const glm::vec3 & position) {
+		switch (primitive.type) {
+		case Primitive::Type::TRIANGLE:
+			return static_cast<const Triangle &>(primitive).GetNormal(position);
+		case Primitive::Type::SPHERE:
+			return static_cast<const Sphere &>(primitive).GetNormal(position);
+		case Primitive::Type::QUAD:
+			return static_cast<const Quad &>(primitive).GetNormal(position);
+		}
+		return primitive.GetNormal(position);
+	}
+
+	/// <summary> Same as primitive.GetAxisAlignedBoundingBox(). </summary>
+	inline const AABB & GetAxisAlignedBoundingBox(const Primitive & primitive) {
+		switch (primitive.type) {
+		case Primitive::Type::TRIANGLE:
+			return static_cast<const Triangle &>(primitive).GetAxisAlignedBoundingBox();
+		case Primitive::Type::SPHERE:
+			return static_cast<const Sphere &>(primitive).GetAxisAlignedBoundingBox();
+		case Primitive::Type::QUAD:
+			return static_cast<const Quad &>(primitive).GetAxisAlignedBoundingBox();
+		}
+		return primitive.GetAxisAlignedBoundingBox();
+	}
+}
@@ -0,0 +1,55 @@
+#include "Quad.h"
+
+Quad::Quad(glm::vec3 _corner, glm::vec3 _edge1, glm::vec3 _edge2, glm::vec3 _normal) :
+	Primitive(Type::QUAD), corner(_corner), edge1(_edge1), edge2(_edge2), normal(_normal) {
+	const glm::vec3 opposite = corner + edge1 + edge2;
+	const glm::vec3 minimum = glm::min(glm::min(corner, opposite), glm::min(corner + edge1, corner + edge2));
+	const glm::vec3 maximum = glm::max(glm::max(corner, opposite), glm::max(corner + edge1, corner + edge2));
+	axisAlignedBoundingBox = AABB(minimum, maximum);
+}
+
+glm::vec3 Quad::GetNormal(const glm::vec3 &) const { return normal; }
+
+glm::vec3 Quad::GetCenter() const {
+	return corner + 0.5f * (edge1 + edge2);
+}
+
+glm::vec3 Quad::GetRandomPositionOnSurface(Utility::Sampler & sampler) const {
+	const glm::vec2 sample = sampler.Next2D();
+	return corner + sample.x * edge1 + sample.y * edge2;
+}
+
+const AABB & Quad::GetAxisAlignedBoundingBox() const {
+	return axisAlignedBoundingBox;
+}
+
+void Quad::Translate(const glm::vec3 & offset) {
+	corner += offset;
+	axisAlignedBoundingBox.minimum += offset;
+	axisAlignedBoundingBox.maximum += offset;
+}
+
+// The Mller-Trumbore test of Triangle::RayIntersection with the edges of the quad, where the bounds check of
+// the barycentric coordinates (u, v) is relaxed from the triangle to the unit square. Solving for (u, v, distance)
+// with Cramer's rule is a ray-plane intersection followed by a 2D bounds check in edge coordinates, and keeps
+// the quads in the same packed AVX kernel as the triangles (see PackedTriangles).
+bool Quad::RayIntersection(const Ray & ray, float & intersectionDistance) const {
+	const glm::vec3 P = glm::cross(ray.direction, edge2);
+	const glm::vec3 T = ray.from - corner;
+
+	const float inv_den = 1.0f / glm::dot(edge1, P);
+
+	float u = inv_den * glm::dot(T, P);
+	if (u < 0.0f || u > 1.0f) {
+		return false; // Didn't hit.
+	}
+
+	const glm::vec3 Q = glm::cross(T, edge1);
+	const float v = inv_den * glm::dot(ray.direction, Q);
+	if (v < 0.0f || v > 1.0f) {
+		return false; // Didn't hit.
+	}
+
+	intersectionDistance = inv_den * glm::dot(edge2, Q);
+	return intersectionDistance > ray.tMin && intersectionDistance < ray.tMax;
+}
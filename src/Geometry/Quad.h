@@ -0,0 +1,39 @@
+#pragma once
+
+#include "glm.hpp"
+#include "Primitive.h"
+#include "Ray.h"
+
+/// <summary>
+/// Describes a planar quad (a parallelogram): the positions corner + s * edge1 + t * edge2 for s, t in [0, 1].
+/// Cheaper than the two triangles it replaces: a single intersection test and exact O(1) area sampling.
+/// </summary>
+class Quad final : public Primitive {
+public:
+	glm::vec3 corner;
+	glm::vec3 edge1, edge2;
+	glm::vec3 normal;
+
+	Quad(glm::vec3 corner = glm::vec3(), glm::vec3 edge1 = glm::vec3(), glm::vec3 edge2 = glm::vec3(), glm::vec3 normal = glm::vec3());
+
+	glm::vec3 GetNormal(const glm::vec3 & position) const override;
+	glm::vec3 GetCenter() const override;
+
+	/// <summary> Returns a uniformly distributed random position on the quad. </summary>
+	glm::vec3 GetRandomPositionOnSurface(Utility::Sampler & sampler) const override;
+
+	const AABB & GetAxisAlignedBoundingBox() const override;
+	void Translate(const glm::vec3 & offset) override;
+
+	/// <summary>
+	/// Computes the ray intersection point between a ray and this quad: the intersection with the plane of the quad,
+	/// followed by a bounds check of its coordinates (s, t) along the edges. Returns true if there is an intersection.
+	/// </summary>
+	/// <param name='ray'> The ray for which we compute quad intersection. </param>
+	/// <param name='intersectionPoint'>
+	/// OUT: The distance to the intersection point (if there is an intersection).
+	/// </param>
+	bool RayIntersection(const Ray& ray, float & intersectionDistance) const override;
+private:
+	AABB axisAlignedBoundingBox;
+};
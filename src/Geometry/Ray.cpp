@@ -1,14 +1,48 @@
 #include "Ray.h"
 
-#include <iostream>
+#include <cmath>
 
-Ray::Ray(glm::vec3 _from, glm::vec3 _dir) :
-	from(_from), direction(_dir) {}
+constexpr float Ray::SELF_INTERSECTION_EPSILON;
 
-Ray::Ray() { }
+Ray::Ray(glm::vec3 _from, glm::vec3 _dir, float _tMin, float _tMax) :
+	from(_from), direction(_dir), tMin(_tMin), tMax(_tMax) {
+	Update();
+}
+
+Ray::Ray() : Ray(glm::vec3(0), glm::vec3(1, 0, 0)) { }
 
-#if __AABB_TESTING
 void Ray::Update() {
-	std::cerr << "Ray AABB update has not been implemented yet (Ray.cpp)." << std::endl;
+	// Mirror every axis along which the direction is non-negative. A -0 component is left as it is, since mirroring
+	// it would give +0 and a +inf inverse, which the MMM test below doesn't expect.
+	glm::vec3 mirroredDirection;
+	for (unsigned int i = 0; i < 3; ++i) {
+		mirrored[i] = !std::signbit(direction[i]);
+		const float sign = mirrored[i] ? -1.0f : 1.0f;
+		mirroredFrom[i] = sign * from[i];
+		mirroredDirection[i] = sign * direction[i];
+	}
+	mirroredInverseDirection = 1.0f / mirroredDirection;
+
+	const float & x = mirroredFrom.x;
+	const float & y = mirroredFrom.y;
+	const float & z = mirroredFrom.z;
+	const float & i = mirroredDirection.x;
+	const float & j = mirroredDirection.y;
+	const float & k = mirroredDirection.z;
+
+	// Ray slopes.
+	slopeYX = j * mirroredInverseDirection.x;
+	slopeXY = i * mirroredInverseDirection.y;
+	slopeZY = k * mirroredInverseDirection.y;
+	slopeYZ = j * mirroredInverseDirection.z;
+	slopeZX = k * mirroredInverseDirection.x;
+	slopeXZ = i * mirroredInverseDirection.z;
+
+	// Precomputed intercepts.
+	interceptXY = y - slopeYX * x;
+	interceptYX = x - slopeXY * y;
+	interceptZY = y - slopeYZ * z;
+	interceptYZ = z - slopeZY * y;
+	interceptXZ = z - slopeZX * x;
+	interceptZX = x - slopeXZ * z;
 }
-#endif
\ No newline at end of file
@@ -1,30 +1,57 @@
 #pragma once
 
-#include <glm.hpp>
+#include <cfloat>
 
-#define __AABB_TESTING false
+#include <glm.hpp>
 
 /// <summary> 
 /// Describes a 3D ray. 
 /// Ray is parametrized as X = F + t * D (where F = from and D = direction).
+/// Only intersections with tMin < t < tMax are considered.
 /// </summary>
 class Ray {
 public:
+	/// <summary> 
+	/// The default start of the ray interval. Rays which start on a surface use this
+	/// to avoid intersecting the surface they start on.
+	/// </summary>
+	static constexpr float SELF_INTERSECTION_EPSILON = 0.001f;
+
 	glm::vec3 direction, from;
-	Ray(glm::vec3 from, glm::vec3 direction);
+
+	/// <summary> The interval along the ray in which intersections are considered. </summary>
+	float tMin, tMax;
+
+	Ray(glm::vec3 from, glm::vec3 direction, float tMin = SELF_INTERSECTION_EPSILON, float tMax = FLT_MAX);
 	Ray();
-#if __AABB_TESTING
+
 	/// <summary> 
-	/// Updates ray AABB intersection testing data. This should be called whenever the ray is altered.
+	/// Updates ray AABB intersection testing data. This should be called whenever the ray is altered
+	/// (i.e. whenever from or direction is changed).
 	/// </summary>
 	void Update();
 
 	// ------------------------------------------------------
-	// Extra data needed for fast AAABB intersection testing.
+	// Extra data needed for fast AABB intersection testing.
+	// The data is expressed in a mirrored coordinate system in which every component of 
+	// the direction is non-positive. This way AABB::RayIntersection only has to handle one 
+	// of the 26 ray classifications described by Eisemann et al.
 	// ------------------------------------------------------
-	float idirx, idiry, idirz; // TODO: Change name of these to something more intuitive.
-	float cxy, cxz, cyx, cyz, czx, czy; // TODO: Change name of these to something more intuitive.
-	float ibyj, jbyi, jbyk, kbyj, ibyk, kbyi; // TODO: Change name of these to something more intuitive.
+	/// <summary> Whether each axis is mirrored (which is the case when the direction is +0 or positive along it). </summary>
+	bool mirrored[3];
+
+	/// <summary> The ray origin in the mirrored coordinate system. </summary>
+	glm::vec3 mirroredFrom;
+
+	/// <summary> The inverse of the direction in the mirrored coordinate system. </summary>
+	glm::vec3 mirroredInverseDirection;
+
+	/// <summary> Slopes of the ray projected onto the coordinate planes, e.g. slopeYX = dy / dx. </summary>
+	float slopeYX, slopeXY, slopeZY, slopeYZ, slopeZX, slopeXZ;
+
+	/// <summary> 
+	/// Intercepts of the projected rays, e.g. the projected ray in the xy-plane is y = slopeYX * x + interceptXY.
+	/// </summary>
+	float interceptXY, interceptYX, interceptYZ, interceptZY, interceptXZ, interceptZX;
 	// ------------------------------------------------------
-#endif
-};
\ No newline at end of file
+};
@@ -0,0 +1,92 @@
+#include "RayPacket.h"
+
+#include <cassert>
+#include <xmmintrin.h>
+
+namespace {
+	// Direction components closer to 0 than this are moved away from 0, which keeps the slab distances finite.
+	const float MIN_DIRECTION = 1e-20f;
+
+	// The far slab distance is scaled by this to make up for rounding errors (see Ize, Robust BVH Ray Traversal).
+	const float FAR_SCALE = 1.0f + 4.0f * FLT_EPSILON;
+}
+
+void RayPacket::Add(const Ray & ray) {
+	assert(size < MAX_SIZE);
+	rays[size] = ray;
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		const float direction = ray.direction[axis];
+		from[axis][size] = ray.from[axis];
+		inverseDirection[axis][size] = 1.0f / (direction < 0.0f ? glm::min(direction, -MIN_DIRECTION) : glm::max(direction, MIN_DIRECTION));
+	}
+	tMax[size] = ray.tMax;
+	++size;
+}
+
+void RayPacket::UpdateIntervals(Mask mask) {
+	for (unsigned int i = 0; i < size; ++i) {
+		if (Contains(mask, i)) {
+			tMax[i] = rays[i].tMax;
+		}
+	}
+}
+
+bool RayPacket::CheckSignedZeroDirections() {
+	const AABB aabb(glm::vec3(-1.0f), glm::vec3(1.0f));
+	RayPacket packet;
+	bool expectedHits[MAX_SIZE];
+	for (unsigned int axis = 0; axis < 3; ++axis) {
+		for (unsigned int rayIndex = 0; rayIndex < 16; ++rayIndex) {
+			// Towards the AABB along the axis, either through it or past it, with every sign of the other two zeros.
+			const float sign = (rayIndex & 1) ? -1.0f : 1.0f;
+			const bool hit = (rayIndex & 2) != 0;
+			glm::vec3 from(hit ? 0.5f : 2.0f), direction;
+			from[axis] = -3.0f * sign;
+			direction[axis] = sign;
+			direction[(axis + 1) % 3] = (rayIndex & 4) ? -0.0f : 0.0f;
+			direction[(axis + 2) % 3] = (rayIndex & 8) ? -0.0f : 0.0f;
+			expectedHits[packet.size] = hit;
+			packet.Add(Ray(from, direction));
+		}
+	}
+
+	const Mask hitMask = packet.IntersectAABB(aabb, packet.GetMask());
+	for (unsigned int i = 0; i < packet.size; ++i) {
+		if (aabb.RayIntersection(packet.rays[i]) != expectedHits[i] || Contains(hitMask, i) != expectedHits[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+RayPacket::Mask RayPacket::IntersectAABB(const AABB & aabb, Mask mask) const {
+	// The slab test below would accept empty AABBs (e.g. of disabled render groups), since it sorts the slab distances.
+	if (aabb.minimum.x > aabb.maximum.x || aabb.minimum.y > aabb.maximum.y || aabb.minimum.z > aabb.maximum.z) {
+		return 0;
+	}
+
+	const __m128 minimum[3] = { _mm_set1_ps(aabb.minimum.x), _mm_set1_ps(aabb.minimum.y), _mm_set1_ps(aabb.minimum.z) };
+	const __m128 maximum[3] = { _mm_set1_ps(aabb.maximum.x), _mm_set1_ps(aabb.maximum.y), _mm_set1_ps(aabb.maximum.z) };
+	const __m128 farScale = _mm_set1_ps(FAR_SCALE);
+
+	Mask hitMask = 0;
+	for (unsigned int i = 0; i < size; i += 4) {
+		if (((mask >> i) & 0xf) == 0) {
+			continue;
+		}
+
+		// Slab test. AABB::RayIntersection reports entry distances from 0, so the interval starts at 0 rather than tMin.
+		__m128 entry = _mm_setzero_ps();
+		__m128 exit = _mm_loadu_ps(&tMax[i]);
+		for (unsigned int axis = 0; axis < 3; ++axis) {
+			const __m128 rayFrom = _mm_loadu_ps(&from[axis][i]);
+			const __m128 rayInverseDirection = _mm_loadu_ps(&inverseDirection[axis][i]);
+			const __m128 t0 = _mm_mul_ps(_mm_sub_ps(minimum[axis], rayFrom), rayInverseDirection);
+			const __m128 t1 = _mm_mul_ps(_mm_sub_ps(maximum[axis], rayFrom), rayInverseDirection);
+			entry = _mm_max_ps(entry, _mm_min_ps(t0, t1));
+			exit = _mm_min_ps(exit, _mm_mul_ps(_mm_max_ps(t0, t1), farScale));
+		}
+		hitMask |= static_cast<Mask>(_mm_movemask_ps(_mm_cmple_ps(entry, exit))) << i;
+	}
+	return hitMask & mask;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "AABB.h"
+#include "Ray.h"
+
+/// <summary>
+/// A packet of up to MAX_SIZE coherent rays (e.g. the primary rays through the strata of a pixel) which are
+/// traced together, so that the rays share node visits. The rays are also stored as a structure of arrays,
+/// so that a node AABB is tested against 4 rays at a time using SSE.
+/// </summary>
+class RayPacket {
+public:
+	/// <summary> The maximum number of rays in a packet (8x8 strata). </summary>
+	static const unsigned int MAX_SIZE = 64;
+
+	/// <summary> A set of rays in the packet: bit i is set if rays[i] is in the set. </summary>
+	typedef unsigned long long Mask;
+
+	/// <summary>
+	/// The rays. Intersection tests update rays[i].tMax, after which UpdateIntervals must be called
+	/// before the next AABB test.
+	/// </summary>
+	Ray rays[MAX_SIZE];
+
+	/// <summary> The number of rays in the packet. </summary>
+	unsigned int size = 0;
+
+	/// <summary> Removes all rays from the packet. </summary>
+	void Clear() { size = 0; }
+
+	/// <summary> Adds a ray to the packet. The packet must not be full. </summary>
+	void Add(const Ray & ray);
+
+	/// <summary> Returns true if the packet holds MAX_SIZE rays. </summary>
+	bool IsFull() const { return size == MAX_SIZE; }
+
+	/// <summary> Returns true if rays[i] is in the given set. </summary>
+	static bool Contains(Mask mask, unsigned int i) { return ((mask >> i) & 1) != 0; }
+
+	/// <summary> Returns the set of all rays in the packet. </summary>
+	Mask GetMask() const { return size == MAX_SIZE ? ~Mask(0) : (Mask(1) << size) - 1; }
+
+	/// <summary> Copies the ray intervals of the given rays into the packed data after their tMax has changed. </summary>
+	void UpdateIntervals(Mask mask);
+
+	/// <summary>
+	/// Returns the subset of the given rays which enter the AABB within their ray interval. Conservative:
+	/// every ray for which AABB::RayIntersection reports an entry within the interval is included.
+	/// </summary>
+	Mask IntersectAABB(const AABB & aabb, Mask mask) const;
+
+	/// <summary>
+	/// Casts axis-aligned rays, whose zero direction components are +0 or -0, at an AABB. Returns false if
+	/// AABB::RayIntersection or IntersectAABB gets any of them wrong.
+	/// </summary>
+	static bool CheckSignedZeroDirections();
+
+private:
+	/// <summary> The packed ray data, padded to a multiple of 4 rays. </summary>
+	float from[3][MAX_SIZE], inverseDirection[3][MAX_SIZE], tMax[MAX_SIZE];
+};
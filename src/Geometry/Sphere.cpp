@@ -9,7 +9,7 @@
 using namespace glm;
 
 Sphere::Sphere(vec3 _center, float _radius) :
-	Primitive(), center(_center), radius(_radius) {
+	Primitive(Type::SPHERE), center(_center), radius(_radius) {
 	glm::vec3 minimum(center.x - radius, center.y - radius, center.z - radius);
 	glm::vec3 maximum(center.x + radius, center.y + radius, center.z + radius);
 	axisAlignedBoundingBox = AABB(minimum, maximum);
@@ -19,15 +19,21 @@ glm::vec3 Sphere::GetNormal(const glm::vec3 & position) const { return glm::norm
 
 glm::vec3 Sphere::GetCenter() const { return center; }
 
-glm::vec3 Sphere::GetRandomPositionOnSurface() const {
-	int direction = (rand() & 1) == 0 ? -1 : 1;
-	return center + radius * Utility::Math::CosineWeightedHemisphereSampleDirection(glm::vec3(0, 0, direction));
+glm::vec3 Sphere::GetRandomPositionOnSurface(Utility::Sampler & sampler) const {
+	int direction = sampler.NextUInt(2) == 0 ? -1 : 1;
+	return center + radius * Utility::Math::CosineWeightedHemisphereSampleDirection(glm::vec3(0, 0, direction), sampler);
 }
 
 const AABB & Sphere::GetAxisAlignedBoundingBox() const {
 	return axisAlignedBoundingBox;
 }
 
+void Sphere::Translate(const glm::vec3 & offset) {
+	center += offset;
+	axisAlignedBoundingBox.minimum += offset;
+	axisAlignedBoundingBox.maximum += offset;
+}
+
 bool Sphere::RayIntersection(const Ray & ray, float & intersectionDistance) const {
 #if __BACK_FACE_CULLING
 	if (dot(-ray.direction, GetNormal(ray.from)) < FLT_EPSILON) {
@@ -42,10 +48,10 @@ bool Sphere::RayIntersection(const Ray & ray, float & intersectionDistance) cons
 		return false;
 	}
 	d = sqrt(d);
-	float t1 = -0.5f * u + d;
-	float t2 = -0.5f * u - d;
-	if (t1 < FLT_EPSILON) { t1 = t2; }
-	if (t2 < FLT_EPSILON) { t2 = t1; }
-	intersectionDistance = glm::min<float>(t1, t2);
-	return intersectionDistance > FLT_EPSILON;
+
+	// Use the closest root inside the ray interval (t1 <= t2).
+	const float t1 = -0.5f * u - d;
+	const float t2 = -0.5f * u + d;
+	intersectionDistance = t1 > ray.tMin ? t1 : t2;
+	return intersectionDistance > ray.tMin && intersectionDistance < ray.tMax;
 }
@@ -5,7 +5,7 @@
 #include "Ray.h"
 
 /// <summary> Describes a 3D sphere. </summary>
-class Sphere : public Primitive {
+class Sphere final : public Primitive {
 public:
 	glm::vec3 center;
 	float radius;
@@ -14,8 +14,9 @@ public:
 
 	glm::vec3 GetNormal(const glm::vec3 & position) const override;
 	glm::vec3 GetCenter() const override;
-	glm::vec3 GetRandomPositionOnSurface() const override;
+	glm::vec3 GetRandomPositionOnSurface(Utility::Sampler & sampler) const override;
 	const AABB & GetAxisAlignedBoundingBox() const override;
+	void Translate(const glm::vec3 & offset) override;
 
 	/// <summary> 
 	/// Computes the ray intersection point between a ray and this sphere.
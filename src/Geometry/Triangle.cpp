@@ -10,7 +10,7 @@
 
 // Default constructor.
 Triangle::Triangle(glm::vec3 _v1, glm::vec3 _v2, glm::vec3 _v3, glm::vec3 _normal) :
-	vertices{ _v1, _v2, _v3 }, normal(_normal) {
+	Primitive(Type::TRIANGLE), vertices{ _v1, _v2, _v3 }, normal(_normal) {
 
 	const auto & v0 = vertices[0];
 	const auto & v1 = vertices[1];
@@ -39,14 +39,15 @@ glm::vec3 Triangle::GetCenter() const {
 	return (vertices[0] + vertices[1] + vertices[2]) / 3.0f;
 }
 
-glm::vec3 Triangle::GetRandomPositionOnSurface() const {
+glm::vec3 Triangle::GetRandomPositionOnSurface(Utility::Sampler & sampler) const {
 #if __TRIANGLE_SAMPLE_REJECTION // Triangle rejection has "perfect" uniform sampling, but is not as elegant (and requires more work)...
 	glm::vec3 v;
 	float quadArea = glm::length(glm::cross(vertices[0] - vertices[1], vertices[0] - vertices[2]));
 	float a1, a2, a3;
 	do {
-		float rand1 = rand() / (float)RAND_MAX;
-		float rand2 = rand() / (float)RAND_MAX;
+		const glm::vec2 sample = sampler.Next2D();
+		float rand1 = sample.x;
+		float rand2 = sample.y;
 		a1 = glm::length(glm::cross(v - vertices[0], v - vertices[1]));
 		a2 = glm::length(glm::cross(v - vertices[1], v - vertices[2]));
 		a3 = glm::length(glm::cross(v - vertices[2], v - vertices[0]));
@@ -56,7 +57,8 @@ glm::vec3 Triangle::GetRandomPositionOnSurface() const {
 #else
 	glm::vec3 v1 = vertices[1] - vertices[0];
 	glm::vec3 v2 = vertices[2] - vertices[0];
-	glm::vec3 randomRectanglePoint = (rand() / (float)RAND_MAX ) * v1 + (rand() / (float)RAND_MAX) * v2;
+	const glm::vec2 sample = sampler.Next2D();
+	glm::vec3 randomRectanglePoint = sample.x * v1 + sample.y * v2;
 	glm::vec3 pointProjectedOnV1V2Line = glm::closestPointOnLine(randomRectanglePoint, v1, v2);
 	// If its further to the random point than to the line point then we're outside the triangle
 	if (glm::length(randomRectanglePoint) > glm::length(pointProjectedOnV1V2Line)) {
@@ -71,6 +73,14 @@ const AABB & Triangle::GetAxisAlignedBoundingBox() const {
 	return axisAlignedBoundingBox;
 }
 
+void Triangle::Translate(const glm::vec3 & offset) {
+	for (auto & vertex : vertices) {
+		vertex += offset;
+	}
+	axisAlignedBoundingBox.minimum += offset;
+	axisAlignedBoundingBox.maximum += offset;
+}
+
 // Implementation using the Mller-Trumbore (MT) ray intersection algorithm.
 bool Triangle::RayIntersection(const Ray & ray, float & intersectionDistance) const {
 #if __BACK_FACE_CULLING
@@ -100,5 +110,5 @@ bool Triangle::RayIntersection(const Ray & ray, float & intersectionDistance) co
 	}
 
 	intersectionDistance = inv_den * glm::dot(E2, Q);
-	return intersectionDistance > FLT_EPSILON;
+	return intersectionDistance > ray.tMin && intersectionDistance < ray.tMax;
 }
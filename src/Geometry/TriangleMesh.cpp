@@ -0,0 +1,89 @@
+#include "TriangleMesh.h"
+
+#include <cstdlib>
+#include <cfloat>
+
+glm::vec3 TriangleMesh::GetNormal(unsigned int triangle, const glm::vec3 & position) const {
+	const glm::vec3 & v0 = GetVertex(triangle, 0);
+	const glm::vec3 E1 = GetVertex(triangle, 1) - v0;
+	const glm::vec3 E2 = GetVertex(triangle, 2) - v0;
+	if (normals.empty()) {
+		return glm::normalize(glm::cross(E1, E2));
+	}
+
+	// Barycentric coordinates of the position (projected onto the triangle plane).
+	const glm::vec3 V = position - v0;
+	const float d11 = glm::dot(E1, E1);
+	const float d12 = glm::dot(E1, E2);
+	const float d22 = glm::dot(E2, E2);
+	const float dV1 = glm::dot(V, E1);
+	const float dV2 = glm::dot(V, E2);
+	const float inverseDenominator = 1.0f / (d11 * d22 - d12 * d12);
+	const float b1 = (d22 * dV1 - d12 * dV2) * inverseDenominator;
+	const float b2 = (d11 * dV2 - d12 * dV1) * inverseDenominator;
+
+	const glm::uvec3 & index = indices[triangle];
+	return glm::normalize((1.0f - b1 - b2) * normals[index[0]] + b1 * normals[index[1]] + b2 * normals[index[2]]);
+}
+
+glm::vec3 TriangleMesh::GetRandomPositionOnSurface(unsigned int triangle, Utility::Sampler & sampler) const {
+	// Uniform sampling by warping the unit square onto the triangle.
+	const glm::vec2 sample = sampler.Next2D();
+	const float squareRootRand1 = glm::sqrt(sample.x);
+	const float b1 = squareRootRand1 * (1.0f - sample.y);
+	const float b2 = squareRootRand1 * sample.y;
+	const glm::vec3 & v0 = GetVertex(triangle, 0);
+	return v0 + b1 * (GetVertex(triangle, 1) - v0) + b2 * (GetVertex(triangle, 2) - v0);
+}
+
+AABB TriangleMesh::GetAxisAlignedBoundingBox(unsigned int triangle) const {
+	const glm::vec3 & v0 = GetVertex(triangle, 0);
+	const glm::vec3 & v1 = GetVertex(triangle, 1);
+	const glm::vec3 & v2 = GetVertex(triangle, 2);
+	return AABB(glm::min(v0, glm::min(v1, v2)), glm::max(v0, glm::max(v1, v2)));
+}
+
+AABB TriangleMesh::GetAxisAlignedBoundingBox() const {
+	glm::vec3 minimum = glm::vec3(FLT_MAX);
+	glm::vec3 maximum = glm::vec3(-FLT_MAX);
+	for (const auto & vertex : vertices) {
+		minimum = glm::min(minimum, vertex);
+		maximum = glm::max(maximum, vertex);
+	}
+	return AABB(minimum, maximum);
+}
+
+void TriangleMesh::Translate(const glm::vec3 & offset) {
+	for (auto & vertex : vertices) {
+		vertex += offset;
+	}
+}
+
+// The same Mller-Trumbore test as Triangle::RayIntersection (same operations in the same order).
+bool TriangleMesh::RayIntersection(unsigned int triangle, const Ray & ray, float & intersectionDistance) const {
+	const glm::vec3 & v0 = GetVertex(triangle, 0);
+	const glm::vec3 E1 = GetVertex(triangle, 1) - v0;
+	const glm::vec3 E2 = GetVertex(triangle, 2) - v0;
+	const glm::vec3 P = glm::cross(ray.direction, E2);
+	const glm::vec3 T = ray.from - v0;
+
+	const float inv_den = 1.0f / glm::dot(E1, P);
+
+	float u = inv_den * glm::dot(T, P);
+	if (u < 0.0f || u > 1.0f) {
+		return false; // Didn't hit.
+	}
+
+	const glm::vec3 Q = glm::cross(T, E1);
+	const float v = inv_den * glm::dot(ray.direction, Q);
+	if (v < 0.0f || u + v > 1.0f) {
+		return false; // Didn't hit.
+	}
+
+	intersectionDistance = inv_den * glm::dot(E2, Q);
+	return intersectionDistance > ray.tMin && intersectionDistance < ray.tMax;
+}
+
+size_t TriangleMesh::GetMemoryUsage() const {
+	return vertices.capacity() * sizeof(glm::vec3) + normals.capacity() * sizeof(glm::vec3) + indices.capacity() * sizeof(glm::uvec3);
+}
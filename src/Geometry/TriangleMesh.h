@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vector>
+
+#include "glm.hpp"
+#include "AABB.h"
+#include "Ray.h"
+#include "../Utility/Sampler.h"
+
+/// <summary>
+/// An indexed triangle mesh: the triangles share a vertex buffer and are stored as 32-bit index triples into it,
+/// with optional per-vertex normals. Unlike Triangle, a mesh triangle doesn't store its own vertices, normal or AABB,
+/// so a mesh uses a fraction of the memory of the same triangles as primitives. The triangles of a mesh are the
+/// primitives of a render group (see RenderGroup::triangleMesh), indexed by their position in indices.
+/// </summary>
+class TriangleMesh {
+public:
+	/// <summary> The shared vertices. </summary>
+	std::vector<glm::vec3> vertices;
+
+	/// <summary>
+	/// Optional per-vertex normals, either empty or one normal per vertex. If empty, the triangles are flat shaded
+	/// with the normal of their counter-clockwise winding, cross(v1 - v0, v2 - v0).
+	/// </summary>
+	std::vector<glm::vec3> normals;
+
+	/// <summary> The vertex indices of every triangle. </summary>
+	std::vector<glm::uvec3> indices;
+
+	/// <summary> Returns the number of triangles in the mesh. </summary>
+	unsigned int GetTriangleCount() const { return static_cast<unsigned int>(indices.size()); }
+
+	/// <summary> Returns the given vertex (0, 1 or 2) of a triangle. </summary>
+	const glm::vec3 & GetVertex(unsigned int triangle, unsigned int vertex) const { return vertices[indices[triangle][vertex]]; }
+
+	/// <summary>
+	/// Returns the normal of a triangle at the given position on it, interpolated from the vertex normals
+	/// if the mesh has any.
+	/// </summary>
+	glm::vec3 GetNormal(unsigned int triangle, const glm::vec3 & position) const;
+
+	/// <summary> Returns a uniformly distributed random position on a triangle. </summary>
+	glm::vec3 GetRandomPositionOnSurface(unsigned int triangle, Utility::Sampler & sampler) const;
+
+	/// <summary> Returns the AABB of a triangle. </summary>
+	AABB GetAxisAlignedBoundingBox(unsigned int triangle) const;
+
+	/// <summary> Returns the AABB of all vertices. </summary>
+	AABB GetAxisAlignedBoundingBox() const;
+
+	/// <summary>
+	/// Moves all vertices by the given offset. Refit the acceleration structures afterwards
+	/// (see Scene::RefitAccelerationStructures).
+	/// </summary>
+	void Translate(const glm::vec3 & offset);
+
+	/// <summary>
+	/// Computes the intersection between a ray and a triangle. Gives the same results as Triangle::RayIntersection
+	/// for a triangle with the same vertices. Returns true if there is an intersection within the ray interval.
+	/// </summary>
+	/// <param name='intersectionDistance'> OUT: The distance to the intersection point (if there is an intersection). </param>
+	bool RayIntersection(unsigned int triangle, const Ray & ray, float & intersectionDistance) const;
+
+	/// <summary> Returns the number of bytes used by the vertex, normal and index buffers. </summary>
+	size_t GetMemoryUsage() const;
+};
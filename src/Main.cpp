@@ -17,6 +17,7 @@
 
 // Other.
 #include "Utility\Math.h"
+#include "Utility\Benchmark.h"
 #include "Scene\SceneObjectFactory.h"
 
 namespace {
@@ -45,16 +46,48 @@ int main() {
 	cui PIXELS_W = 400;
 	cui PIXELS_H = 400;
 	cui RAYS_PER_PIXEL = 8;
+	const bool RENDER_PROGRESSIVELY = false; // Adds a ray to every pixel per pass until RAYS_PER_PIXEL or a limit below is reached.
+	const double PROGRESSIVE_TIME_BUDGET = 10.0; // In seconds, 0 for no limit.
+	const float PROGRESSIVE_NOISE_THRESHOLD = 0.0f; // See Camera::GetNoise, 0 for no limit.
+	const double PROGRESSIVE_PREVIEW_INTERVAL = 2.0; // Seconds between the preview images, 0 for no previews.
+	const bool RENDER_ADAPTIVELY = false; // Spends more rays on the pixels which are still noisy, instead of RAYS_PER_PIXEL.
+	cui ADAPTIVE_MIN_RAYS_PER_PIXEL = 4;
+	cui ADAPTIVE_MAX_RAYS_PER_PIXEL = 64;
+	const float ADAPTIVE_TARGET_RELATIVE_ERROR = 0.05f; // See Pixel::GetRelativeError.
 	cui MAX_RAY_DEPTH = 5;
 	cui BOUNCES_PER_HIT = 1;
 	cui PHOTONS_PER_LIGHT_SOURCE = 100000;
 	cui PHOTON_MAP_DEPTH = 4;
 	const RendererType RENDERER_TYPE = RendererType::PHOTON_MAP;
+	cui MONTE_CARLO_FEATURES = RenderFeatures::MONTE_CARLO_DEFAULTS; // Trace kernel options, see RenderFeatures.
+	cui PHOTON_MAP_FEATURES = RenderFeatures::PHOTON_MAP_DEFAULTS;
+	const Utility::Sampler::Type SAMPLER_TYPE = Utility::Sampler::Type::SOBOL; // RANDOM, HALTON, SOBOL or BLUE_NOISE.
+	cui TILE_SIZE = 16; // The image is rendered in tiles of TILE_SIZE x TILE_SIZE pixels.
+	const Camera::TileOrder TILE_ORDER = Camera::TileOrder::HILBERT; // SCANLINE, HILBERT or SPIRAL.
+	const AccelerationStructure::Type ACCELERATION_STRUCTURE_TYPE = AccelerationStructure::Type::BVH;
+	const BVH::BuildQuality BUILD_QUALITY = BVH::BuildQuality::STANDARD; // PREVIEW builds fastest, FINAL traces fastest.
+	cui OCTREE_MAX_DEPTH = Octree::DEFAULT_MAX_DEPTH;
+	cui OCTREE_MAX_LEAF_SIZE = Octree::DEFAULT_MAX_LEAF_SIZE;
+	const bool RUN_ACCELERATION_STRUCTURE_BENCHMARK = false; // Benchmarks ray casting instead of rendering.
+
+	// --------------------------------------
+	// Acceleration structure benchmark.
+	// --------------------------------------
+	if (RUN_ACCELERATION_STRUCTURE_BENCHMARK) {
+		Utility::Benchmark::RunAccelerationStructureBenchmark(std::cout);
+		std::cout << "Benchmark finished... press any key to exit." << std::endl;
+		std::cin.get();
+		return 0;
+	}
 
 	// --------------------------------------
 	// Create the scene.
 	// --------------------------------------
 	Scene scene;
+	scene.accelerationStructureSettings.type = ACCELERATION_STRUCTURE_TYPE;
+	scene.accelerationStructureSettings.buildQuality = BUILD_QUALITY;
+	scene.accelerationStructureSettings.octreeMaxDepth = OCTREE_MAX_DEPTH;
+	scene.accelerationStructureSettings.octreeMaxLeafSize = OCTREE_MAX_LEAF_SIZE;
 	std::cout << "Creating the scene ..." << std::endl;
 
 	// Coordinate system relative to camera plane.
@@ -87,6 +120,9 @@ int main() {
 	scene.Initialize();
 	auto startTime = std::chrono::high_resolution_clock::now();
 	Camera camera(PIXELS_W, PIXELS_H);
+	camera.samplerType = SAMPLER_TYPE;
+	camera.tileSize = TILE_SIZE;
+	camera.tileOrder = TILE_ORDER;
 
 	// --------------------------------------
 	// Render scene.
@@ -94,10 +130,10 @@ int main() {
 	Renderer * renderer = nullptr;
 	switch (RENDERER_TYPE) {
 	case RendererType::MONTE_CARLO:
-		renderer = new MonteCarloRenderer(scene, MAX_RAY_DEPTH);
+		renderer = CreateMonteCarloRenderer(scene, MAX_RAY_DEPTH, MONTE_CARLO_FEATURES);
 		break;
 	case RendererType::PHOTON_MAP:
-		renderer = new PhotonMapRenderer(scene, MAX_RAY_DEPTH, BOUNCES_PER_HIT, PHOTONS_PER_LIGHT_SOURCE, PHOTON_MAP_DEPTH);
+		renderer = CreatePhotonMapRenderer(scene, MAX_RAY_DEPTH, BOUNCES_PER_HIT, PHOTONS_PER_LIGHT_SOURCE, PHOTON_MAP_DEPTH, PHOTON_MAP_FEATURES);
 		break;
 	case RendererType::PHOTON_MAP_VISUALIZATION:
 		renderer = new PhotonMapVisualizer(scene, PHOTONS_PER_LIGHT_SOURCE, PHOTON_MAP_DEPTH);
@@ -107,7 +143,24 @@ int main() {
 		std::cerr << "Failed to initialize renderer." << std::endl;
 		return 0;
 	}
-	camera.Render(scene, *renderer, RAYS_PER_PIXEL, glm::vec3(-7, 0, 0));
+	if (RENDER_PROGRESSIVELY) {
+		Camera::ProgressiveSettings progressiveSettings;
+		progressiveSettings.maxRaysPerPixel = RAYS_PER_PIXEL;
+		progressiveSettings.timeBudget = PROGRESSIVE_TIME_BUDGET;
+		progressiveSettings.noiseThreshold = PROGRESSIVE_NOISE_THRESHOLD;
+		progressiveSettings.previewInterval = PROGRESSIVE_PREVIEW_INTERVAL;
+		camera.RenderProgressive(scene, *renderer, progressiveSettings, glm::vec3(-7, 0, 0));
+	}
+	else if (RENDER_ADAPTIVELY) {
+		Camera::AdaptiveSettings adaptiveSettings;
+		adaptiveSettings.minRaysPerPixel = ADAPTIVE_MIN_RAYS_PER_PIXEL;
+		adaptiveSettings.maxRaysPerPixel = ADAPTIVE_MAX_RAYS_PER_PIXEL;
+		adaptiveSettings.targetRelativeError = ADAPTIVE_TARGET_RELATIVE_ERROR;
+		camera.RenderAdaptive(scene, *renderer, adaptiveSettings, glm::vec3(-7, 0, 0));
+	}
+	else {
+		camera.Render(scene, *renderer, RAYS_PER_PIXEL, glm::vec3(-7, 0, 0));
+	}
 
 	// --------------------------------------
 	// Finalize.
@@ -133,15 +186,36 @@ int main() {
 	out << "-- RENDERING SETTINGS --" << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Rendering mode:" << renderer->RENDERER_NAME << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Dimensions:" << PIXELS_W << "x" << PIXELS_H << " pixels. " << std::endl;
-	out << std::setw(COL_WIDTH) << std::left << "Rays per pixel:" << RAYS_PER_PIXEL << std::endl;
+	const double raysPerPixel = camera.GetRayCount() / (double)(PIXELS_W * PIXELS_H);
+	out << std::setw(COL_WIDTH) << std::left << "Rays per pixel:" << raysPerPixel << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Max ray depth:" << MAX_RAY_DEPTH << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Bounces per hit:" << BOUNCES_PER_HIT << std::endl;
+	out << std::endl << "-- ACCELERATION STRUCTURE --" << std::endl;
+	const auto accelerationStatistics = scene.GetAccelerationStructureStatistics();
+	const BVH::Statistics & top = accelerationStatistics.topLevel;
+	const BVH::Statistics & bottom = accelerationStatistics.bottomLevel;
+	out << std::setw(COL_WIDTH) << std::left << "Type:" << AccelerationStructure::GetTypeName(ACCELERATION_STRUCTURE_TYPE) << std::endl;
+	if (ACCELERATION_STRUCTURE_TYPE == AccelerationStructure::Type::OCTREE) {
+		out << std::setw(COL_WIDTH) << std::left << "Octree max depth:" << OCTREE_MAX_DEPTH << std::endl;
+		out << std::setw(COL_WIDTH) << std::left << "Octree max leaf size:" << OCTREE_MAX_LEAF_SIZE << std::endl;
+	}
+	else {
+		out << std::setw(COL_WIDTH) << std::left << "Build quality:" << AccelerationStructure::GetBuildQualityName(BUILD_QUALITY) << std::endl;
+	}
+	out << std::setw(COL_WIDTH) << std::left << "Build time:" << accelerationStatistics.buildSeconds << " seconds." << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Memory:" << scene.GetAccelerationStructureMemoryUsage() / 1024.0 << " KB." << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Nodes (top / groups):" << top.nodeCount << " / " << bottom.nodeCount << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Leaves (top / groups):" << top.leafCount << " / " << bottom.leafCount << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Max depth (top / groups):" << top.maxDepth << " / " << bottom.maxDepth << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Avg leaf size (top / groups):" << top.averageLeafSize << " / " << bottom.averageLeafSize << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Max leaf size (top / groups):" << top.maxLeafSize << " / " << bottom.maxLeafSize << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "SAH cost (top / groups):" << top.sahCost << " / " << bottom.sahCost << std::endl;
 	out << std::endl << "-- PHOTON MAP SETTINGS --" << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Photons per light source:" << PHOTONS_PER_LIGHT_SOURCE << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Photon map depth:" << PHOTON_MAP_DEPTH << std::endl;
 	out << std::endl << "-- RENDERING STATISTICS --" << std::endl;
 	out << std::setw(COL_WIDTH) << std::left << "Total time:" << took << " seconds." << std::endl;
-	out << std::setw(COL_WIDTH) << std::left << "Time per pixel ray:" << took / (double)(RAYS_PER_PIXEL * PIXELS_W * PIXELS_H) << " seconds." << std::endl;
+	out << std::setw(COL_WIDTH) << std::left << "Time per pixel ray:" << took / (double)camera.GetRayCount() << " seconds." << std::endl;
 	out.close();
 
 	// --------------------------------------
@@ -1,6 +1,12 @@
 #include "Photon.h"
 
+#include "../Rendering/RenderGroup.h"
+
 Photon::Photon() {}
 
-Photon::Photon(glm::vec3 _position, glm::vec3 _direction, glm::vec3 _color, Primitive * _prim) :
-	position(_position), direction(_direction), color(_color), primitive(_prim) {}
+Photon::Photon(glm::vec3 _position, glm::vec3 _direction, glm::vec3 _color, const RenderGroup * _renderGroup, unsigned int _primitiveIndex) :
+	position(_position), direction(_direction), color(_color), renderGroup(_renderGroup), primitiveIndex(_primitiveIndex) {}
+
+glm::vec3 Photon::GetNormal(const glm::vec3 & position) const {
+	return renderGroup->GetNormal(primitiveIndex, position);
+}
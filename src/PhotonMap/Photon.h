@@ -2,12 +2,12 @@
 
 #include <glm.hpp>
 
-#include "../Geometry/Primitive.h"
+class RenderGroup;
 
 class Photon {
 public:
 	Photon();
-	Photon(glm::vec3 position, glm::vec3 direction, glm::vec3 color, Primitive* primitive);
+	Photon(glm::vec3 position, glm::vec3 direction, glm::vec3 color, const RenderGroup * renderGroup, unsigned int primitiveIndex);
 
 	/// <summary> The direction from where the photon came. </summary>
 	glm::vec3 direction;
@@ -18,6 +18,12 @@ public:
 	/// <summary> The color of the photon. </summary>
 	glm::vec3 color;
 
-	/// <summary> The primitive which the photon is placed on. </summary>
-	Primitive* primitive;
+	/// <summary> The render group which the photon is placed on. </summary>
+	const RenderGroup * renderGroup;
+
+	/// <summary> The index of the primitive (or mesh triangle) in the render group which the photon is placed on. </summary>
+	unsigned int primitiveIndex;
+
+	/// <summary> Returns the surface normal at the given position of the primitive which the photon is placed on. </summary>
+	glm::vec3 GetNormal(const glm::vec3 & position) const;
 };
\ No newline at end of file
@@ -25,6 +25,7 @@ PhotonMap::PhotonMap(const Scene & scene, const unsigned int PHOTONS_PER_LIGHT_S
 	std::vector<Photon> indirectPhotons;
 	std::vector<Photon> shadowPhotons;
 	std::vector<Photon> causticsPhotons;
+	std::vector<Scene::Intersection> shadowIntersections;
 
 	// Calculate max emissivity so that we can normalize photon radiance.
 	float maxEmissivity = 0;
@@ -36,17 +37,18 @@ PhotonMap::PhotonMap(const Scene & scene, const unsigned int PHOTONS_PER_LIGHT_S
 	}
 	const float INV_MAX_EMISSIVITY = 1.0f / maxEmissivity;
 
+	// The photons are shot with independent random numbers and a fixed seed, so the photon map is the same for every render of a scene.
+	Utility::Sampler sampler(Utility::Sampler::Type::RANDOM);
+
 	// Shoot photons from all light sources.
 	for (const auto * lightSource : scene.emissiveRenderGroups) {
 		for (unsigned int j = 0; j < PHOTONS_PER_LIGHT_SOURCE; ++j) {
-			auto * lightPrimitive = lightSource->primitives[rand() % lightSource->primitives.size()];
-
 			// Create a random photon direction from a random light surface position.
-			glm::vec3 randomSurfacePosition = lightPrimitive->GetRandomPositionOnSurface();
-			glm::vec3 surfaceNormal = lightPrimitive->GetNormal(randomSurfacePosition);
+			glm::vec3 surfaceNormal;
+			glm::vec3 randomSurfacePosition = lightSource->GetRandomPositionOnSurface(surfaceNormal, sampler);
 			glm::vec3 randomHemisphereDirection;
-			randomHemisphereDirection = Utility::Math::CosineWeightedHemisphereSampleDirection(surfaceNormal);
-			Ray ray(randomSurfacePosition + 0.01f*surfaceNormal, randomHemisphereDirection);
+			randomHemisphereDirection = Utility::Math::CosineWeightedHemisphereSampleDirection(surfaceNormal, sampler);
+			Ray ray(randomSurfacePosition, randomHemisphereDirection);
 			glm::vec3 photonRadiance = glm::dot(ray.direction, surfaceNormal) * lightSource->material->GetEmissionColor();
 
 			// Iterative deepening.
@@ -60,47 +62,42 @@ PhotonMap::PhotonMap(const Scene & scene, const unsigned int PHOTONS_PER_LIGHT_S
 					// The photon hit something.
 					glm::vec3 intersectionPosition = ray.from + intersectionDistance * ray.direction;
 					const RenderGroup & intersectionRenderGroup = scene.renderGroups[intersectionRenderGroupIndex];
-					Primitive * intersectionPrimitive = intersectionRenderGroup.primitives[intersectionPrimitiveIndex];
 					Material * intersectionMaterial = scene.renderGroups[intersectionRenderGroupIndex].material;
-					glm::vec3 intersectionNormal = intersectionPrimitive->GetNormal(intersectionPosition);
-					glm::vec3 rayReflection = Utility::Math::CosineWeightedHemisphereSampleDirection(intersectionNormal);
+					glm::vec3 intersectionNormal = intersectionRenderGroup.GetNormal(intersectionPrimitiveIndex, intersectionPosition);
+					glm::vec3 rayReflection = Utility::Math::CosineWeightedHemisphereSampleDirection(intersectionNormal, sampler);
 
 					// Indirect photon if deeper than 0.
 					if (k > 0) {
-						Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, intersectionPrimitive);
+						Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, &intersectionRenderGroup, intersectionPrimitiveIndex);
 						indirectPhotons.push_back(photon);
 
 						// Calculate probability for reflection/absorption and use Russian roulette to decide whether to reflect or not.
 						float p = INV_MAX_EMISSIVITY * (photonRadiance.r + photonRadiance.b + photonRadiance.g);
-						float rand = std::rand() / (float)RAND_MAX;
+						float rand = sampler.Next1D();
 						if (rand > p) {
 							break;
 						}
 					}
 					// Otherwise direct and shadow photons.
 					else {
-						Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, intersectionPrimitive);
+						Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, &intersectionRenderGroup, intersectionPrimitiveIndex);
 						directPhotons.push_back(photon);
 
-						// Create a shadow ray.
-						Ray shadowRay(intersectionPosition + 0.01f * ray.direction, ray.direction);
-						Primitive * shadowPrimitive = intersectionPrimitive;
-
-						// While we hit a surface keep casting and add shadow photons.
-						float shadowIntersectionDistance;
-						unsigned int shadowIntersectionRenderGroupIdx, shadowIntersectionPrimitiveIdx;
-						while (scene.RayCast(shadowRay, shadowIntersectionRenderGroupIdx, shadowIntersectionPrimitiveIdx, shadowIntersectionDistance)) {
-							shadowPrimitive = scene.renderGroups[shadowIntersectionRenderGroupIdx].primitives[shadowIntersectionPrimitiveIdx];
-							glm::vec3 shadowIntersectionPosition = shadowRay.from + shadowIntersectionDistance * shadowRay.direction;
-							Photon photon = Photon(shadowIntersectionPosition, ray.direction, glm::vec3(0, 0, 0), shadowPrimitive);
+						// Create a shadow ray and add shadow photons on every surface behind the intersection.
+						// All intersections are found in a single traversal instead of recasting after every hit.
+						const Ray shadowRay(intersectionPosition, ray.direction);
+						scene.RayCastAll(shadowRay, shadowIntersections);
+						for (const Scene::Intersection & shadowIntersection : shadowIntersections) {
+							const RenderGroup * shadowRenderGroup = &scene.renderGroups[shadowIntersection.renderGroupIndex];
+							glm::vec3 shadowIntersectionPosition = shadowRay.from + shadowIntersection.distance * shadowRay.direction;
+							Photon photon = Photon(shadowIntersectionPosition, ray.direction, glm::vec3(0, 0, 0), shadowRenderGroup, shadowIntersection.primitiveIndex);
 							shadowPhotons.push_back(photon);
-							// Update ray position. Direction is the same all the time.
-							shadowRay.from = shadowIntersectionPosition + 0.01f * ray.direction;
 						}
 					}
 					photonRadiance = intersectionMaterial->CalculateDiffuseLighting(ray.direction, rayReflection, intersectionNormal, photonRadiance);
-					ray.from = intersectionPosition + 0.001f*intersectionNormal;
+					ray.from = intersectionPosition;
 					ray.direction = rayReflection;
+					ray.Update();
 				}
 				else {
 					break;
@@ -122,15 +119,13 @@ PhotonMap::PhotonMap(const Scene & scene, const unsigned int PHOTONS_PER_LIGHT_S
 	if (transparentObjects.size() > 0) {
 		for (const auto * lightSource : scene.emissiveRenderGroups) {
 			for (unsigned int j = 0; j < PHOTONS_PER_LIGHT_SOURCE; ++j) {
-				auto * lightPrimitive = lightSource->primitives[rand() % lightSource->primitives.size()];
-
 				// Create a random photon direction from a random light surface position.
-				glm::vec3 randomSurfacePosition = lightPrimitive->GetRandomPositionOnSurface();
-				glm::vec3 surfaceNormal = lightPrimitive->GetNormal(randomSurfacePosition);
+				glm::vec3 surfaceNormal;
+				glm::vec3 randomSurfacePosition = lightSource->GetRandomPositionOnSurface(surfaceNormal, sampler);
 				glm::vec3 randomHemisphereDirection;
-				glm::vec3 posOnSurface = transparentObjects[rand() % transparentObjects.size()]->GetRandomPositionOnSurface();
+				glm::vec3 posOnSurface = transparentObjects[sampler.NextUInt(static_cast<uint32_t>(transparentObjects.size()))]->GetRandomPositionOnSurface(sampler);
 				randomHemisphereDirection = glm::normalize(posOnSurface - randomSurfacePosition);
-				Ray ray(randomSurfacePosition + 0.01f*surfaceNormal, randomHemisphereDirection);
+				Ray ray(randomSurfacePosition, randomHemisphereDirection);
 				glm::vec3 photonRadiance = glm::dot(ray.direction, surfaceNormal) * lightSource->material->GetEmissionColor();
 
 				// Iterative deepening.
@@ -144,31 +139,29 @@ PhotonMap::PhotonMap(const Scene & scene, const unsigned int PHOTONS_PER_LIGHT_S
 						// The photon hit something.
 						glm::vec3 intersectionPosition = ray.from + intersectionDistance * ray.direction;
 						const RenderGroup & intersectionRenderGroup = scene.renderGroups[intersectionRenderGroupIndex];
-						Primitive * intersectionPrimitive = intersectionRenderGroup.primitives[intersectionPrimitiveIndex];
 						Material * intersectionMaterial = scene.renderGroups[intersectionRenderGroupIndex].material;
-						glm::vec3 intersectionNormal = intersectionPrimitive->GetNormal(intersectionPosition);
-						glm::vec3 rayReflection = Utility::Math::CosineWeightedHemisphereSampleDirection(intersectionNormal);
+						glm::vec3 intersectionNormal = intersectionRenderGroup.GetNormal(intersectionPrimitiveIndex, intersectionPosition);
+						glm::vec3 rayReflection = Utility::Math::CosineWeightedHemisphereSampleDirection(intersectionNormal, sampler);
 
 						if (intersectionMaterial->IsTransparent()) {
 							const float n1 = 1.0f;
 							const float n2 = intersectionMaterial->refractiveIndex;
-							glm::vec3 offset = intersectionNormal * 0.1f;
-							Ray refractedRay(intersectionPosition - offset, glm::refract(ray.direction, intersectionNormal, n1 / n2));
+							Ray refractedRay(intersectionPosition, glm::refract(ray.direction, intersectionNormal, n1 / n2));
 
 							// Find out if the ray "exits" the render group anywhere.
 							if (scene.RenderGroupRayCast(refractedRay, intersectionRenderGroupIndex, intersectionPrimitiveIndex, intersectionDistance)) {
-								const auto & refractedRayHitPrimitive = intersectionRenderGroup.primitives[intersectionPrimitiveIndex];
 								const glm::vec3 refractedIntersectionPoint = refractedRay.from + refractedRay.direction * intersectionDistance;
-								const glm::vec3 refractedHitNormal = refractedRayHitPrimitive->GetNormal(refractedIntersectionPoint);
+								const glm::vec3 refractedHitNormal = intersectionRenderGroup.GetNormal(intersectionPrimitiveIndex, refractedIntersectionPoint);
 
 								photonRadiance = intersectionMaterial->CalculateDiffuseLighting(ray.direction, rayReflection, intersectionNormal, photonRadiance);
-								ray.from = refractedIntersectionPoint + refractedRay.direction * 0.001f;
+								ray.from = refractedIntersectionPoint;
 								ray.direction = glm::refract(refractedRay.direction, -refractedHitNormal, n2 / n1);
+								ray.Update();
 							}
 						}
 						// We hit a none refractive surface, store caustics photon if we are not on depth 0.
 						else if (k > 0) {
-							Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, intersectionPrimitive);
+							Photon photon = Photon(intersectionPosition, ray.direction, photonRadiance, &intersectionRenderGroup, intersectionPrimitiveIndex);
 							causticsPhotons.push_back(photon);
 							break;
 						}
@@ -2,24 +2,221 @@
 
 #include <iostream>
 #include <fstream>
-#include <random>
 #include <algorithm>
 #include <chrono>
+#include <string>
 #include <iomanip>
+#include <cmath>
+#include <map>
 
 #include "../Geometry/Ray.h"
+#include "../Geometry/RayPacket.h"
 #include "../Utility/Math.h"
+#include "../Utility/Sampler.h"
 
 #define __LOG_TIME_INTERVAL 3 // In seconds. 
 #define __USE_PARALLELIZATION true // Whether to use multiple threads for rendering or not.
 #define __SQUASH_IMAGE false // Whether to "sqrt" all image intensities.
+#define __USE_RAY_PACKETS true // Whether to cast the primary rays of a pixel together as a ray packet or one at a time.
+#define __SAMPLER_SEED 0 // The seed of the samplers. Every pixel is scrambled differently.
+
+namespace {
+	/// <summary> A rectangle of pixels, [minY, maxY) x [minZ, maxZ). </summary>
+	struct Tile {
+		unsigned int minY, maxY, minZ, maxZ;
+	};
+
+	/// <summary> Returns the position of the d:th cell along a Hilbert curve covering an n x n grid (n is a power of two). </summary>
+	void HilbertCurvePosition(unsigned int n, unsigned int d, unsigned int & x, unsigned int & y) {
+		x = y = 0;
+		for (unsigned int s = 1; s < n; s *= 2) {
+			const unsigned int rx = 1 & (d / 2);
+			const unsigned int ry = 1 & (d ^ rx);
+			if (ry == 0) {
+				if (rx == 1) {
+					x = s - 1 - x;
+					y = s - 1 - y;
+				}
+				std::swap(x, y);
+			}
+			x += s * rx;
+			y += s * ry;
+			d /= 4;
+		}
+	}
 
-Camera::Camera(const unsigned int _width, const unsigned int _height) :
-	width(_width), height(_height) {
-	pixels.assign(width, std::vector<Pixel>(height));
-	discretizedPixels.assign(width, std::vector<glm::u8vec3>(height));
+	/// <summary>
+	/// Splits the image into tiles of (at most) TILE_SIZE x TILE_SIZE pixels, sorted in the given order. The width of
+	/// the tiles is rounded up to whole cache lines of the framebuffer, so no two tiles write to the same cache line.
+	/// </summary>
+	std::vector<Tile> CreateTiles(const unsigned int WIDTH, const unsigned int HEIGHT, const unsigned int TILE_SIZE, const Camera::TileOrder ORDER) {
+		const unsigned int CACHE_LINE_PIXELS = Framebuffer<Pixel>::CACHE_LINE_PIXELS;
+		const unsigned int TILE_WIDTH = (std::max(1u, TILE_SIZE) + CACHE_LINE_PIXELS - 1) / CACHE_LINE_PIXELS * CACHE_LINE_PIXELS;
+		const unsigned int TILE_HEIGHT = std::max(1u, TILE_SIZE);
+		const unsigned int columns = (WIDTH + TILE_WIDTH - 1) / TILE_WIDTH;
+		const unsigned int rows = (HEIGHT + TILE_HEIGHT - 1) / TILE_HEIGHT;
+		const auto createTile = [&](unsigned int column, unsigned int row) {
+			return Tile{ column * TILE_WIDTH, std::min(WIDTH, (column + 1) * TILE_WIDTH), row * TILE_HEIGHT, std::min(HEIGHT, (row + 1) * TILE_HEIGHT) };
+		};
+
+		std::vector<Tile> tiles;
+		tiles.reserve(columns * rows);
+		switch (ORDER) {
+		case Camera::TileOrder::HILBERT: {
+			// Walk a Hilbert curve over the smallest power of two grid which covers the tiles, skipping the cells outside.
+			unsigned int n = 1;
+			while (n < columns || n < rows) {
+				n *= 2;
+			}
+			for (unsigned int d = 0; d < n * n; ++d) {
+				unsigned int column, row;
+				HilbertCurvePosition(n, d, column, row);
+				if (column < columns && row < rows) {
+					tiles.push_back(createTile(column, row));
+				}
+			}
+			break;
+		}
+		case Camera::TileOrder::SPIRAL: {
+			// Sort the tiles by the square ring around the centre that they are on, and by angle within a ring.
+			struct SpiralTile { Tile tile; float ring, angle; };
+			std::vector<SpiralTile> spiralTiles;
+			spiralTiles.reserve(columns * rows);
+			for (unsigned int row = 0; row < rows; ++row) {
+				for (unsigned int column = 0; column < columns; ++column) {
+					const float dx = column + 0.5f - 0.5f * columns, dy = row + 0.5f - 0.5f * rows;
+					spiralTiles.push_back({ createTile(column, row), std::floor(std::max(std::abs(dx), std::abs(dy))), std::atan2(dy, dx) });
+				}
+			}
+			std::stable_sort(spiralTiles.begin(), spiralTiles.end(), [](const SpiralTile & a, const SpiralTile & b) {
+				return a.ring < b.ring || (a.ring == b.ring && a.angle < b.angle);
+			});
+			for (const auto & spiralTile : spiralTiles) {
+				tiles.push_back(spiralTile.tile);
+			}
+			break;
+		}
+		default:
+			for (unsigned int row = 0; row < rows; ++row) {
+				for (unsigned int column = 0; column < columns; ++column) {
+					tiles.push_back(createTile(column, row));
+				}
+			}
+			break;
+		}
+		return tiles;
+	}
+
+	/// <summary> The camera plane, through which the primary rays are shot from the eye. </summary>
+	struct CameraPlane {
+		glm::vec3 eye, c1, c2, c3, c4;
+		glm::vec3 normal;
+		float invWidth, invHeight;
+
+		CameraPlane(const unsigned int WIDTH, const unsigned int HEIGHT, const glm::vec3 & _eye, const glm::vec3 & _c1,
+					const glm::vec3 & _c2, const glm::vec3 & _c3, const glm::vec3 & _c4) :
+			eye(_eye), c1(_c1), c2(_c2), c3(_c3), c4(_c4), normal(-glm::normalize(glm::cross(_c1 - _c2, _c1 - _c4))),
+			invWidth(1.0f / static_cast<float>(WIDTH)), invHeight(1.0f / static_cast<float>(HEIGHT)) { }
+
+		/// <summary> Returns the ray through the position (y, z) + pixelPosition, and the factor of its color. </summary>
+		Ray GetRay(const unsigned int y, const unsigned int z, const glm::vec2 & pixelPosition, float & rayFactor) const {
+			const float ylerp = (y + pixelPosition.x) * invWidth;
+			const float zlerp = (z + pixelPosition.y) * invHeight;
+			const float nx = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.x, c2.x, c3.x, c4.x);
+			const float ny = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.y, c2.y, c3.y, c4.y);
+			const float nz = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.z, c2.z, c3.z, c4.z);
+			Ray ray;
+			ray.from = glm::vec3(nx, ny, nz);
+			ray.direction = glm::normalize(ray.from - eye);
+			ray.Update();
+			rayFactor = std::max(0.0f, glm::dot(ray.from, normal));
+			return ray;
+		}
+	};
+
+	/// <summary> 
+	/// Casts a packet of primary rays through the scene, shades every ray using the renderer and passes the colors
+	/// weighted by the ray factors to addSample. Clears the packet. The rays are the consecutive samples of a
+	/// pixel starting at FIRST_SAMPLE.
+	/// </summary>
+	template<typename AddSample>
+	void CastRayPacket(const Scene & scene, Renderer & renderer, RayPacket & packet, const float rayFactors[RayPacket::MAX_SIZE],
+					   const unsigned int FIRST_SAMPLE, Utility::Sampler & sampler, AddSample & addSample) {
+		Scene::Intersection intersections[RayPacket::MAX_SIZE];
+		const RayPacket::Mask intersectionMask = scene.RayCast(packet, intersections);
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			const Scene::Intersection * intersection = RayPacket::Contains(intersectionMask, i) ? &intersections[i] : nullptr;
+			sampler.StartSample(FIRST_SAMPLE + i, Utility::Sampler::CAMERA_DIMENSIONS);
+			addSample(rayFactors[i] * renderer.GetPixelColor(packet.rays[i], intersection, sampler));
+		}
+		packet.Clear();
+	}
+
+	/// <summary> 
+	/// Shoots the samples [FIRST_SAMPLE, FIRST_SAMPLE + SAMPLES) of the pixel (y, z) through the scene, and passes
+	/// their colors to addSample.
+	/// </summary>
+	template<typename AddSample>
+	void SamplePixel(const Scene & scene, Renderer & renderer, const CameraPlane & cameraPlane, const Utility::Sampler::Type SAMPLER_TYPE,
+					 const unsigned int y, const unsigned int z, const unsigned int FIRST_SAMPLE, const unsigned int SAMPLES, AddSample addSample) {
+
+		// The samples only depend on the pixel, so the image doesn't depend on the thread schedule.
+		Utility::Sampler sampler(SAMPLER_TYPE, __SAMPLER_SEED);
+		sampler.StartPixel(y, z);
+#if __USE_RAY_PACKETS
+		RayPacket packet;
+		float rayFactors[RayPacket::MAX_SIZE];
+#endif
+		for (unsigned int i = FIRST_SAMPLE; i < FIRST_SAMPLE + SAMPLES; ++i) {
+
+			// Calculate camera plane ray position using the first dimension of the sample.
+			sampler.StartSample(i);
+			float rayFactor;
+			const Ray ray = cameraPlane.GetRay(y, z, sampler.Next2D(), rayFactor);
+
+			// Shoot ray.
+#if __USE_RAY_PACKETS
+			rayFactors[packet.size] = rayFactor;
+			packet.Add(ray);
+			if (packet.IsFull()) {
+				CastRayPacket(scene, renderer, packet, rayFactors, i + 1 - packet.size, sampler, addSample);
+			}
+#else
+			addSample(rayFactor * renderer.GetPixelColor(ray, sampler));
+#endif
+		}
+#if __USE_RAY_PACKETS
+		if (packet.size > 0) {
+			CastRayPacket(scene, renderer, packet, rayFactors, FIRST_SAMPLE + SAMPLES - packet.size, sampler, addSample);
+		}
+#endif
+	}
+
+	/// <summary> 
+	/// Calls renderPixel(y, z) for every pixel of the tiles in parallel, and tileRendered(tile) after every tile. The
+	/// tiles are handed out in order to the threads as they become idle.
+	/// </summary>
+	template<typename RenderPixel, typename TileRendered>
+	void RenderTiles(const std::vector<Tile> & tiles, RenderPixel renderPixel, TileRendered tileRendered) {
+		// OMP doesn't allow unsigned int in for parallelized for loop.
+#if __USE_PARALLELIZATION
+#pragma omp parallel for schedule(dynamic, 1) // Parallelize using OMP.
+#endif
+		for (int t = 0; t < static_cast<int>(tiles.size()); ++t) {
+			const Tile & tile = tiles[t];
+			for (unsigned int z = tile.minZ; z < tile.maxZ; ++z) {
+				for (unsigned int y = tile.minY; y < tile.maxY; ++y) {
+					renderPixel(y, z);
+				}
+			}
+			tileRendered(tile);
+		}
+	}
 }
 
+Camera::Camera(const unsigned int _width, const unsigned int _height) :
+	width(_width), height(_height), pixels(_width, _height), discretizedPixels(_width, _height) { }
+
 void Camera::Render(const Scene & scene, Renderer & renderer, const unsigned int RAYS_PER_PIXEL,
 					const glm::vec3 eye, const glm::vec3 c1, const glm::vec3 c2,
 					const glm::vec3 c3, const glm::vec3 c4) {
@@ -27,98 +224,226 @@ void Camera::Render(const Scene & scene, Renderer & renderer, const unsigned int
 	std::cout << std::endl << "Rendering the scene ..." << std::endl;
 	const auto startTime = std::chrono::high_resolution_clock::now();
 
-	// Initalize the random engine.
-	std::random_device rd;
-	std::default_random_engine gen(rd());
-	std::uniform_real_distribution<float> rand(0, 1.0f - FLT_EPSILON);
+	assert(Utility::Sampler::CheckSampleIndices(samplerType));
+	const CameraPlane cameraPlane(width, height, eye, c1, c2, c3, c4);
+	const std::vector<Tile> tiles = CreateTiles(width, height, tileSize, tileOrder);
+	unsigned int renderedPixels = 0;
+	double lastLogTime = 0.0;
 
-	// Precompute inverse widths and heights.
-	const float INV_WIDTH = 1.0f / static_cast<float>(width);
-	const float INV_HEIGHT = 1.0f / static_cast<float>(height);
-	const float INV_RAYS_PER_PIXEL = 1.0f / static_cast<float>(RAYS_PER_PIXEL);
+	// Shoot multiple rays through every pixel.
+	RenderTiles(tiles, [&](unsigned int y, unsigned int z) {
+		Pixel & pixel = pixels(y, z);
+		pixel = Pixel();
+		SamplePixel(scene, renderer, cameraPlane, samplerType, y, z, 0, RAYS_PER_PIXEL, [&](const glm::vec3 & color) { pixel.AddSample(color); });
+	}, [&](const Tile & tile) {
 
-	// Calculate step lengths.
-	const float SQRT_QUADS_PER_PIXEL = sqrtf(static_cast<float>(RAYS_PER_PIXEL));
-	const float INV_SQRT_QUADS_PER_PIXEL = 1.0f / SQRT_QUADS_PER_PIXEL;
-	const float COLUMN_PIXEL_STEP = INV_WIDTH * INV_SQRT_QUADS_PER_PIXEL;
-	const float ROW_PIXEL_STEP = INV_HEIGHT * INV_SQRT_QUADS_PER_PIXEL;
+		// Estimate time left.
+#pragma omp critical(CameraProgress)
+		{
+			renderedPixels += (tile.maxY - tile.minY) * (tile.maxZ - tile.minZ);
+			const auto now = std::chrono::high_resolution_clock::now();
+			const double elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count() * 0.001;
+			if (elapsedTime - lastLogTime > __LOG_TIME_INTERVAL) {
+				lastLogTime = elapsedTime;
+				const double percentageDone = 100 * (renderedPixels / (double)(width * height));
+				const double percentageLeft = (100 - percentageDone);
+				long long estimatedTimeLeft = (long long)llround((elapsedTime / percentageDone) * percentageLeft);
+				long long secs = estimatedTimeLeft % 60;
+				long long mins = (estimatedTimeLeft / 60) % 60;
+				long long hours = ((estimatedTimeLeft / 60) / 60);
+				std::cout << std::setprecision(1) << std::fixed;
+				std::cout << "Rendered " << percentageDone << "%. ";
+				std::cout << "Time left is " << hours << " h., " << mins << "m. and " << secs << "s." << std::endl;
+			}
+		}
+	});
 
-	// Camera plane normal.
-	const glm::vec3 CAMERA_PLANE_NORMAL = -glm::normalize(glm::cross(c1 - c2, c1 - c4));
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+	std::cout << "Rendering finished and took: " << (took / 1000.0) << " seconds." << std::endl << std::endl;
 
-	double timeSinceLastLog = 0.0;
-	// Shoot multiple rays through every pixel.
-	for (unsigned int y = 0; y < width; ++y) {
-		const auto before = std::chrono::high_resolution_clock::now();
+	// Create the final discretized image. Should always be done immediately after the rendering step.
+	CreateImage();
+}
 
-		// OMP doesn't allow unsigned int in for parallelized for loop.
-#if __USE_PARALLELIZATION
-#pragma omp parallel for schedule(static) // Parallelize using OMP.
-#endif
-		for (int z = 0; z < static_cast<int>(height); ++z) {
+void Camera::RenderProgressive(const Scene & scene, Renderer & renderer, const ProgressiveSettings & settings,
+							   const glm::vec3 eye, const glm::vec3 c1, const glm::vec3 c2,
+							   const glm::vec3 c3, const glm::vec3 c4) {
 
-			// Shoot a bunch of rays through the pixel (y, z), and accumulate colors.
-			Ray ray;
-			glm::vec3 colorAccumulator = colorAccumulator = glm::vec3(0, 0, 0);
-			for (float c = 0; c < INV_WIDTH - COLUMN_PIXEL_STEP + FLT_EPSILON; c += COLUMN_PIXEL_STEP) {
-				for (float r = 0; r < INV_HEIGHT - ROW_PIXEL_STEP + FLT_EPSILON; r += ROW_PIXEL_STEP) {
-
-					// Calculate camera plane ray position using stratified sampling.
-					const float ylerp = y * INV_WIDTH + c + rand(gen) * COLUMN_PIXEL_STEP;
-					const float zlerp = z * INV_HEIGHT + r + rand(gen) * ROW_PIXEL_STEP;
-					const float nx = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.x, c2.x, c3.x, c4.x);
-					const float ny = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.y, c2.y, c3.y, c4.y);
-					const float nz = Utility::Math::BilinearInterpolation(ylerp, zlerp, c1.z, c2.z, c3.z, c4.z);
-
-					// Create ray.
-					ray.from = glm::vec3(nx, ny, nz);
-					ray.direction = glm::normalize(ray.from - eye);
-					const float rayFactor = std::max(0.0f, glm::dot(ray.from, CAMERA_PLANE_NORMAL));
-
-					// Shoot ray.
-					colorAccumulator += rayFactor * renderer.GetPixelColor(ray);
-				}
-			}
+	std::cout << std::endl << "Rendering the scene progressively ..." << std::endl;
+	const auto startTime = std::chrono::high_resolution_clock::now();
 
-			// Set pixel color dependent on the traced ray.
-			pixels[y][z].color = INV_RAYS_PER_PIXEL * colorAccumulator;
-		}
+	assert(Utility::Sampler::CheckSampleIndices(samplerType));
+	const CameraPlane cameraPlane(width, height, eye, c1, c2, c3, c4);
+	const std::vector<Tile> tiles = CreateTiles(width, height, tileSize, tileOrder);
+	double lastLogTime = 0.0, lastPreviewTime = 0.0;
+
+	// Every pass adds the next sample to every pixel. All pixels have the same number of samples, which is more
+	// than zero if the camera has been rendered progressively before.
+	std::string stopReason = "the sample limit was reached";
+	while (pixels(0, 0).samples < settings.maxRaysPerPixel) {
+		RenderTiles(tiles, [&](unsigned int y, unsigned int z) {
+			Pixel & pixel = pixels(y, z);
+			SamplePixel(scene, renderer, cameraPlane, samplerType, y, z, pixel.samples, 1, [&](const glm::vec3 & color) { pixel.AddSample(color); });
+		}, [](const Tile &) { });
 
-		// Estimate time left.
 		const auto now = std::chrono::high_resolution_clock::now();
-		const double step = (double)std::chrono::duration_cast<std::chrono::milliseconds>(now - before).count();
-		timeSinceLastLog += step * 0.001;
-		auto elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count();
-		const double percentageDone = 100 * (y / (double)width);
-		const double percentageLeft = (100 - percentageDone);
-		long long estimatedTimeLeft = (long long)llround((elapsedTime / percentageDone) * percentageLeft * 0.001);
-		long long secs = estimatedTimeLeft % 60;
-		long long mins = (estimatedTimeLeft / 60) % 60;
-		long long hours = ((estimatedTimeLeft / 60) / 60);
-		if (timeSinceLastLog > __LOG_TIME_INTERVAL) {
-			timeSinceLastLog = 0.0;
+		const double elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds>(now - startTime).count() * 0.001;
+		const float noise = GetNoise();
+		if (elapsedTime - lastLogTime > __LOG_TIME_INTERVAL) {
+			lastLogTime = elapsedTime;
 			std::cout << std::setprecision(1) << std::fixed;
-			std::cout << "Rendered " << percentageDone << "%. ";
-			std::cout << "Time left is " << hours << " h., " << mins << "m. and " << secs << "s." << std::endl;
+			std::cout << "Rendered " << pixels(0, 0).samples << " rays per pixel in " << elapsedTime << "s. ";
+			std::cout << std::setprecision(4) << "Noise is " << noise << "." << std::endl;
+		}
+		if (noise < settings.noiseThreshold) {
+			stopReason = "the noise threshold was reached";
+			break;
+		}
+		if (settings.timeBudget > 0.0 && elapsedTime >= settings.timeBudget) {
+			stopReason = "the time budget was used";
+			break;
+		}
+		if (settings.previewInterval > 0.0 && elapsedTime - lastPreviewTime >= settings.previewInterval) {
+			lastPreviewTime = elapsedTime;
+			CreateImage();
+			WriteImageToTGA(settings.previewPath);
 		}
 	}
 
 	const auto endTime = std::chrono::high_resolution_clock::now();
 	const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
-	std::cout << "Rendering finished and took: " << (took / 1000.0) << " seconds." << std::endl << std::endl;
+	std::cout << "Rendering finished because " << stopReason << " and took: " << (took / 1000.0) << " seconds." << std::endl;
+	std::cout << std::setprecision(4) << "Rendered " << pixels(0, 0).samples << " rays per pixel. Noise is " << GetNoise() << "." << std::endl << std::endl;
+
+	// Create the final discretized image. Should always be done immediately after the rendering step.
+	CreateImage();
+}
+
+void Camera::RenderAdaptive(const Scene & scene, Renderer & renderer, const AdaptiveSettings & settings,
+							const glm::vec3 eye, const glm::vec3 c1, const glm::vec3 c2,
+							const glm::vec3 c3, const glm::vec3 c4) {
+
+	if (settings.minRaysPerPixel == 0 || settings.minRaysPerPixel > settings.maxRaysPerPixel) {
+		std::cerr << "Adaptive rendering needs 0 < minRaysPerPixel <= maxRaysPerPixel, got " << settings.minRaysPerPixel
+			<< " and " << settings.maxRaysPerPixel << "." << std::endl;
+		return;
+	}
+
+	std::cout << std::endl << "Rendering the scene adaptively ..." << std::endl;
+	const auto startTime = std::chrono::high_resolution_clock::now();
+
+	assert(Utility::Sampler::CheckSampleIndices(samplerType));
+	const CameraPlane cameraPlane(width, height, eye, c1, c2, c3, c4);
+	const std::vector<Tile> tiles = CreateTiles(width, height, tileSize, tileOrder);
+	pixels.Fill(Pixel());
+
+	// The pixels which are still sampled all have the same number of rays, since they got the same rays every round.
+	// Doubling the rays keeps the ray counts at powers of two (times minRaysPerPixel), which suits the samplers.
+	Framebuffer<char> active(width, height, 1);
+	Framebuffer<float> relativeErrors(width, height);
+	unsigned int rays = 0;
+	unsigned int raysInRound = settings.minRaysPerPixel;
+	for (unsigned int round = 0; rays < settings.maxRaysPerPixel; ++round) {
+
+		// The error estimate of a pixel with few rays is itself noisy, e.g. a pixel whose first rays all missed a
+		// caustic looks converged. The largest error in the 3x3 neighbourhood of a pixel is used instead.
+		if (round > 0) {
+			for (unsigned int z = 0; z < height; ++z) {
+				for (unsigned int y = 0; y < width; ++y) {
+					relativeErrors(y, z) = pixels(y, z).GetRelativeError();
+				}
+			}
+			for (unsigned int z = 0; z < height; ++z) {
+				for (unsigned int y = 0; y < width; ++y) {
+					float relativeError = 0.0f;
+					for (unsigned int nz = (z > 0 ? z - 1 : 0); nz <= std::min(z + 1, height - 1); ++nz) {
+						for (unsigned int ny = (y > 0 ? y - 1 : 0); ny <= std::min(y + 1, width - 1); ++ny) {
+							relativeError = std::max(relativeError, relativeErrors(ny, nz));
+						}
+					}
+					active(y, z) = pixels(y, z).samples == rays && relativeError > settings.targetRelativeError;
+				}
+			}
+		}
+		unsigned int activePixels = 0;
+		for (unsigned int z = 0; z < height; ++z) {
+			const char * row = active.GetRow(z);
+			activePixels += static_cast<unsigned int>(std::count(row, row + width, 1));
+		}
+		if (activePixels == 0) {
+			break;
+		}
+		std::cout << std::setprecision(1) << std::fixed << "Round " << round << ": " << activePixels << " pixels ("
+			<< (100.0 * activePixels / (width * height)) << "%) get " << raysInRound << " more rays." << std::endl;
+
+		RenderTiles(tiles, [&](unsigned int y, unsigned int z) {
+			Pixel & pixel = pixels(y, z);
+			if (active(y, z)) {
+				SamplePixel(scene, renderer, cameraPlane, samplerType, y, z, rays, raysInRound, [&](const glm::vec3 & color) { pixel.AddSample(color); });
+			}
+		}, [](const Tile &) { });
+
+		rays += raysInRound;
+		raysInRound = std::min(rays, settings.maxRaysPerPixel - rays);
+	}
+
+	const auto endTime = std::chrono::high_resolution_clock::now();
+	const auto took = std::chrono::duration_cast<std::chrono::milliseconds>(endTime - startTime).count();
+	std::cout << "Rendering finished and took: " << (took / 1000.0) << " seconds." << std::endl;
+
+	// Log the distribution of the rays.
+	std::map<unsigned int, unsigned int> pixelsPerRayCount;
+	for (unsigned int z = 0; z < height; ++z) {
+		const Pixel * row = pixels.GetRow(z);
+		for (unsigned int y = 0; y < width; ++y) {
+			++pixelsPerRayCount[row[y].samples];
+		}
+	}
+	for (const auto & entry : pixelsPerRayCount) {
+		std::cout << std::setprecision(1) << std::fixed << std::setw(8) << entry.first << " rays: "
+			<< (100.0 * entry.second / (width * height)) << "% of the pixels." << std::endl;
+	}
+	const double averageRays = static_cast<double>(GetRayCount()) / (width * height);
+	std::cout << std::setprecision(1) << "Rendered " << averageRays << " rays per pixel on average ("
+		<< (100.0 * averageRays / settings.maxRaysPerPixel) << "% of the maximum). ";
+	std::cout << std::setprecision(4) << "Noise is " << GetNoise() << "." << std::endl << std::endl;
 
 	// Create the final discretized image. Should always be done immediately after the rendering step.
 	CreateImage();
 }
 
+unsigned long long Camera::GetRayCount() const {
+	unsigned long long rays = 0;
+	for (unsigned int z = 0; z < height; ++z) {
+		const Pixel * row = pixels.GetRow(z);
+		for (unsigned int y = 0; y < width; ++y) {
+			rays += row[y].samples;
+		}
+	}
+	return rays;
+}
+
+float Camera::GetNoise() const {
+	double relativeErrorSum = 0.0;
+	for (unsigned int z = 0; z < height; ++z) {
+		const Pixel * row = pixels.GetRow(z);
+		for (unsigned int y = 0; y < width; ++y) {
+			relativeErrorSum += row[y].GetRelativeError();
+		}
+	}
+	return static_cast<float>(relativeErrorSum / (width * height));
+}
+
 void Camera::CreateImage() {
 	std::cout << "Creating a discretized image from the rendered image ..." << std::endl;
 
 	// Find max color intensity.
 	float maxIntensity = 0;
-	for (size_t i = 0; i < width; ++i) {
-		for (size_t j = 0; j < height; ++j) {
-			const auto & c = pixels[i][j].color;
+	for (unsigned int j = 0; j < height; ++j) {
+		const Pixel * row = pixels.GetRow(j);
+		for (unsigned int i = 0; i < width; ++i) {
+			const auto & c = row[i].color;
 			maxIntensity = std::max<float>(c.r, maxIntensity);
 			maxIntensity = std::max<float>(c.g, maxIntensity);
 			maxIntensity = std::max<float>(c.b, maxIntensity);
@@ -132,9 +457,10 @@ void Camera::CreateImage() {
 
 #if __SQUASH_IMAGE
 	// Squash image.
-	for (size_t i = 0; i < width; ++i) {
-		for (size_t j = 0; j < height; ++j) {
-			pixels[i][j].color = sqrt(pixels[i][j].color);
+	for (unsigned int j = 0; j < height; ++j) {
+		Pixel * row = pixels.GetRow(j);
+		for (unsigned int i = 0; i < width; ++i) {
+			row[i].color = sqrt(row[i].color);
 		}
 	}
 	maxIntensity = sqrt(maxIntensity);
@@ -143,18 +469,20 @@ void Camera::CreateImage() {
 	// Discretize pixels using the max intensity. Every discretized value must be between 0 and 255.
 	glm::u8 discretizedMaxIntensity{};
 	const float f = 254.99f / maxIntensity;
-	for (size_t i = 0; i < width; ++i) {
-		for (size_t j = 0; j < height; ++j) {
-			const auto c = f * pixels[i][j].color;
+	for (unsigned int j = 0; j < height; ++j) {
+		const Pixel * row = pixels.GetRow(j);
+		glm::u8vec3 * discretizedRow = discretizedPixels.GetRow(j);
+		for (unsigned int i = 0; i < width; ++i) {
+			const auto c = f * row[i].color;
 			assert(c.r >= -FLT_EPSILON && c.r <= 255.5f - FLT_EPSILON);
 			assert(c.g >= -FLT_EPSILON && c.g <= 255.5f - FLT_EPSILON);
 			assert(c.b >= -FLT_EPSILON && c.b <= 255.5f - FLT_EPSILON);
-			discretizedPixels[i][j].r = (glm::u8)round(c.r);
-			discretizedPixels[i][j].g = (glm::u8)round(c.g);
-			discretizedPixels[i][j].b = (glm::u8)round(c.b);
-			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedPixels[i][j].r);
-			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedPixels[i][j].g);
-			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedPixels[i][j].b);
+			discretizedRow[i].r = (glm::u8)round(c.r);
+			discretizedRow[i].g = (glm::u8)round(c.g);
+			discretizedRow[i].b = (glm::u8)round(c.b);
+			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedRow[i].r);
+			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedRow[i].g);
+			discretizedMaxIntensity = glm::max(discretizedMaxIntensity, discretizedRow[i].b);
 		}
 	}
 	assert(discretizedMaxIntensity == 255); // Discretized max intensity failed.
@@ -183,8 +511,9 @@ bool Camera::WriteImageToTGA(const std::string path) const {
 
 	// Write data.
 	for (unsigned int y = 0; y < height; ++y) {
+		const glm::u8vec3 * row = discretizedPixels.GetRow(y);
 		for (unsigned int x = 0; x < width; ++x) {
-			auto& cp = discretizedPixels[x][y];
+			auto& cp = row[x];
 			o.put(cp.b);
 			o.put(cp.g);
 			o.put(cp.r);
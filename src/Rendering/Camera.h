@@ -1,21 +1,78 @@
 #pragma once
 
 #include <vector>
+#include <string>
 
 #include <glm.hpp>
 
 #include "../Scene/Scene.h"
 #include "Renderers\Renderer.h"
 #include "Pixel.h"
+#include "Framebuffer.h"
+#include "../Utility/Sampler.h"
 
 class Camera {
 public:
+	/// <summary> The order in which the tiles of the image are handed out to the render threads. </summary>
+	enum class TileOrder {
+		/// <summary> Row by row. </summary>
+		SCANLINE,
+		/// <summary> Along a Hilbert curve, so that consecutive tiles are neighbours. </summary>
+		HILBERT,
+		/// <summary> Outwards from the centre of the image. </summary>
+		SPIRAL
+	};
+
+	/// <summary> When a progressive render stops, and how it reports its progress (see RenderProgressive). </summary>
+	struct ProgressiveSettings {
+		/// <summary> Stop when every pixel has this many rays. </summary>
+		unsigned int maxRaysPerPixel = 1024;
+
+		/// <summary> Stop after the first pass which ends after this many seconds (0 for no time limit). </summary>
+		double timeBudget = 0.0;
+
+		/// <summary> Stop when the noise of the image (see GetNoise) is below this (0 to never stop because of noise). </summary>
+		float noiseThreshold = 0.0f;
+
+		/// <summary> Write the image to previewPath every this many seconds (0 for no previews). </summary>
+		double previewInterval = 0.0;
+		std::string previewPath = "output/preview.tga";
+	};
+
+	/// <summary> How many rays the pixels get in an adaptive render (see RenderAdaptive). </summary>
+	struct AdaptiveSettings {
+		/// <summary>
+		/// Every pixel gets this many rays first, which should be enough to estimate its error. Must be at least one and
+		/// at most maxRaysPerPixel.
+		/// </summary>
+		unsigned int minRaysPerPixel = 16;
+
+		/// <summary> No pixel gets more rays than this. </summary>
+		unsigned int maxRaysPerPixel = 1024;
+
+		/// <summary> Pixels get more rays until their relative error (see Pixel::GetRelativeError) is below this. </summary>
+		float targetRelativeError = 0.05f;
+	};
+
 	/// <summary> The width of the camera in pixels. </summary>
 	unsigned int width;
 
 	/// <summary> The height of the camera in pixels. </summary>
 	unsigned int height;
 
+	/// <summary> The sequence used for the samples of the pixels (see Utility::Sampler). </summary>
+	Utility::Sampler::Type samplerType = Utility::Sampler::Type::SOBOL;
+
+	/// <summary>
+	/// The width and height of the tiles in pixels. The tiles are rendered in parallel, and every idle thread takes
+	/// the next tile, so small tiles balance the work between the threads better while large tiles cost less scheduling.
+	/// The width is rounded up to whole cache lines of pixels (see Framebuffer), so that threads never share them.
+	/// </summary>
+	unsigned int tileSize = 16;
+
+	/// <summary> The order in which the tiles are rendered. </summary>
+	TileOrder tileOrder = TileOrder::HILBERT;
+
 	/// <summary> Constructs an image. </summary>
 	/// <param name="width"> The width of the image in pixels. </param>
 	/// <param name="height"> The height of the image in pixels. </param>
@@ -34,7 +91,7 @@ public:
 	/// <param name='RAY_LENGTH'> The length of all the rays used to render the scene. </param>
 	/// <param name='RAYS_PER_PIXEL'> 
 	/// The number of rays which we trace through each pixel. 
-	/// Best results are given if RAYS_PER_PIXEL = N^2 for some integer N. 
+	/// Best results are given if RAYS_PER_PIXEL is a power of two. 
 	/// </param> 
 	void Render(const Scene & scene, Renderer & renderer,
 				const unsigned int RAYS_PER_PIXEL = 1024,
@@ -42,6 +99,37 @@ public:
 				const glm::vec3 c1 = glm::vec3(-5, -1, -1), const glm::vec3 c2 = glm::vec3(-5, 1, -1),
 				const glm::vec3 c3 = glm::vec3(-5, 1, 1), const glm::vec3 c4 = glm::vec3(-5, -1, 1));
 
+	/// <summary>
+	/// Renders the image in passes which add one ray to every pixel, until one of the limits in the settings is
+	/// reached, and writes intermediate images in between. The pixels keep their samples, so calling it again
+	/// (with a higher limit) continues the render instead of starting over. Render starts over.
+	/// See Render for the other parameters.
+	/// </summary>
+	void RenderProgressive(const Scene & scene, Renderer & renderer, const ProgressiveSettings & settings,
+						   const glm::vec3 eye = glm::vec3(-7, 0, 0),
+						   const glm::vec3 c1 = glm::vec3(-5, -1, -1), const glm::vec3 c2 = glm::vec3(-5, 1, -1),
+						   const glm::vec3 c3 = glm::vec3(-5, 1, 1), const glm::vec3 c4 = glm::vec3(-5, -1, 1));
+
+	/// <summary>
+	/// Renders the image in rounds. The first round gives every pixel minRaysPerPixel rays, and every following round
+	/// doubles the rays of the pixels whose relative error is still above the target, until maxRaysPerPixel. Flat,
+	/// converged regions stop early, and the remaining rays go to the noisy regions. Logs how many pixels got
+	/// how many rays. See Render for the other parameters.
+	/// </summary>
+	void RenderAdaptive(const Scene & scene, Renderer & renderer, const AdaptiveSettings & settings,
+						const glm::vec3 eye = glm::vec3(-7, 0, 0),
+						const glm::vec3 c1 = glm::vec3(-5, -1, -1), const glm::vec3 c2 = glm::vec3(-5, 1, -1),
+						const glm::vec3 c3 = glm::vec3(-5, 1, 1), const glm::vec3 c4 = glm::vec3(-5, -1, 1));
+
+	/// <summary> Returns the noise of the image: the mean relative error of the pixels (see Pixel::GetRelativeError). </summary>
+	float GetNoise() const;
+
+	/// <summary>
+	/// Returns the number of primary rays in the image, i.e. the sum of the samples of the pixels. Progressive and
+	/// adaptive renders can stop before, or below, their maximum number of rays per pixel.
+	/// </summary>
+	unsigned long long GetRayCount() const;
+
 	/// <summary> 
 	/// Writes the discretized pixels to a TGA image.
 	/// Returns true if successful. 
@@ -49,8 +137,8 @@ public:
 	bool WriteImageToTGA(const std::string path = "output/output_image.tga") const;
 private:
 	// Pixel containers.
-	std::vector<std::vector<Pixel>> pixels;
-	std::vector<std::vector<glm::u8vec3>> discretizedPixels;
+	Framebuffer<Pixel> pixels;
+	Framebuffer<glm::u8vec3> discretizedPixels;
 
 	/// <summary> Discretizes the color of each pixel. </summary>
 	void CreateImage();
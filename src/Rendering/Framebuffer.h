@@ -0,0 +1,124 @@
+#pragma once
+
+#include <cstdint>
+#include <cassert>
+#include <memory>
+#include <type_traits>
+
+/// <summary>
+/// An image of pixels of type T in one contiguous allocation, stored row by row. Every row starts on a cache line,
+/// so the pixels [x, x + CACHE_LINE_PIXELS) of a row, for x a multiple of CACHE_LINE_PIXELS, fill whole cache lines
+/// of their own. Threads which write to rectangles whose left and right edges are such multiples (see Camera's tiles)
+/// never write to the same cache line. Views refer to a rectangle of the pixels without copying them.
+/// </summary>
+template<typename T>
+class Framebuffer {
+	static_assert(std::is_trivially_copyable<T>::value, "Framebuffer pixels are copied as raw memory.");
+public:
+	static const unsigned int CACHE_LINE_SIZE = 64;
+
+	/// <summary> The smallest number of consecutive pixels which fill a whole number of cache lines. </summary>
+	static const unsigned int CACHE_LINE_PIXELS = CACHE_LINE_SIZE / (sizeof(T) % CACHE_LINE_SIZE == 0 ? CACHE_LINE_SIZE : (sizeof(T) & (~sizeof(T) + 1)));
+
+	/// <summary> A rectangle of the pixels of a framebuffer. U is T, or const T for read-only views. </summary>
+	template<typename U>
+	class BasicView {
+	public:
+		BasicView(U * _data, const unsigned int _width, const unsigned int _height, const size_t _stride) :
+			data(_data), width(_width), height(_height), stride(_stride) { }
+
+		unsigned int GetWidth() const { return width; }
+		unsigned int GetHeight() const { return height; }
+
+		/// <summary> Returns the pixel at column x in row y of the view. </summary>
+		U & operator()(const unsigned int x, const unsigned int y) const {
+			assert(x < width && y < height);
+			return data[y * stride + x];
+		}
+
+		/// <summary> Returns the first pixel of row y of the view. The pixels of the row follow it. </summary>
+		U * GetRow(const unsigned int y) const {
+			assert(y < height);
+			return data + y * stride;
+		}
+
+	private:
+		U * data;
+		unsigned int width, height;
+		size_t stride;
+	};
+
+	typedef BasicView<T> View;
+	typedef BasicView<const T> ConstView;
+
+	/// <summary> Creates a width x height framebuffer with every pixel set to value. </summary>
+	Framebuffer(const unsigned int _width, const unsigned int _height, const T & value = T()) :
+		width(_width), height(_height),
+		stride((static_cast<size_t>(_width) + CACHE_LINE_PIXELS - 1) / CACHE_LINE_PIXELS * CACHE_LINE_PIXELS),
+		storage(new unsigned char[stride * _height * sizeof(T) + CACHE_LINE_SIZE - 1]) {
+		const uintptr_t address = reinterpret_cast<uintptr_t>(storage.get());
+		data = reinterpret_cast<T *>((address + CACHE_LINE_SIZE - 1) & ~static_cast<uintptr_t>(CACHE_LINE_SIZE - 1));
+		Fill(value);
+	}
+
+	Framebuffer(const Framebuffer &) = delete;
+	Framebuffer & operator=(const Framebuffer &) = delete;
+	Framebuffer(Framebuffer &&) = default;
+	Framebuffer & operator=(Framebuffer &&) = default;
+
+	unsigned int GetWidth() const { return width; }
+	unsigned int GetHeight() const { return height; }
+
+	/// <summary> Sets every pixel to value. </summary>
+	void Fill(const T & value) {
+		std::uninitialized_fill(data, data + stride * height, value);
+	}
+
+	/// <summary> Returns the pixel at column x in row y. </summary>
+	T & operator()(const unsigned int x, const unsigned int y) {
+		assert(x < width && y < height);
+		return data[y * stride + x];
+	}
+
+	const T & operator()(const unsigned int x, const unsigned int y) const {
+		assert(x < width && y < height);
+		return data[y * stride + x];
+	}
+
+	/// <summary> Returns the first pixel of row y. The pixels of the row follow it. </summary>
+	T * GetRow(const unsigned int y) {
+		assert(y < height);
+		return data + y * stride;
+	}
+
+	const T * GetRow(const unsigned int y) const {
+		assert(y < height);
+		return data + y * stride;
+	}
+
+	/// <summary> Returns a view of the rectangle [x, x + viewWidth) x [y, y + viewHeight). </summary>
+	View GetView(const unsigned int x, const unsigned int y, const unsigned int viewWidth, const unsigned int viewHeight) {
+		assert(x + viewWidth <= width && y + viewHeight <= height);
+		return View(data + y * stride + x, viewWidth, viewHeight, stride);
+	}
+
+	ConstView GetView(const unsigned int x, const unsigned int y, const unsigned int viewWidth, const unsigned int viewHeight) const {
+		assert(x + viewWidth <= width && y + viewHeight <= height);
+		return ConstView(data + y * stride + x, viewWidth, viewHeight, stride);
+	}
+
+	/// <summary> Returns a view of the whole framebuffer. </summary>
+	View GetView() { return GetView(0, 0, width, height); }
+	ConstView GetView() const { return GetView(0, 0, width, height); }
+
+private:
+	unsigned int width, height;
+
+	/// <summary> The number of pixels from the start of a row to the start of the next one. </summary>
+	size_t stride;
+
+	std::unique_ptr<unsigned char[]> storage;
+
+	/// <summary> The first pixel, at the first cache line boundary in storage. </summary>
+	T * data;
+};
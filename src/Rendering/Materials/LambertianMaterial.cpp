@@ -2,7 +2,7 @@
 
 LambertianMaterial::LambertianMaterial(glm::vec3 color, float _emissivity, float _reflectivity,
 									   float _transparency, float _refractiveIndex, float _specularity, float _specularExponent) :
-	surfaceColor(color), Material(_emissivity, _reflectivity, _transparency, _refractiveIndex, _specularity, _specularExponent) {}
+	surfaceColor(color), Material(Type::LAMBERTIAN, _emissivity, _reflectivity, _transparency, _refractiveIndex, _specularity, _specularExponent) {}
 
 glm::vec3 LambertianMaterial::GetSurfaceColor() const { return surfaceColor; }
 
@@ -4,7 +4,7 @@
 #include <random>
 #include "../../Utility/Math.h"
 
-class LambertianMaterial : public Material {
+class LambertianMaterial final : public Material {
 public:
 	LambertianMaterial(glm::vec3 color, float emissivity = 0.0f, float reflectivity = 0.00f,
 					   float transparency = 0.0f, float refractiveIndex = 1.0f, float specularity = 0.0f, float specularExponent = 75.0f);
@@ -6,6 +6,12 @@
 
 class Material {
 public:
+	/// <summary> The concrete material types. Trace kernels switch on this instead of making virtual calls (see RenderPolicy). </summary>
+	enum class Type { LAMBERTIAN, OREN_NAYAR };
+
+	/// <summary> The concrete type of this material. </summary>
+	const Type type;
+
 	float refractiveIndex, reflectivity, transparency, emissivity, specularity, specularExponent;
 
 	bool IsEmissive() const { return emissivity > FLT_EPSILON; };
@@ -35,9 +41,9 @@ public:
 	}
 
 protected:
-	Material(float _emissivity = 0.0f, float _reflectivity = 0.98f,
+	Material(Type _type, float _emissivity = 0.0f, float _reflectivity = 0.98f,
 			 float _transparency = 0.0f, float _refractiveIndex = 1.0f,
 			 float _specularity = 0.0f, float _specularityExponent = 75.0f) :
-		refractiveIndex(_refractiveIndex), transparency(_transparency),
+		type(_type), refractiveIndex(_refractiveIndex), transparency(_transparency),
 		emissivity(_emissivity), reflectivity(_reflectivity), specularity(_specularity), specularExponent(_specularityExponent) {}
 };
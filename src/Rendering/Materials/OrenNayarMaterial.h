@@ -2,7 +2,7 @@
 
 #include "Material.h"
 
-class OrenNayarMaterial : public Material {
+class OrenNayarMaterial final : public Material {
 public:
 	OrenNayarMaterial(glm::vec3 color, float roughness = 0.5f, float emissivity = 0.0f,
 					  float reflectivity = 0.00f, float transparency = 0.0f, float refractiveIndex = 1.0f,
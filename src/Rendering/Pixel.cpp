@@ -1,3 +1,31 @@
 #include "Pixel.h"
 
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
 Pixel::Pixel(glm::vec3 _color) : color(_color) { }
+
+namespace {
+	float Luminance(const glm::vec3 & color) {
+		return glm::dot(color, glm::vec3(0.2126f, 0.7152f, 0.0722f));
+	}
+}
+
+void Pixel::AddSample(const glm::vec3 & sample) {
+	const float previousLuminance = Luminance(color);
+	++samples;
+	color += (sample - color) / static_cast<float>(samples);
+	const float sampleLuminance = Luminance(sample);
+	luminanceM2 += (sampleLuminance - previousLuminance) * (sampleLuminance - Luminance(color));
+}
+
+float Pixel::GetRelativeError() const {
+	if (samples < 2) {
+		return std::numeric_limits<float>::infinity();
+	}
+	// Dark pixels are compared to a small luminance instead, or their relative error would never converge.
+	const float MIN_LUMINANCE = 0.01f;
+	const float varianceOfMean = luminanceM2 / static_cast<float>((samples - 1) * samples);
+	return std::sqrt(varianceOfMean) / std::max(Luminance(color), MIN_LUMINANCE);
+}
@@ -6,6 +6,23 @@
 
 class Pixel {
 public:
+	/// <summary> The mean of the samples of the pixel. </summary>
 	glm::vec3 color;
+
+	/// <summary> The number of samples of the pixel. </summary>
+	unsigned int samples = 0;
+
+	/// <summary> The sum of the squared differences from the mean luminance of the samples (Welford's algorithm). </summary>
+	float luminanceM2 = 0.0f;
+
 	Pixel(glm::vec3 color = glm::vec3());
+
+	/// <summary> Adds a sample to the running mean and variance. </summary>
+	void AddSample(const glm::vec3 & sample);
+
+	/// <summary>
+	/// Returns the standard error of the mean luminance relative to the mean luminance, i.e. the expected relative
+	/// noise of the pixel. Infinite if there are less than two samples.
+	/// </summary>
+	float GetRelativeError() const;
 };
\ No newline at end of file
@@ -1,17 +1,110 @@
 #include "RenderGroup.h"
 
-glm::vec3 RenderGroup::GetRandomPositionOnSurface() const {
-	const auto primitive = primitives[rand() % primitives.size()];
-	return primitive->GetRandomPositionOnSurface();
+#include <cassert>
+
+glm::vec3 RenderGroup::GetRandomPositionOnSurface(Utility::Sampler & sampler) const {
+	if (instancedRenderGroup != nullptr) {
+		return glm::vec3(instanceTransform * glm::vec4(instancedRenderGroup->GetRandomPositionOnSurface(sampler), 1.0f));
+	}
+	if (triangleMesh != nullptr) {
+		return triangleMesh->GetRandomPositionOnSurface(sampler.NextUInt(triangleMesh->GetTriangleCount()), sampler);
+	}
+	return GetRandomPrimitive(sampler)->GetRandomPositionOnSurface(sampler);
+}
+
+glm::vec3 RenderGroup::GetRandomPositionOnSurface(glm::vec3 & normal, Utility::Sampler & sampler) const {
+	if (instancedRenderGroup != nullptr) {
+		const glm::vec3 position = instancedRenderGroup->GetRandomPositionOnSurface(normal, sampler);
+		normal = TransformNormalToWorldSpace(normal);
+		return glm::vec3(instanceTransform * glm::vec4(position, 1.0f));
+	}
+	if (triangleMesh != nullptr) {
+		const unsigned int triangle = sampler.NextUInt(triangleMesh->GetTriangleCount());
+		const glm::vec3 position = triangleMesh->GetRandomPositionOnSurface(triangle, sampler);
+		normal = triangleMesh->GetNormal(triangle, position);
+		return position;
+	}
+	const auto primitive = GetRandomPrimitive(sampler);
+	const glm::vec3 position = primitive->GetRandomPositionOnSurface(sampler);
+	normal = Primitives::GetNormal(*primitive, position);
+	return position;
+}
+
+const Primitive * RenderGroup::GetRandomPrimitive(Utility::Sampler & sampler) const {
+	// Most light sources are a single quad, which is sampled without drawing a primitive.
+	return primitives.size() == 1 ? primitives[0] : primitives[sampler.NextUInt(static_cast<uint32_t>(primitives.size()))];
+}
+
+void RenderGroup::SetInstanceTransform(const glm::mat4 & transform) {
+	instanceTransform = transform;
+	inverseInstanceTransform = glm::inverse(transform);
+}
+
+bool RenderGroup::HasUniformScale() const {
+	if (instancedRenderGroup == nullptr) {
+		return true;
+	}
+	// The transformed axes must be orthogonal and of the same length.
+	const glm::mat3 linear(instanceTransform);
+	const float scale2 = glm::dot(linear[0], linear[0]);
+	const float tolerance = 1e-4f * scale2;
+	return glm::abs(glm::dot(linear[1], linear[1]) - scale2) <= tolerance && glm::abs(glm::dot(linear[2], linear[2]) - scale2) <= tolerance &&
+		glm::abs(glm::dot(linear[0], linear[1])) <= tolerance && glm::abs(glm::dot(linear[0], linear[2])) <= tolerance &&
+		glm::abs(glm::dot(linear[1], linear[2])) <= tolerance;
+}
+
+Ray RenderGroup::TransformRayToInstanceSpace(const Ray & ray, float & scale) const {
+	const glm::vec3 direction = glm::vec3(inverseInstanceTransform * glm::vec4(ray.direction, 0.0f));
+	scale = glm::length(direction);
+	return Ray(glm::vec3(inverseInstanceTransform * glm::vec4(ray.from, 1.0f)), direction / scale,
+			   ray.tMin * scale, glm::min(ray.tMax * scale, FLT_MAX));
+}
+
+glm::vec3 RenderGroup::TransformNormalToWorldSpace(const glm::vec3 & normal) const {
+	return glm::normalize(glm::vec3(glm::transpose(inverseInstanceTransform) * glm::vec4(normal, 0.0f)));
+}
+
+unsigned int RenderGroup::GetPrimitiveCount() const {
+	if (instancedRenderGroup != nullptr) {
+		return instancedRenderGroup->GetPrimitiveCount();
+	}
+	return triangleMesh != nullptr ? triangleMesh->GetTriangleCount() : static_cast<unsigned int>(primitives.size());
+}
+
+glm::vec3 RenderGroup::GetNormal(unsigned int primitiveIndex, const glm::vec3 & position) const {
+	if (instancedRenderGroup != nullptr) {
+		const glm::vec3 instancePosition = glm::vec3(inverseInstanceTransform * glm::vec4(position, 1.0f));
+		return TransformNormalToWorldSpace(instancedRenderGroup->GetNormal(primitiveIndex, instancePosition));
+	}
+	if (triangleMesh != nullptr) {
+		return triangleMesh->GetNormal(primitiveIndex, position);
+	}
+	return Primitives::GetNormal(*primitives[primitiveIndex], position);
 }
 
 RenderGroup::RenderGroup(Material * mat) : material(mat) {}
 
 void RenderGroup::RecalculateAABB() {
+	if (instancedRenderGroup != nullptr) {
+		// Bound the transformed corners of the AABB of the instanced group.
+		const AABB & instanceAABB = instancedRenderGroup->axisAlignedBoundingBox;
+		axisAlignedBoundingBox = AABB(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX));
+		for (unsigned int corner = 0; corner < 8; ++corner) {
+			const glm::vec3 position((corner & 1) ? instanceAABB.maximum.x : instanceAABB.minimum.x,
+									 (corner & 2) ? instanceAABB.maximum.y : instanceAABB.minimum.y,
+									 (corner & 4) ? instanceAABB.maximum.z : instanceAABB.minimum.z);
+			axisAlignedBoundingBox.Expand(glm::vec3(instanceTransform * glm::vec4(position, 1.0f)));
+		}
+		return;
+	}
+	if (triangleMesh != nullptr) {
+		axisAlignedBoundingBox = triangleMesh->GetAxisAlignedBoundingBox();
+		return;
+	}
 	glm::vec3 minimum = glm::vec3(FLT_MAX);
 	glm::vec3 maximum = glm::vec3(-FLT_MAX);
 	for (const auto & p : primitives) {
-		const auto & aabb = p->GetAxisAlignedBoundingBox();
+		const auto & aabb = Primitives::GetAxisAlignedBoundingBox(*p);
 		const auto & amin = aabb.minimum;
 		const auto & amax = aabb.maximum;
 		minimum.x = glm::min<float>(minimum.x, amin.x);
@@ -24,3 +117,123 @@ void RenderGroup::RecalculateAABB() {
 	axisAlignedBoundingBox.minimum = minimum;
 	axisAlignedBoundingBox.maximum = maximum;
 }
+
+std::vector<AABB> RenderGroup::GetPrimitiveAABBs() const {
+	if (triangleMesh != nullptr) {
+		std::vector<AABB> triangleAABBs(triangleMesh->GetTriangleCount());
+		for (unsigned int i = 0; i < triangleAABBs.size(); ++i) {
+			triangleAABBs[i] = triangleMesh->GetAxisAlignedBoundingBox(i);
+		}
+		return triangleAABBs;
+	}
+	std::vector<AABB> primitiveAABBs(primitives.size(), AABB(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)));
+	for (unsigned int i = 0; i < primitives.size(); ++i) {
+		if (primitives[i]->enabled) {
+			primitiveAABBs[i] = Primitives::GetAxisAlignedBoundingBox(*primitives[i]);
+		}
+	}
+	return primitiveAABBs;
+}
+
+void RenderGroup::BuildAccelerationStructure(const AccelerationStructure::Settings & settings) {
+	// The primitives may have moved since the AABB was calculated.
+	RecalculateAABB();
+	if (instancedRenderGroup != nullptr) {
+		// Instances use the structure of the instanced group.
+		return;
+	}
+	std::vector<unsigned int> allPrimitives(GetPrimitiveCount());
+	for (unsigned int i = 0; i < allPrimitives.size(); ++i) {
+		allPrimitives[i] = i;
+	}
+	accelerationStructure.settings = settings;
+	accelerationStructure.Build(GetPrimitiveAABBs(), allPrimitives);
+	PackTriangles();
+}
+
+void RenderGroup::RefitAccelerationStructure() {
+	RecalculateAABB();
+	if (instancedRenderGroup != nullptr) {
+		return;
+	}
+	accelerationStructure.Refit(GetPrimitiveAABBs());
+	PackTriangles();
+}
+
+void RenderGroup::PackTriangles() {
+	if (triangleMesh != nullptr) {
+		packedTriangles.Pack(*triangleMesh, accelerationStructure.GetItemIndices());
+	}
+	else {
+		packedTriangles.Pack(primitives, accelerationStructure.GetItemIndices());
+	}
+}
+
+bool RenderGroup::RayCast(Ray & ray, unsigned int & intersectionPrimitiveIndex) const {
+	if (instancedRenderGroup != nullptr) {
+		float scale;
+		Ray instanceRay = TransformRayToInstanceSpace(ray, scale);
+		if (!instancedRenderGroup->RayCast(instanceRay, intersectionPrimitiveIndex)) {
+			return false;
+		}
+		ray.tMax = instanceRay.tMax / scale;
+		return true;
+	}
+
+	return accelerationStructure.RayCastLeaves(ray, [&](unsigned int offset, unsigned int count, Ray & currentRay) {
+		// Only intersections within the ray interval are reported, so any intersection is closer.
+		bool intersectionFound = false;
+		IntersectLeaf(currentRay, offset, count, [&](unsigned int item, float distance) {
+			assert(distance > currentRay.tMin && distance < currentRay.tMax);
+			intersectionPrimitiveIndex = item;
+			currentRay.tMax = distance;
+			intersectionFound = true;
+			return false;
+		});
+		return intersectionFound;
+	});
+}
+
+RayPacket::Mask RenderGroup::RayCastPacket(RayPacket & packet, RayPacket::Mask mask, unsigned int intersectionPrimitiveIndices[RayPacket::MAX_SIZE]) const {
+	if (instancedRenderGroup != nullptr) {
+		// An affine transform keeps the rays coherent, so the packet is cast through the instanced group as a whole.
+		RayPacket instancePacket;
+		float scales[RayPacket::MAX_SIZE];
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			instancePacket.Add(TransformRayToInstanceSpace(packet.rays[i], scales[i]));
+		}
+		const RayPacket::Mask instanceIntersectionMask = instancedRenderGroup->RayCastPacket(instancePacket, mask, intersectionPrimitiveIndices);
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			if (RayPacket::Contains(instanceIntersectionMask, i)) {
+				packet.rays[i].tMax = instancePacket.rays[i].tMax / scales[i];
+			}
+		}
+		return instanceIntersectionMask;
+	}
+
+	RayPacket::Mask intersectionMask = 0;
+	if (!accelerationStructure.SupportsRayPackets()) {
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			if (RayPacket::Contains(mask, i) && RayCast(packet.rays[i], intersectionPrimitiveIndices[i])) {
+				intersectionMask |= RayPacket::Mask(1) << i;
+			}
+		}
+		return intersectionMask;
+	}
+
+	accelerationStructure.RayCastPacket(packet, mask, [&](unsigned int offset, unsigned int count, RayPacket::Mask leafMask) {
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			if (!RayPacket::Contains(leafMask, i)) {
+				continue;
+			}
+			Ray & ray = packet.rays[i];
+			IntersectLeaf(ray, offset, count, [&](unsigned int item, float distance) {
+				intersectionPrimitiveIndices[i] = item;
+				ray.tMax = distance;
+				intersectionMask |= RayPacket::Mask(1) << i;
+				return false;
+			});
+		}
+	});
+	return intersectionMask;
+}
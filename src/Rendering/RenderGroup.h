@@ -5,8 +5,12 @@
 
 #include "Materials\Material.h"
 #include "..\Geometry\Primitive.h"
+#include "..\Geometry\Primitives.h"
+#include "..\Geometry\TriangleMesh.h"
 #include "..\PhotonMap\Photon.h"
 #include "..\Geometry\AABB.h"
+#include "..\Geometry\PackedTriangles.h"
+#include "..\Acceleration\AccelerationStructure.h"
 
 class RenderGroup {
 public:
@@ -15,9 +19,191 @@ public:
 	AABB axisAlignedBoundingBox;
 	Material* material;
 	std::vector<Primitive*> primitives;
+
+	/// <summary> 
+	/// If set, the primitives of this group are the triangles of this mesh instead (primitive index i is triangle i),
+	/// and primitives is empty. The mesh is owned by the scene. Mesh triangles are always enabled.
+	/// </summary>
+	TriangleMesh * triangleMesh = nullptr;
+
+	/// <summary> 
+	/// If set, this group is an instance of the given shared render group (see Scene::sharedRenderGroups): it has no
+	/// primitives or acceleration structure of its own, and rays are transformed into the space of the shared group
+	/// when they enter the instance. The material of an instance may differ from the material of the shared group.
+	/// Shared render groups can't be instances themselves.
+	/// </summary>
+	const RenderGroup * instancedRenderGroup = nullptr;
+
+	/// <summary> The transform from the space of the instanced render group to world space (see SetInstanceTransform). </summary>
+	glm::mat4 instanceTransform;
+
+	/// <summary> The inverse of instanceTransform. </summary>
+	glm::mat4 inverseInstanceTransform;
+
 	std::vector<std::vector<Photon>> photons;
 
+	/// <summary> Bottom level acceleration structure over the primitives of this group. </summary>
+	AccelerationStructure accelerationStructure;
+
 	RenderGroup(Material*);
 	void RecalculateAABB();
-	glm::vec3 GetRandomPositionOnSurface() const;
-};
\ No newline at end of file
+	glm::vec3 GetRandomPositionOnSurface(Utility::Sampler & sampler) const;
+
+	/// <summary> 
+	/// Returns a random position on the surface of a random primitive in this group.
+	/// The surface normal at the position is returned in normal.
+	/// Instances transform a position on the instanced group, so the positions are only as evenly spread over the
+	/// surface as in the instanced group if the instance transform has a uniform scale (see HasUniformScale).
+	/// </summary>
+	glm::vec3 GetRandomPositionOnSurface(glm::vec3 & normal, Utility::Sampler & sampler) const;
+
+	/// <summary> 
+	/// Sets the transform of an instance, from the space of the instanced render group to world space.
+	/// Call RecalculateAABB (or RefitAccelerationStructure) afterwards.
+	/// </summary>
+	void SetInstanceTransform(const glm::mat4 & transform);
+
+	/// <summary> 
+	/// Returns true unless this group is an instance whose transform scales some directions more than others (or shears),
+	/// which stretches some parts of the surface more than others. Emissive instances must have a uniform scale, since
+	/// the light sources are sampled by GetRandomPositionOnSurface.
+	/// </summary>
+	bool HasUniformScale() const;
+
+	/// <summary> Returns the number of primitives (or mesh triangles) in this group. </summary>
+	unsigned int GetPrimitiveCount() const;
+
+	/// <summary> Returns the surface normal of a primitive (or mesh triangle) in this group at the given position. </summary>
+	glm::vec3 GetNormal(unsigned int primitiveIndex, const glm::vec3 & position) const;
+
+	/// <summary> 
+	/// Builds an acceleration structure with the given settings over all primitives in this group, and updates the AABB.
+	/// Disabled primitives get empty bounds, so that they can be enabled later on by RefitAccelerationStructure.
+	/// </summary>
+	void BuildAccelerationStructure(const AccelerationStructure::Settings & settings);
+
+	/// <summary> 
+	/// Updates the AABB, the acceleration structure and the packed triangles of this group after primitives have moved or have been enabled or disabled.
+	/// Much cheaper than rebuilding when only a few primitives have changed.
+	/// </summary>
+	void RefitAccelerationStructure();
+
+	/// <summary> 
+	/// Casts a ray through the primitives of this group. Returns true if there was an intersection
+	/// within the ray interval.
+	/// </summary>
+	/// <param name='ray'> 
+	/// IN/OUT: The ray which we cast. ray.tMax is set to the intersection distance if there was an intersection.
+	/// </param>
+	/// <param name='intersectionPrimitiveIndex'> 
+	/// OUT: The intersection primitive index if there was an intersection.
+	/// </param>
+	bool RayCast(Ray & ray, unsigned int & intersectionPrimitiveIndex) const;
+
+	/// <summary> 
+	/// Casts the given rays of a packet through the primitives of this group, sharing the node visits between the rays
+	/// (the rays are cast one at a time if the acceleration structure doesn't support ray packets). Returns the rays which found a closer intersection. The intersection distances are stored in rays[i].tMax.
+	/// </summary>
+	/// <param name='packet'> IN/OUT: The rays which we cast. </param>
+	/// <param name='mask'> The rays in the packet which are cast. </param>
+	/// <param name='intersectionPrimitiveIndices'> 
+	/// OUT: The intersection primitive index of every returned ray.
+	/// </param>
+	RayPacket::Mask RayCastPacket(RayPacket & packet, RayPacket::Mask mask, unsigned int intersectionPrimitiveIndices[RayPacket::MAX_SIZE]) const;
+
+	/// <summary> 
+	/// Calls onIntersection for the intersections between a ray and the primitives of this group which are
+	/// within the ray interval (in no particular order). Stops and returns true as soon as onIntersection returns true.
+	/// </summary>
+	/// <param name='ray'> The ray which we cast. </param>
+	/// <param name='onIntersection'> Callable on the form bool(unsigned int primitiveIndex, float intersectionDistance). </param>
+	template<typename OnIntersection>
+	bool AnyHit(const Ray & ray, OnIntersection onIntersection) const;
+
+private:
+	/// <summary> The triangles (or mesh triangles) of this group in the item order of the acceleration structure. </summary>
+	PackedTriangles packedTriangles;
+
+	/// <summary> Returns the AABB of every primitive, or an empty AABB if the primitive is disabled. </summary>
+	std::vector<AABB> GetPrimitiveAABBs() const;
+
+	/// <summary> 
+	/// Transforms a world space ray into the space of the instanced render group. The direction is normalized, which the
+	/// primitive tests rely on, so distances along the returned ray are scale times the world space distances.
+	/// </summary>
+	Ray TransformRayToInstanceSpace(const Ray & ray, float & scale) const;
+
+	/// <summary> Transforms a surface normal from the space of the instanced render group to world space. </summary>
+	glm::vec3 TransformNormalToWorldSpace(const glm::vec3 & normal) const;
+
+	/// <summary> Same as AnyHit, but always intersects the primitives of this group (ignoring instancedRenderGroup). </summary>
+	template<typename OnIntersection>
+	bool AnyHitPrimitives(const Ray & ray, OnIntersection onIntersection) const;
+
+	/// <summary> Returns a random primitive of this group (which must not be a triangle mesh group). </summary>
+	const Primitive * GetRandomPrimitive(Utility::Sampler & sampler) const;
+
+	/// <summary> Packs the triangles in the item order of the acceleration structure. </summary>
+	void PackTriangles();
+
+	/// <summary> 
+	/// Calls onIntersection for the intersections between a ray and the enabled primitives in a leaf of the acceleration
+	/// structure. The triangles are tested PackedTriangles::WIDTH at a time. Stops and returns true as soon as
+	/// onIntersection returns true. onIntersection may decrease ray.tMax, which is respected by the remaining tests.
+	/// </summary>
+	/// <param name='offset'> The leaf is accelerationStructure.GetItemIndices()[offset, offset + count). </param>
+	/// <param name='onIntersection'> Callable on the form bool(unsigned int primitiveIndex, float intersectionDistance). </param>
+	template<typename OnIntersection>
+	bool IntersectLeaf(const Ray & ray, unsigned int offset, unsigned int count, OnIntersection onIntersection) const;
+};
+
+template<typename OnIntersection>
+bool RenderGroup::IntersectLeaf(const Ray & ray, unsigned int offset, unsigned int count, OnIntersection onIntersection) const {
+	const std::vector<unsigned int> & itemIndices = accelerationStructure.GetItemIndices();
+	const unsigned int end = offset + count;
+	for (unsigned int begin = offset; begin < end; begin += PackedTriangles::WIDTH) {
+		float distances[PackedTriangles::WIDTH];
+		const unsigned int laneCount = glm::min<unsigned int>(PackedTriangles::WIDTH, end - begin);
+		const unsigned int hitMask = packedTriangles.Intersect(ray, begin, laneCount, distances);
+		for (unsigned int lane = 0; hitMask >> lane != 0; ++lane) {
+			const unsigned int item = itemIndices[begin + lane];
+			if ((hitMask & (1u << lane)) != 0 && (triangleMesh != nullptr || primitives[item]->enabled) &&
+				distances[lane] < ray.tMax && onIntersection(item, distances[lane])) {
+				return true;
+			}
+		}
+	}
+
+	if (packedTriangles.ContainsOtherPrimitives()) {
+		for (unsigned int i = offset; i < end; ++i) {
+			if (packedTriangles.IsPacked(i)) {
+				continue;
+			}
+			const Primitive * primitive = primitives[itemIndices[i]];
+			float distance;
+			if (primitive->enabled && Primitives::RayIntersection(*primitive, ray, distance) && onIntersection(itemIndices[i], distance)) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+template<typename OnIntersection>
+bool RenderGroup::AnyHitPrimitives(const Ray & ray, OnIntersection onIntersection) const {
+	return accelerationStructure.AnyHitLeaves(ray, [&](unsigned int offset, unsigned int count) {
+		return IntersectLeaf(ray, offset, count, onIntersection);
+	});
+}
+
+template<typename OnIntersection>
+bool RenderGroup::AnyHit(const Ray & ray, OnIntersection onIntersection) const {
+	if (instancedRenderGroup != nullptr) {
+		float scale;
+		const Ray instanceRay = TransformRayToInstanceSpace(ray, scale);
+		return instancedRenderGroup->AnyHitPrimitives(instanceRay, [&](unsigned int primitiveIndex, float distance) {
+			return onIntersection(primitiveIndex, distance / scale);
+		});
+	}
+	return AnyHitPrimitives(ray, onIntersection);
+}
\ No newline at end of file
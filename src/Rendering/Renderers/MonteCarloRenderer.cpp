@@ -4,16 +4,25 @@
 #include "../../includes/glm/gtx/norm.hpp"
 #include "../../Utility/Rendering.h"
 
-#define __USE_SPECULAR_LIGHTING true
+template<typename Policy>
+glm::vec3 MonteCarloRenderer<Policy>::GetPixelColor(const Ray & ray, Utility::Sampler & sampler) {
+	return TraceRay(ray, sampler);
+}
 
-glm::vec3 MonteCarloRenderer::GetPixelColor(const Ray & ray) {
-	return TraceRay(ray);
+template<typename Policy>
+glm::vec3 MonteCarloRenderer<Policy>::GetPixelColor(const Ray & ray, const Scene::Intersection * intersection, Utility::Sampler & sampler) {
+	if (MAX_DEPTH == 0 || intersection == nullptr) {
+		return glm::vec3(0);
+	}
+	return ShadeIntersection(ray, intersection->renderGroupIndex, intersection->primitiveIndex, intersection->distance, sampler);
 }
 
-MonteCarloRenderer::MonteCarloRenderer(Scene & _scene, const unsigned int _MAX_DEPTH) :
+template<typename Policy>
+MonteCarloRenderer<Policy>::MonteCarloRenderer(Scene & _scene, const unsigned int _MAX_DEPTH) :
 	MAX_DEPTH(_MAX_DEPTH), Renderer("Monte Carlo Renderer", _scene) { }
 
-glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPTH) {
+template<typename Policy>
+glm::vec3 MonteCarloRenderer<Policy>::TraceRay(const Ray & ray, Utility::Sampler & sampler, const unsigned int DEPTH) {
 	if (DEPTH == MAX_DEPTH) {
 		return glm::vec3(0);
 	}
@@ -21,10 +30,6 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 	assert(DEPTH >= 0 && DEPTH < MAX_DEPTH);
 	assert(glm::length(ray.direction) > 1.0f - 10.0f * FLT_EPSILON && glm::length(ray.direction) < 1.0f + 10.0f * FLT_EPSILON);
 
-	// Nudge the ray a little bit. 
-	// This is not really required, but it removes some unnecessary "misses" (due to floating point errors).
-	Ray ray(_ray.from + 0.001f * _ray.direction, _ray.direction);
-
 	// See if our current ray hits anything in the scene.
 	float intersectionDistance;
 	unsigned int intersectionPrimitiveIndex, intersectionRenderGroupIndex;
@@ -35,15 +40,20 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 		return glm::vec3(0);
 	}
 
+	return ShadeIntersection(ray, intersectionRenderGroupIndex, intersectionPrimitiveIndex, intersectionDistance, sampler, DEPTH);
+}
+
+template<typename Policy>
+glm::vec3 MonteCarloRenderer<Policy>::ShadeIntersection(const Ray & ray, unsigned int intersectionRenderGroupIndex, unsigned int intersectionPrimitiveIndex,
+														float intersectionDistance, Utility::Sampler & sampler, const unsigned int DEPTH) {
 	// Calculate intersection point.
 	const glm::vec3 intersectionPoint = ray.from + ray.direction * intersectionDistance;
 
 	// Retrieve primitive information for the intersected object. 
 	auto & intersectionRenderGroup = scene.renderGroups[intersectionRenderGroupIndex];
-	const auto & intersectionPrimitive = intersectionRenderGroup.primitives[intersectionPrimitiveIndex];
 
 	// Calculate hit normal.
-	const glm::vec3 hitNormal = intersectionPrimitive->GetNormal(intersectionPoint);
+	const glm::vec3 hitNormal = intersectionRenderGroup.GetNormal(intersectionPrimitiveIndex, intersectionPoint);
 	if (glm::dot(-ray.direction, hitNormal) < FLT_EPSILON) {
 		return glm::vec3(0); // Back face culling.
 	}
@@ -59,8 +69,8 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 		if (DEPTH >= 1) {
 			f *= glm::dot(-ray.direction, hitNormal);
 		}
-		auto self = hitMaterial->CalculateDiffuseLighting(-hitNormal, -ray.direction, hitNormal, hitMaterial->GetEmissionColor());
-		return f * hitMaterial->GetEmissionColor() + self;
+		auto self = Policy::CalculateDiffuseLighting(*hitMaterial, -hitNormal, -ray.direction, hitNormal, Policy::GetEmissionColor(*hitMaterial));
+		return f * Policy::GetEmissionColor(*hitMaterial) + self;
 	}
 
 	// Initialize color accumulator.
@@ -74,39 +84,32 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 	if (rf > FLT_EPSILON && tf > FLT_EPSILON) {
 		for (RenderGroup * lightSource : scene.emissiveRenderGroups) {
 
-			// Create a shadow ray.
-			const glm::vec3 randomLightSurfacePosition = lightSource->GetRandomPositionOnSurface();
+			// Create a shadow ray towards a random position on the light source.
+			glm::vec3 lightNormal;
+			const glm::vec3 randomLightSurfacePosition = lightSource->GetRandomPositionOnSurface(lightNormal, sampler);
 			const glm::vec3 shadowRayDirection = glm::normalize(randomLightSurfacePosition - intersectionPoint);
 			if (glm::dot(shadowRayDirection, hitNormal) < FLT_EPSILON) {
 				continue;
 			}
-			const Ray shadowRay(intersectionPoint + hitNormal * 0.0001f, shadowRayDirection);
-
-			// Cast the shadow ray towards the light source.
-			unsigned int shadowRayGroupIndex, shadowRayPrimitiveIndex;
-			if (scene.RayCast(shadowRay, shadowRayGroupIndex, shadowRayPrimitiveIndex, intersectionDistance)) {
-				const auto & renderGroup = scene.renderGroups[shadowRayGroupIndex];
-				if (&renderGroup == lightSource) {
-
-					// We hit the light. Add it's contribution to the color accumulator.
-					const Primitive * lightPrimitive = renderGroup.primitives[shadowRayPrimitiveIndex];
-					const glm::vec3 lightNormal = lightPrimitive->GetNormal(shadowRay.from + intersectionDistance * shadowRay.direction);
-					float lightFactor = glm::dot(-shadowRay.direction, lightNormal);
-					if (lightFactor < FLT_EPSILON) {
-						continue;
-					}
-
-					// Direct diffuse lighting.
-					const glm::vec3 radiance = lightFactor * lightSource->material->GetEmissionColor();
-					colorAccumulator += rf * tf * hitMaterial->CalculateDiffuseLighting(-shadowRay.direction, -ray.direction, hitNormal, radiance);
-
-#if __USE_SPECULAR_LIGHTING
-					// Specular lighting.
-					if (hitMaterial->IsSpecular()) {
-						colorAccumulator += hitMaterial->CalculateSpecularLighting(-shadowRay.direction, -ray.direction, hitNormal, radiance);
-					}
-#endif
-				}
+			const float lightFactor = glm::dot(-shadowRayDirection, lightNormal);
+			if (lightFactor < FLT_EPSILON) {
+				continue;
+			}
+
+			// The light is only visible if nothing blocks the shadow ray before it reaches the light surface.
+			const float lightDistance = glm::distance(intersectionPoint, randomLightSurfacePosition);
+			const Ray shadowRay(intersectionPoint, shadowRayDirection, Ray::SELF_INTERSECTION_EPSILON, lightDistance - Ray::SELF_INTERSECTION_EPSILON);
+			if (scene.Occluded(shadowRay)) {
+				continue;
+			}
+
+			// Direct diffuse lighting.
+			const glm::vec3 radiance = lightFactor * Policy::GetEmissionColor(*lightSource->material);
+			colorAccumulator += rf * tf * Policy::CalculateDiffuseLighting(*hitMaterial, -shadowRay.direction, -ray.direction, hitNormal, radiance);
+
+			// Specular lighting.
+			if (Policy::SPECULAR_LIGHTING && hitMaterial->IsSpecular()) {
+				colorAccumulator += Policy::CalculateSpecularLighting(*hitMaterial, -shadowRay.direction, -ray.direction, hitNormal, radiance);
 			}
 		}
 	}
@@ -118,11 +121,11 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 	// -------------------------------
 	if (rf > FLT_EPSILON && tf > FLT_EPSILON) {
 		// Shoot rays and integrate diffuse lighting based on BRDF to compute indirect lighting. 
-		const glm::vec3 reflectionDirection = Utility::Math::CosineWeightedHemisphereSampleDirection(hitNormal);
+		const glm::vec3 reflectionDirection = Utility::Math::CosineWeightedHemisphereSampleDirection(hitNormal, sampler);
 		assert(dot(reflectionDirection, hitNormal) > -FLT_EPSILON);
 		const Ray diffuseRay(intersectionPoint, reflectionDirection);
-		const auto incomingRadiance = TraceRay(diffuseRay, DEPTH + 1);
-		colorAccumulator += hitMaterial->CalculateDiffuseLighting(-diffuseRay.direction, -ray.direction, hitNormal, incomingRadiance);
+		const auto incomingRadiance = TraceRay(diffuseRay, sampler, DEPTH + 1);
+		colorAccumulator += Policy::CalculateDiffuseLighting(*hitMaterial, -diffuseRay.direction, -ray.direction, hitNormal, incomingRadiance);
 	}
 
 	colorAccumulator *= rf * tf;
@@ -138,25 +141,23 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 		float schlickConstantInside = schlickConstantOutside;
 
 		// Refract ray.
-		glm::vec3 offset = hitNormal * 0.001f;
-		Ray refractedRay(intersectionPoint - offset, glm::refract(ray.direction, hitNormal, n1 / n2));
+		Ray refractedRay(intersectionPoint, glm::refract(ray.direction, hitNormal, n1 / n2));
 		if (scene.RenderGroupRayCast(refractedRay, intersectionRenderGroupIndex, intersectionPrimitiveIndex, intersectionDistance)) {
-			const auto & refractedRayHitPrimitive = intersectionRenderGroup.primitives[intersectionPrimitiveIndex];
 			const glm::vec3 refractedIntersectionPoint = refractedRay.from + refractedRay.direction * intersectionDistance;
-			const glm::vec3 refractedHitNormal = refractedRayHitPrimitive->GetNormal(refractedIntersectionPoint);
+			const glm::vec3 refractedHitNormal = intersectionRenderGroup.GetNormal(intersectionPrimitiveIndex, refractedIntersectionPoint);
 			schlickConstantInside = Utility::Rendering::CalculateSchlicksApproximation(refractedRay.direction, -refractedHitNormal, n2, n1);
-			Ray refractedRayOut(refractedIntersectionPoint + 0.01f * refractedHitNormal, glm::refract(refractedRay.direction, -refractedHitNormal, n2 / n1));
+			Ray refractedRayOut(refractedIntersectionPoint, glm::refract(refractedRay.direction, -refractedHitNormal, n2 / n1));
 			const float f1 = (1.0f - schlickConstantOutside) * (hitMaterial->transparency);
 			const float f2 = (1.0f - schlickConstantInside);
-			const auto incomingRadiance = f2 * TraceRay(refractedRayOut, DEPTH + 1);
-			colorAccumulator += f1 * hitMaterial->CalculateDiffuseLighting(refractedRay.direction, -ray.direction, hitNormal, incomingRadiance);
+			const auto incomingRadiance = f2 * TraceRay(refractedRayOut, sampler, DEPTH + 1);
+			colorAccumulator += f1 * Policy::CalculateDiffuseLighting(*hitMaterial, refractedRay.direction, -ray.direction, hitNormal, incomingRadiance);
 		}
 		else {
-			colorAccumulator += (1.0f - schlickConstantOutside) * (hitMaterial->transparency) * TraceRay(refractedRay, DEPTH + 1);
+			colorAccumulator += (1.0f - schlickConstantOutside) * (hitMaterial->transparency) * TraceRay(refractedRay, sampler, DEPTH + 1);
 		}
 		Ray specularRay(intersectionPoint, glm::reflect(ray.direction, hitNormal));
 		const float sf = schlickConstantOutside * hitMaterial->specularity;
-		colorAccumulator += sf * hitMaterial->CalculateSpecularLighting(-specularRay.direction, -ray.direction, hitNormal, TraceRay(specularRay, DEPTH + 1));
+		colorAccumulator += sf * Policy::CalculateSpecularLighting(*hitMaterial, -specularRay.direction, -ray.direction, hitNormal, TraceRay(specularRay, sampler, DEPTH + 1));
 	}
 
 	// -------------------------------
@@ -164,9 +165,15 @@ glm::vec3 MonteCarloRenderer::TraceRay(const Ray & _ray, const unsigned int DEPT
 	// -------------------------------
 	if (hitMaterial->IsReflective()) {
 		Ray reflectedRay(intersectionPoint, glm::reflect(ray.direction, hitNormal));
-		colorAccumulator += hitMaterial->reflectivity * TraceRay(reflectedRay, DEPTH + 1);
+		colorAccumulator += hitMaterial->reflectivity * TraceRay(reflectedRay, sampler, DEPTH + 1);
 	}
 
 	// Return result.
 	return colorAccumulator;
 }
+
+Renderer * CreateMonteCarloRenderer(Scene & scene, const unsigned int MAX_DEPTH, const unsigned int FEATURES) {
+	const unsigned int USED_FEATURES = RenderFeatures::OREN_NAYAR_MATERIALS | RenderFeatures::SPECULAR_LIGHTING;
+	const unsigned int features = (FEATURES | RenderPolicies::GetMaterialFeatures(scene.materials)) & USED_FEATURES;
+	return RenderPolicies::Instantiation<MonteCarloRenderer, USED_FEATURES>::Create(features, scene, MAX_DEPTH);
+}
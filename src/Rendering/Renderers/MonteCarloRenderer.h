@@ -3,15 +3,30 @@
 #include <vector>
 
 #include "Renderer.h"
+#include "RenderPolicy.h"
 #include "../../Scene/Scene.h"
 
+/// <summary>
+/// Creates a MonteCarloRenderer for the scene, specialized for its material types and the given RenderFeatures
+/// (of which it uses SPECULAR_LIGHTING).
+/// </summary>
+Renderer * CreateMonteCarloRenderer(Scene & scene, const unsigned int MAX_DEPTH = 5,
+									const unsigned int FEATURES = RenderFeatures::MONTE_CARLO_DEFAULTS);
+
+/// <summary> A path tracer with a trace kernel specialized for a RenderPolicy (see CreateMonteCarloRenderer). </summary>
+template<typename Policy>
 class MonteCarloRenderer : public Renderer {
 public:
-	glm::vec3 GetPixelColor(const Ray & ray) override;
+	glm::vec3 GetPixelColor(const Ray & ray, Utility::Sampler & sampler) override;
+	glm::vec3 GetPixelColor(const Ray & ray, const Scene::Intersection * intersection, Utility::Sampler & sampler) override;
 	MonteCarloRenderer(Scene & scene, const unsigned int MAX_DEPTH = 5);
 private:
 	const unsigned int MAX_DEPTH;
 
 	/// <summary> Traces a ray through the scene. </summary>
-	glm::vec3 TraceRay(const Ray & ray, const unsigned int DEPTH = 0);
+	glm::vec3 TraceRay(const Ray & ray, Utility::Sampler & sampler, const unsigned int DEPTH = 0);
+
+	/// <summary> Computes the light leaving an intersection of the ray towards the ray origin. </summary>
+	glm::vec3 ShadeIntersection(const Ray & ray, unsigned int intersectionRenderGroupIndex, unsigned int intersectionPrimitiveIndex,
+								float intersectionDistance, Utility::Sampler & sampler, const unsigned int DEPTH = 0);
 };
\ No newline at end of file
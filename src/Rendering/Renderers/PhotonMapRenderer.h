@@ -1,13 +1,27 @@
 #pragma once
 
 #include "Renderer.h"
+#include "RenderPolicy.h"
 #include "../../Scene/Scene.h"
 
+/// <summary>
+/// Creates a PhotonMapRenderer for the scene, specialized for its material types and the given RenderFeatures.
+/// </summary>
+Renderer * CreatePhotonMapRenderer(Scene & scene, const unsigned int MAX_DEPTH = 5, const unsigned int BOUNCES_PER_HIT = 1,
+								   const unsigned int PHOTONS_PER_LIGHT_SOURCE = 1000000, const unsigned int MAX_PHOTON_DEPTH = 3,
+								   const unsigned int FEATURES = RenderFeatures::PHOTON_MAP_DEFAULTS);
+
+/// <summary>
+/// A ray tracer which uses photon maps for shadows and caustics, with a trace kernel specialized for a RenderPolicy
+/// (see CreatePhotonMapRenderer).
+/// </summary>
+template<typename Policy>
 class PhotonMapRenderer : public Renderer {
 public:
 	PhotonMapRenderer(Scene & scene, const unsigned int MAX_DEPTH = 5, const unsigned int BOUNCES_PER_HIT = 1,
 					  const unsigned int PHOTONS_PER_LIGHT_SOURCE = 1000000, const unsigned int MAX_PHOTON_DEPTH = 3);
-	glm::vec3 GetPixelColor(const Ray & ray) override;
+	glm::vec3 GetPixelColor(const Ray & ray, Utility::Sampler & sampler) override;
+	glm::vec3 GetPixelColor(const Ray & ray, const Scene::Intersection * intersection, Utility::Sampler & sampler) override;
 private:
 	const unsigned int MAX_DEPTH, BOUNCES_PER_HIT;
 	const float PHOTON_SEARCH_RADIUS = 0.5f;
@@ -19,5 +33,9 @@ private:
 	PhotonMap* photonMap;
 
 	/// <summary> Traces a ray through the scene. </summary>
-	glm::vec3 TraceRay(const Ray & ray, const unsigned int DEPTH = 0);
+	glm::vec3 TraceRay(const Ray & ray, Utility::Sampler & sampler, const unsigned int DEPTH = 0);
+
+	/// <summary> Computes the light leaving an intersection of the ray towards the ray origin. </summary>
+	glm::vec3 ShadeIntersection(const Ray & ray, unsigned int intersectionRenderGroupIndex, unsigned int intersectionPrimitiveIndex,
+								float intersectionDistance, Utility::Sampler & sampler, const unsigned int DEPTH = 0);
 };
\ No newline at end of file
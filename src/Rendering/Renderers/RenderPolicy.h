@@ -0,0 +1,108 @@
+#pragma once
+
+#include <utility>
+
+#include <glm.hpp>
+
+#include "Renderer.h"
+#include "../Materials/Material.h"
+#include "../Materials/LambertianMaterial.h"
+#include "../Materials/OrenNayarMaterial.h"
+
+/// <summary>
+/// The options of the trace kernels (see MonteCarloRenderer and PhotonMapRenderer). They are template arguments of
+/// the renderers rather than preprocessor switches, so every combination is compiled into the program and picked at
+/// runtime by CreateMonteCarloRenderer and CreatePhotonMapRenderer, with the disabled features compiled out.
+/// </summary>
+namespace RenderFeatures {
+	enum : unsigned int {
+		NONE = 0,
+
+		/// <summary> The scene has Oren-Nayar materials. Set by the renderer factories from the scene. </summary>
+		OREN_NAYAR_MATERIALS = 1 << 0,
+
+		/// <summary> Phong highlights of the light sources on specular materials. </summary>
+		SPECULAR_LIGHTING = 1 << 1,
+
+		/// <summary> Skip the shadow rays where the global photon map is fully lit or shadowed (photon mapping only). </summary>
+		GLOBAL_PHOTON_MAP = 1 << 2,
+
+		/// <summary> Add the caustics photon map to the direct lighting (photon mapping only). </summary>
+		CAUSTICS_PHOTON_MAP = 1 << 3,
+
+		MONTE_CARLO_DEFAULTS = SPECULAR_LIGHTING,
+		PHOTON_MAP_DEFAULTS = GLOBAL_PHOTON_MAP | CAUSTICS_PHOTON_MAP
+	};
+}
+
+/// <summary>
+/// The compile-time configuration of a trace kernel: the material types that can be hit, and which RenderFeatures
+/// are enabled. Materials are shaded through it with direct (inlinable) calls instead of virtual ones.
+/// </summary>
+template<unsigned int FEATURES>
+struct RenderPolicy {
+	static const bool OREN_NAYAR_MATERIALS = (FEATURES & RenderFeatures::OREN_NAYAR_MATERIALS) != 0;
+	static const bool SPECULAR_LIGHTING = (FEATURES & RenderFeatures::SPECULAR_LIGHTING) != 0;
+	static const bool GLOBAL_PHOTON_MAP = (FEATURES & RenderFeatures::GLOBAL_PHOTON_MAP) != 0;
+	static const bool CAUSTICS_PHOTON_MAP = (FEATURES & RenderFeatures::CAUSTICS_PHOTON_MAP) != 0;
+
+	/// <summary> Same as material.GetEmissionColor(). </summary>
+	static glm::vec3 GetEmissionColor(const Material & material) {
+		if (OREN_NAYAR_MATERIALS && material.type == Material::Type::OREN_NAYAR) {
+			return material.emissivity * static_cast<const OrenNayarMaterial &>(material).GetSurfaceColor();
+		}
+		return material.emissivity * static_cast<const LambertianMaterial &>(material).GetSurfaceColor();
+	}
+
+	/// <summary> Same as material.CalculateDiffuseLighting(...). </summary>
+	static glm::vec3 CalculateDiffuseLighting(const Material & material, const glm::vec3 & inDirection, const glm::vec3 & outDirection,
+											  const glm::vec3 & normal, const glm::vec3 & incomingRadiance) {
+		if (OREN_NAYAR_MATERIALS && material.type == Material::Type::OREN_NAYAR) {
+			return static_cast<const OrenNayarMaterial &>(material).CalculateDiffuseLighting(inDirection, outDirection, normal, incomingRadiance);
+		}
+		return static_cast<const LambertianMaterial &>(material).CalculateDiffuseLighting(inDirection, outDirection, normal, incomingRadiance);
+	}
+
+	/// <summary> Same as material.CalculateSpecularLighting(...), which no material overrides. </summary>
+	static glm::vec3 CalculateSpecularLighting(const Material & material, const glm::vec3 & inDirection, const glm::vec3 & outDirection,
+											   const glm::vec3 & normal, const glm::vec3 & incomingRadiance) {
+		return material.Material::CalculateSpecularLighting(inDirection, outDirection, normal, incomingRadiance);
+	}
+};
+
+namespace RenderPolicies {
+	/// <summary> Returns RenderFeatures::OREN_NAYAR_MATERIALS if any of the materials is an Oren-Nayar material. </summary>
+	template<typename MaterialContainer>
+	unsigned int GetMaterialFeatures(const MaterialContainer & materials) {
+		for (const Material * material : materials) {
+			if (material->type == Material::Type::OREN_NAYAR) {
+				return RenderFeatures::OREN_NAYAR_MATERIALS;
+			}
+		}
+		return RenderFeatures::NONE;
+	}
+
+	/// <summary>
+	/// Creates a RendererTemplate<RenderPolicy<features>> with the given constructor arguments, by comparing the runtime
+	/// features against every compile-time FEATURES from MAX_FEATURES down to 0. This instantiates the renderer for all
+	/// of them, so MAX_FEATURES should be the highest flag combination that the renderer uses.
+	/// </summary>
+	template<template<typename> class RendererTemplate, unsigned int MAX_FEATURES>
+	struct Instantiation {
+		template<typename ... Arguments>
+		static Renderer * Create(unsigned int features, Arguments && ... arguments) {
+			if (features == MAX_FEATURES) {
+				return new RendererTemplate<RenderPolicy<MAX_FEATURES>>(std::forward<Arguments>(arguments)...);
+			}
+			return Instantiation<RendererTemplate, MAX_FEATURES - 1>::Create(features, std::forward<Arguments>(arguments)...);
+		}
+	};
+
+	template<template<typename> class RendererTemplate>
+	struct Instantiation<RendererTemplate, 0> {
+		template<typename ... Arguments>
+		static Renderer * Create(unsigned int /*features*/, Arguments && ... arguments) {
+			return new RendererTemplate<RenderPolicy<0>>(std::forward<Arguments>(arguments)...);
+		}
+	};
+}
@@ -7,10 +7,21 @@
 #include "../../Geometry/Ray.h"
 #include "../Materials/Material.h"
 #include "../../Scene/Scene.h"
+#include "../../Utility/Sampler.h"
 
 class Renderer {
 public:
-	virtual glm::vec3 GetPixelColor(const Ray & ray) = 0;
+	/// <summary> 
+	/// Returns the color seen along a primary ray. Everything random in it is drawn from the given sampler, which
+	/// belongs to the calling thread and has been started at the renderer's first dimension of the sample.
+	/// </summary>
+	virtual glm::vec3 GetPixelColor(const Ray & ray, Utility::Sampler & sampler) = 0;
+
+	/// <summary> 
+	/// Same as GetPixelColor(ray), but the ray has already been cast through the scene (e.g. in a RayPacket).
+	/// The intersection is nullptr if the ray doesn't intersect anything.
+	/// </summary>
+	virtual glm::vec3 GetPixelColor(const Ray & ray, const Scene::Intersection * intersection, Utility::Sampler & sampler) = 0;
 	const std::string RENDERER_NAME = "Unknown Name";
 protected:
 	Renderer(const std::string NAME, Scene & _scene) : RENDERER_NAME(NAME), scene(_scene) { }
@@ -0,0 +1,862 @@
+#include "MeshImporter.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <unordered_map>
+
+#include "../Utility/MappedFile.h"
+
+namespace {
+	const unsigned int NO_INDEX = UINT_MAX;
+
+	// The size of the chunks that an OBJ file is split into for parsing.
+	const size_t CHUNK_SIZE = 1 << 20;
+
+	inline bool IsBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+	inline void SkipBlanks(const char *& p, const char * end) {
+		while (p < end && IsBlank(*p)) { ++p; }
+	}
+
+	// Moves p to the start of the next line.
+	inline void SkipLine(const char *& p, const char * end) {
+		const char * newline = static_cast<const char *>(memchr(p, '\n', end - p));
+		p = newline != nullptr ? newline + 1 : end;
+	}
+
+	// Returns true if the line at p starts with the given keyword followed by a blank, and moves p past the keyword.
+	inline bool ParseKeyword(const char *& p, const char * end, const char * keyword) {
+		const char * q = p;
+		while (*keyword != '\0') {
+			if (q == end || *q != *keyword) {
+				return false;
+			}
+			++q;
+			++keyword;
+		}
+		if (q == end || !IsBlank(*q)) {
+			return false;
+		}
+		p = q;
+		return true;
+	}
+
+	// Parses the rest of the line as a name, without its surrounding blanks.
+	std::string ParseName(const char *& p, const char * end) {
+		SkipBlanks(p, end);
+		const char * begin = p;
+		while (p < end && *p != '\n') { ++p; }
+		const char * last = p;
+		while (last > begin && IsBlank(last[-1])) { --last; }
+		return std::string(begin, last);
+	}
+
+	inline bool ParseInteger(const char *& p, const char * end, long long & value) {
+		SkipBlanks(p, end);
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			++p;
+		}
+		if (p == end || *p < '0' || *p > '9') {
+			return false;
+		}
+		long long result = 0;
+		while (p < end && *p >= '0' && *p <= '9') {
+			if (result < LLONG_MAX / 10) {
+				result = 10 * result + (*p - '0');
+			}
+			++p;
+		}
+		value = negative ? -result : result;
+		return true;
+	}
+
+	// A locale independent replacement for strtof, which needs a null terminated string (the mapped file isn't).
+	// Exact for the usual short decimals; longer ones are rounded twice, which is well below float precision.
+	inline bool ParseFloat(const char *& p, const char * end, float & value) {
+		static const double POWERS_OF_TEN[] = {
+			1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+			1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+		};
+
+		SkipBlanks(p, end);
+		bool negative = false;
+		if (p < end && (*p == '-' || *p == '+')) {
+			negative = *p == '-';
+			++p;
+		}
+
+		unsigned long long mantissa = 0;
+		int exponent = 0, digits = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+			if (mantissa < 100000000000000000ULL) {
+				mantissa = 10 * mantissa + (*p - '0');
+			}
+			else {
+				++exponent;
+			}
+		}
+		if (p < end && *p == '.') {
+			for (++p; p < end && *p >= '0' && *p <= '9'; ++p, ++digits) {
+				if (mantissa < 100000000000000000ULL) {
+					mantissa = 10 * mantissa + (*p - '0');
+					--exponent;
+				}
+			}
+		}
+		if (digits == 0) {
+			return false;
+		}
+		if (p < end && (*p == 'e' || *p == 'E')) {
+			long long explicitExponent;
+			if (!ParseInteger(++p, end, explicitExponent)) {
+				return false;
+			}
+			exponent += static_cast<int>(std::max(-1000LL, std::min(1000LL, explicitExponent)));
+		}
+
+		double result = static_cast<double>(mantissa);
+		if (exponent < 0) {
+			result = exponent >= -22 ? result / POWERS_OF_TEN[-exponent] : result * std::pow(10.0, exponent);
+		}
+		else if (exponent > 0) {
+			result = exponent <= 22 ? result * POWERS_OF_TEN[exponent] : result * std::pow(10.0, exponent);
+		}
+		value = static_cast<float>(negative ? -result : result);
+		return true;
+	}
+
+	std::string GetDirectory(const std::string & path) {
+		const size_t separator = path.find_last_of("/\\");
+		return separator == std::string::npos ? std::string() : path.substr(0, separator + 1);
+	}
+
+	std::string GetLowerCaseExtension(const std::string & path) {
+		const size_t dot = path.find_last_of('.');
+		if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) {
+			return std::string();
+		}
+		std::string extension = path.substr(dot + 1);
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+		return extension;
+	}
+
+	struct ObjMaterial {
+		glm::vec3 diffuseColor = glm::vec3(1.0f);
+		glm::vec3 emissionColor = glm::vec3(0.0f);
+	};
+
+	// Reads the diffuse (Kd) and emission (Ke) colors of the materials in an MTL file. Material libraries are tiny
+	// compared to the meshes that use them, so they are read with plain streams.
+	void LoadMaterialLibrary(const std::string & path, std::map<std::string, ObjMaterial> & materials) {
+		std::ifstream file(path);
+		if (!file) {
+			std::cerr << "Could not open the material library " << path << "." << std::endl;
+			return;
+		}
+
+		ObjMaterial * material = nullptr;
+		std::string line, keyword;
+		while (std::getline(file, line)) {
+			std::istringstream stream(line);
+			stream.imbue(std::locale::classic());
+			if (!(stream >> keyword)) {
+				continue;
+			}
+			if (keyword == "newmtl") {
+				std::string name;
+				std::getline(stream >> std::ws, name);
+				name.erase(name.find_last_not_of(" \t\r") + 1);
+				material = &materials[name];
+			}
+			else if (material != nullptr && (keyword == "Kd" || keyword == "Ke")) {
+				glm::vec3 color;
+				if (stream >> color.r >> color.g >> color.b) {
+					(keyword == "Kd" ? material->diffuseColor : material->emissionColor) = color;
+				}
+			}
+		}
+	}
+
+	// A part of an OBJ file, starting and ending at line boundaries.
+	struct ObjChunk {
+		const char * begin;
+		const char * end;
+
+		// The number of vertices (v) and normals (vn) in the chunk, and in all chunks before it.
+		unsigned int positionCount = 0, normalCount = 0;
+		unsigned int positionOffset = 0, normalOffset = 0;
+
+		// The triangles of the chunk, as indices into the positions and normals of the whole file. The normal indices
+		// are only stored if the file has normals, and are NO_INDEX for the triangles without them.
+		std::vector<glm::uvec3> positionIndices, normalIndices;
+
+		// The usemtl statements in the chunk: the index of the first triangle after them, and the material name.
+		std::vector<std::pair<size_t, std::string>> materialChanges;
+		std::vector<std::string> materialLibraries;
+
+		// The line number (within the chunk) of the first line that couldn't be parsed, or 0.
+		size_t errorLine = 0;
+	};
+
+	// Counts the vertices and normals in a chunk, to place them in the arrays of the whole file.
+	void CountObjChunk(ObjChunk & chunk) {
+		for (const char * p = chunk.begin; p < chunk.end; SkipLine(p, chunk.end)) {
+			SkipBlanks(p, chunk.end);
+			if (p + 1 < chunk.end && p[0] == 'v') {
+				if (IsBlank(p[1])) {
+					++chunk.positionCount;
+				}
+				else if (p[1] == 'n' && p + 2 < chunk.end && IsBlank(p[2])) {
+					++chunk.normalCount;
+				}
+			}
+		}
+	}
+
+	// Parses a face vertex (v, v/vt, v//vn or v/vt/vn) and resolves its indices (which are 1-based, or relative
+	// to the last vertex if negative). Returns false if the vertex is malformed or refers to a missing vertex.
+	inline bool ParseFaceVertex(const char *& p, const char * end, long long positionsBefore, long long positionCount,
+								long long normalsBefore, long long normalCount, unsigned int & position, unsigned int & normal) {
+		long long index;
+		if (!ParseInteger(p, end, index)) {
+			return false;
+		}
+		index = index < 0 ? positionsBefore + index : index - 1;
+		if (index < 0 || index >= positionCount) {
+			return false;
+		}
+		position = static_cast<unsigned int>(index);
+		normal = NO_INDEX;
+
+		if (p < end && *p == '/') {
+			++p;
+			if (p < end && *p != '/') {
+				long long textureCoordinate;
+				if (!ParseInteger(p, end, textureCoordinate)) {
+					return false;
+				}
+			}
+			if (p < end && *p == '/') {
+				++p;
+				if (!ParseInteger(p, end, index)) {
+					return false;
+				}
+				index = index < 0 ? normalsBefore + index : index - 1;
+				if (index < 0 || index >= normalCount) {
+					return false;
+				}
+				normal = static_cast<unsigned int>(index);
+			}
+		}
+		return true;
+	}
+
+	// Parses the vertices, normals and faces of a chunk, writing the vertices and normals straight into the arrays
+	// of the whole file. No memory is allocated per line, only when the triangle arrays of the chunk grow.
+	void ParseObjChunk(ObjChunk & chunk, std::vector<glm::vec3> & positions, std::vector<glm::vec3> & normals) {
+		const char * const end = chunk.end;
+		const long long positionCount = static_cast<long long>(positions.size());
+		const long long normalCount = static_cast<long long>(normals.size());
+		unsigned int position = chunk.positionOffset, normal = chunk.normalOffset;
+
+		size_t line = 1;
+		for (const char * p = chunk.begin; p < end; SkipLine(p, end), ++line) {
+			SkipBlanks(p, end);
+			if (p == end || *p == '\n' || *p == '#') {
+				continue;
+			}
+
+			bool valid = true;
+			if (ParseKeyword(p, end, "v")) {
+				glm::vec3 & vertex = positions[position++];
+				valid = ParseFloat(p, end, vertex.x) && ParseFloat(p, end, vertex.y) && ParseFloat(p, end, vertex.z);
+			}
+			else if (ParseKeyword(p, end, "vn")) {
+				glm::vec3 & vertexNormal = normals[normal++];
+				valid = ParseFloat(p, end, vertexNormal.x) && ParseFloat(p, end, vertexNormal.y) && ParseFloat(p, end, vertexNormal.z);
+			}
+			else if (ParseKeyword(p, end, "f")) {
+				// Triangulate the polygon as a fan around its first vertex.
+				glm::uvec3 triangle, triangleNormals;
+				unsigned int vertexCount = 0;
+				for (SkipBlanks(p, end); valid && p < end && *p != '\n' && *p != '#'; SkipBlanks(p, end), ++vertexCount) {
+					unsigned int vertexPosition, vertexNormal;
+					valid = ParseFaceVertex(p, end, position, positionCount, normal, normalCount, vertexPosition, vertexNormal);
+					if (valid && vertexCount >= 2) {
+						triangle[2] = vertexPosition;
+						triangleNormals[2] = vertexNormal;
+						chunk.positionIndices.push_back(triangle);
+						if (normalCount > 0) {
+							chunk.normalIndices.push_back(triangleNormals);
+						}
+						triangle[1] = triangle[2];
+						triangleNormals[1] = triangleNormals[2];
+					}
+					else if (valid) {
+						triangle[vertexCount] = vertexPosition;
+						triangleNormals[vertexCount] = vertexNormal;
+					}
+				}
+				valid = valid && vertexCount >= 3;
+			}
+			else if (ParseKeyword(p, end, "usemtl")) {
+				chunk.materialChanges.emplace_back(chunk.positionIndices.size(), ParseName(p, end));
+			}
+			else if (ParseKeyword(p, end, "mtllib")) {
+				chunk.materialLibraries.push_back(ParseName(p, end));
+			}
+
+			// Everything else (texture coordinates, groups, smoothing groups, lines, ...) is skipped.
+			if (!valid && chunk.errorLine == 0) {
+				chunk.errorLine = line;
+			}
+		}
+	}
+
+	// Creates a mesh from the given triangles of a file, with only the vertices (and the position and normal
+	// combinations) that they use.
+	TriangleMesh CreateMesh(const std::vector<glm::vec3> & positions, const std::vector<glm::vec3> & normals,
+							const std::vector<glm::uvec3> & positionIndices, const std::vector<glm::uvec3> & normalIndices,
+							const std::vector<unsigned int> & triangles, std::vector<unsigned int> & positionRemap) {
+		TriangleMesh mesh;
+		mesh.indices.resize(triangles.size());
+
+		if (normalIndices.empty()) {
+			// positionRemap has an entry per position of the file, NO_INDEX for the positions not yet in this mesh.
+			for (size_t i = 0; i < triangles.size(); ++i) {
+				for (unsigned int k = 0; k < 3; ++k) {
+					unsigned int & vertex = positionRemap[positionIndices[triangles[i]][k]];
+					if (vertex == NO_INDEX) {
+						vertex = static_cast<unsigned int>(mesh.vertices.size());
+						mesh.vertices.push_back(positions[positionIndices[triangles[i]][k]]);
+					}
+					mesh.indices[i][k] = vertex;
+				}
+			}
+			for (size_t i = 0; i < triangles.size(); ++i) {
+				for (unsigned int k = 0; k < 3; ++k) {
+					positionRemap[positionIndices[triangles[i]][k]] = NO_INDEX;
+				}
+			}
+			return mesh;
+		}
+
+		std::unordered_map<unsigned long long, unsigned int> vertices;
+		vertices.reserve(triangles.size());
+		for (size_t i = 0; i < triangles.size(); ++i) {
+			for (unsigned int k = 0; k < 3; ++k) {
+				const unsigned int position = positionIndices[triangles[i]][k], normal = normalIndices[triangles[i]][k];
+				const auto vertex = vertices.emplace((static_cast<unsigned long long>(normal) << 32) | position,
+													 static_cast<unsigned int>(mesh.vertices.size()));
+				if (vertex.second) {
+					mesh.vertices.push_back(positions[position]);
+					mesh.normals.push_back(normals[normal]);
+				}
+				mesh.indices[i][k] = vertex.first->second;
+			}
+		}
+		return mesh;
+	}
+
+	enum class PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, INVALID };
+
+	PlyType GetPlyType(const std::string & name) {
+		if (name == "char" || name == "int8") return PlyType::INT8;
+		if (name == "uchar" || name == "uint8") return PlyType::UINT8;
+		if (name == "short" || name == "int16") return PlyType::INT16;
+		if (name == "ushort" || name == "uint16") return PlyType::UINT16;
+		if (name == "int" || name == "int32") return PlyType::INT32;
+		if (name == "uint" || name == "uint32") return PlyType::UINT32;
+		if (name == "float" || name == "float32") return PlyType::FLOAT32;
+		if (name == "double" || name == "float64") return PlyType::FLOAT64;
+		return PlyType::INVALID;
+	}
+
+	size_t GetPlyTypeSize(PlyType type) {
+		static const size_t SIZES[] = { 1, 1, 2, 2, 4, 4, 4, 8, 0 };
+		return SIZES[static_cast<int>(type)];
+	}
+
+	struct PlyProperty {
+		std::string name;
+		PlyType type;
+		// The type of the item count of list properties, INVALID for scalar properties.
+		PlyType countType = PlyType::INVALID;
+	};
+
+	struct PlyElement {
+		std::string name;
+		size_t count;
+		std::vector<PlyProperty> properties;
+
+		// Returns the size in bytes of each element, or 0 if the elements have list properties.
+		size_t GetFixedSize() const {
+			size_t size = 0;
+			for (const PlyProperty & property : properties) {
+				if (property.countType != PlyType::INVALID) {
+					return 0;
+				}
+				size += GetPlyTypeSize(property.type);
+			}
+			return size;
+		}
+	};
+
+	// Reads a scalar of the given type, swapping its bytes if the file is big endian.
+	inline double ReadPlyScalar(const char * p, PlyType type, bool bigEndian) {
+		unsigned char bytes[8];
+		const size_t size = GetPlyTypeSize(type);
+		memcpy(bytes, p, size);
+		if (bigEndian) {
+			std::reverse(bytes, bytes + size);
+		}
+		switch (type) {
+		case PlyType::INT8: { int8_t value; memcpy(&value, bytes, 1); return value; }
+		case PlyType::UINT8: { uint8_t value; memcpy(&value, bytes, 1); return value; }
+		case PlyType::INT16: { int16_t value; memcpy(&value, bytes, 2); return value; }
+		case PlyType::UINT16: { uint16_t value; memcpy(&value, bytes, 2); return value; }
+		case PlyType::INT32: { int32_t value; memcpy(&value, bytes, 4); return value; }
+		case PlyType::UINT32: { uint32_t value; memcpy(&value, bytes, 4); return value; }
+		case PlyType::FLOAT32: { float value; memcpy(&value, bytes, 4); return value; }
+		case PlyType::FLOAT64: { double value; memcpy(&value, bytes, 8); return value; }
+		default: return 0.0;
+		}
+	}
+
+	// Returns the size in bytes of the element at p, or 0 if it doesn't fit before end.
+	size_t GetPlyElementSize(const PlyElement & element, const char * p, const char * end, bool bigEndian) {
+		size_t size = 0;
+		for (const PlyProperty & property : element.properties) {
+			if (property.countType == PlyType::INVALID) {
+				size += GetPlyTypeSize(property.type);
+				continue;
+			}
+			const size_t countSize = GetPlyTypeSize(property.countType);
+			if (static_cast<size_t>(end - p) < size + countSize) {
+				return 0;
+			}
+			const double count = ReadPlyScalar(p + size, property.countType, bigEndian);
+			size += countSize + static_cast<size_t>(std::max(0.0, count)) * GetPlyTypeSize(property.type);
+		}
+		return static_cast<size_t>(end - p) < size ? 0 : size;
+	}
+}
+
+bool MeshImporter::Load(const std::string & path, std::vector<MeshGroup> & groups) {
+	const std::string extension = GetLowerCaseExtension(path);
+	if (extension == "obj") {
+		return LoadOBJ(path, groups);
+	}
+	if (extension == "ply") {
+		return LoadPLY(path, groups);
+	}
+	std::cerr << "Could not load " << path << ": only .obj and .ply files are supported." << std::endl;
+	return false;
+}
+
+bool MeshImporter::LoadOBJ(const std::string & path, std::vector<MeshGroup> & groups) {
+	const Utility::MappedFile file(path);
+	if (!file.IsOpen()) {
+		std::cerr << "Could not open " << path << "." << std::endl;
+		return false;
+	}
+
+	// Split the file into chunks at line boundaries.
+	std::vector<ObjChunk> chunks;
+	const char * const fileEnd = file.GetData() + file.GetSize();
+	for (const char * begin = file.GetData(); begin < fileEnd; ) {
+		ObjChunk chunk;
+		chunk.begin = begin;
+		chunk.end = begin + std::min(CHUNK_SIZE, static_cast<size_t>(fileEnd - begin));
+		if (chunk.end < fileEnd) {
+			SkipLine(chunk.end, fileEnd);
+		}
+		begin = chunk.end;
+		chunks.push_back(std::move(chunk));
+	}
+	const int chunkCount = static_cast<int>(chunks.size());
+
+	// Count the vertices and normals of each chunk, so that the chunks can be parsed independently: the indices
+	// in the faces are global, and relative indices depend on the number of vertices before the face.
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < chunkCount; ++i) {
+		CountObjChunk(chunks[i]);
+	}
+	size_t positionCount = 0, normalCount = 0;
+	for (ObjChunk & chunk : chunks) {
+		chunk.positionOffset = static_cast<unsigned int>(positionCount);
+		chunk.normalOffset = static_cast<unsigned int>(normalCount);
+		positionCount += chunk.positionCount;
+		normalCount += chunk.normalCount;
+	}
+	if (positionCount >= NO_INDEX || normalCount >= NO_INDEX) {
+		std::cerr << "Could not load " << path << ": too many vertices." << std::endl;
+		return false;
+	}
+
+	std::vector<glm::vec3> positions(positionCount), normals(normalCount);
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < chunkCount; ++i) {
+		ParseObjChunk(chunks[i], positions, normals);
+	}
+
+	// Report the first error, counting the lines of the chunks before it.
+	size_t linesBefore = 0;
+	for (const ObjChunk & chunk : chunks) {
+		if (chunk.errorLine != 0) {
+			std::cerr << "Could not load " << path << ": invalid data on line " << linesBefore + chunk.errorLine << "." << std::endl;
+			return false;
+		}
+		linesBefore += std::count(chunk.begin, chunk.end, '\n');
+	}
+
+	// Load the material libraries.
+	std::map<std::string, ObjMaterial> materials;
+	for (const ObjChunk & chunk : chunks) {
+		for (const std::string & library : chunk.materialLibraries) {
+			LoadMaterialLibrary(GetDirectory(path) + library, materials);
+		}
+	}
+
+	// Concatenate the triangles of the chunks, and assign them to groups by the last usemtl before them.
+	std::vector<size_t> triangleOffsets(chunks.size() + 1, 0);
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		triangleOffsets[i + 1] = triangleOffsets[i] + chunks[i].positionIndices.size();
+	}
+	const size_t triangleCount = triangleOffsets.back();
+	if (triangleCount == 0) {
+		std::cerr << "Could not load " << path << ": the file has no faces." << std::endl;
+		return false;
+	}
+
+	std::vector<glm::uvec3> positionIndices(triangleCount), normalIndices(normalCount > 0 ? triangleCount : 0);
+	std::vector<unsigned int> triangleGroups(triangleCount, 0);
+	std::vector<std::string> groupNames(1);
+	std::map<std::string, unsigned int> groupIndices;
+	groupIndices[std::string()] = 0;
+	unsigned int group = 0;
+	for (size_t i = 0; i < chunks.size(); ++i) {
+		const ObjChunk & chunk = chunks[i];
+		size_t triangle = 0;
+		for (size_t change = 0; change <= chunk.materialChanges.size(); ++change) {
+			const size_t last = change < chunk.materialChanges.size() ? chunk.materialChanges[change].first : chunk.positionIndices.size();
+			std::fill(triangleGroups.begin() + triangleOffsets[i] + triangle, triangleGroups.begin() + triangleOffsets[i] + last, group);
+			triangle = last;
+			if (change < chunk.materialChanges.size()) {
+				const auto inserted = groupIndices.emplace(chunk.materialChanges[change].second, static_cast<unsigned int>(groupNames.size()));
+				if (inserted.second) {
+					groupNames.push_back(chunk.materialChanges[change].second);
+				}
+				group = inserted.first->second;
+			}
+		}
+	}
+#pragma omp parallel for schedule(dynamic, 1)
+	for (int i = 0; i < chunkCount; ++i) {
+		std::copy(chunks[i].positionIndices.begin(), chunks[i].positionIndices.end(), positionIndices.begin() + triangleOffsets[i]);
+		std::copy(chunks[i].normalIndices.begin(), chunks[i].normalIndices.end(), normalIndices.begin() + triangleOffsets[i]);
+		std::vector<glm::uvec3>().swap(chunks[i].positionIndices);
+		std::vector<glm::uvec3>().swap(chunks[i].normalIndices);
+	}
+
+	// Sort the triangles into their groups.
+	std::vector<std::vector<unsigned int>> groupTriangles(groupNames.size());
+	for (size_t i = 0; i < triangleCount; ++i) {
+		groupTriangles[triangleGroups[i]].push_back(static_cast<unsigned int>(i));
+	}
+	std::vector<unsigned int>().swap(triangleGroups);
+
+	std::vector<unsigned int> positionRemap;
+	for (size_t i = 0; i < groupNames.size(); ++i) {
+		const std::vector<unsigned int> & triangles = groupTriangles[i];
+		if (triangles.empty()) {
+			continue;
+		}
+
+		MeshGroup meshGroup;
+		meshGroup.materialName = groupNames[i];
+		const auto material = materials.find(groupNames[i]);
+		if (material != materials.end()) {
+			meshGroup.hasMaterial = true;
+			meshGroup.surfaceColor = material->second.diffuseColor;
+			const glm::vec3 & emission = material->second.emissionColor;
+			meshGroup.emissivity = std::max(emission.r, std::max(emission.g, emission.b));
+			if (meshGroup.emissivity > 0.0f) {
+				meshGroup.surfaceColor = emission / meshGroup.emissivity;
+			}
+		}
+
+		// Only keep the normals if every vertex of the group has one.
+		bool hasNormals = normalCount > 0;
+		for (size_t j = 0; hasNormals && j < triangles.size(); ++j) {
+			const glm::uvec3 & triangleNormals = normalIndices[triangles[j]];
+			hasNormals = triangleNormals[0] != NO_INDEX && triangleNormals[1] != NO_INDEX && triangleNormals[2] != NO_INDEX;
+		}
+
+		if (triangles.size() == triangleCount && !hasNormals) {
+			// The common case of a single group without normals: use the vertices of the file as they are.
+			meshGroup.mesh.vertices = std::move(positions);
+			meshGroup.mesh.indices = std::move(positionIndices);
+		}
+		else {
+			if (!hasNormals && positionRemap.empty()) {
+				positionRemap.assign(positionCount, NO_INDEX);
+			}
+			meshGroup.mesh = CreateMesh(positions, normals, positionIndices, hasNormals ? normalIndices : std::vector<glm::uvec3>(),
+										triangles, positionRemap);
+		}
+		groups.push_back(std::move(meshGroup));
+	}
+	return true;
+}
+
+bool MeshImporter::LoadPLY(const std::string & path, std::vector<MeshGroup> & groups) {
+	const Utility::MappedFile file(path);
+	if (!file.IsOpen()) {
+		std::cerr << "Could not open " << path << "." << std::endl;
+		return false;
+	}
+
+	// Parse the header, which is text terminated by an end_header line.
+	const char * p = file.GetData();
+	const char * const end = p + file.GetSize();
+	bool bigEndian = false, hasFormat = false;
+	std::vector<PlyElement> elements;
+	for (bool first = true; ; first = false) {
+		if (p == end) {
+			std::cerr << "Could not load " << path << ": the PLY header has no end_header." << std::endl;
+			return false;
+		}
+		const char * lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+		lineEnd = lineEnd != nullptr ? lineEnd : end;
+		std::istringstream line(std::string(p, lineEnd));
+		p = lineEnd == end ? end : lineEnd + 1;
+
+		std::string keyword;
+		line >> keyword;
+		if (first && keyword != "ply") {
+			std::cerr << "Could not load " << path << ": not a PLY file." << std::endl;
+			return false;
+		}
+		if (keyword == "end_header") {
+			break;
+		}
+		if (keyword == "format") {
+			std::string format;
+			line >> format;
+			if (format == "ascii") {
+				std::cerr << "Could not load " << path << ": ASCII PLY files are not supported, only binary ones." << std::endl;
+				return false;
+			}
+			if (format != "binary_little_endian" && format != "binary_big_endian") {
+				std::cerr << "Could not load " << path << ": unknown PLY format " << format << "." << std::endl;
+				return false;
+			}
+			bigEndian = format == "binary_big_endian";
+			hasFormat = true;
+		}
+		else if (keyword == "element") {
+			PlyElement element;
+			line >> element.name >> element.count;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty()) {
+			PlyProperty property;
+			std::string type;
+			line >> type;
+			if (type == "list") {
+				std::string countType;
+				line >> countType >> type;
+				property.countType = GetPlyType(countType);
+				if (property.countType == PlyType::INVALID || property.countType == PlyType::FLOAT32 || property.countType == PlyType::FLOAT64) {
+					std::cerr << "Could not load " << path << ": invalid PLY list count type " << countType << "." << std::endl;
+					return false;
+				}
+			}
+			property.type = GetPlyType(type);
+			line >> property.name;
+			if (property.type == PlyType::INVALID) {
+				std::cerr << "Could not load " << path << ": unknown PLY type " << type << "." << std::endl;
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+	}
+	if (!hasFormat) {
+		std::cerr << "Could not load " << path << ": the PLY header has no format." << std::endl;
+		return false;
+	}
+
+	MeshGroup meshGroup;
+	TriangleMesh & mesh = meshGroup.mesh;
+	bool hasFaces = false;
+	for (const PlyElement & element : elements) {
+		const size_t fixedSize = element.GetFixedSize();
+		if (element.name == "vertex") {
+			// Find the offsets of the positions and normals in a vertex.
+			static const char * const NAMES[] = { "x", "y", "z", "nx", "ny", "nz" };
+			size_t offsets[6];
+			PlyType types[6];
+			bool found[6] = {};
+			size_t offset = 0;
+			for (const PlyProperty & property : element.properties) {
+				for (int i = 0; i < 6; ++i) {
+					if (property.name == NAMES[i] && property.countType == PlyType::INVALID) {
+						offsets[i] = offset;
+						types[i] = property.type;
+						found[i] = true;
+					}
+				}
+				offset += GetPlyTypeSize(property.type);
+			}
+			if (fixedSize == 0 || !found[0] || !found[1] || !found[2]) {
+				std::cerr << "Could not load " << path << ": PLY vertices need x, y and z, and no list properties." << std::endl;
+				return false;
+			}
+			if (element.count >= NO_INDEX || static_cast<size_t>(end - p) / fixedSize < element.count) {
+				std::cerr << "Could not load " << path << ": the PLY file is truncated." << std::endl;
+				return false;
+			}
+			const bool hasNormals = found[3] && found[4] && found[5];
+			const bool littleEndianFloats = !bigEndian && types[0] == PlyType::FLOAT32 && types[1] == PlyType::FLOAT32 && types[2] == PlyType::FLOAT32;
+
+			mesh.vertices.resize(element.count);
+			mesh.normals.resize(hasNormals ? element.count : 0);
+			const char * const vertices = p;
+#pragma omp parallel for
+			for (int i = 0; i < static_cast<int>(element.count); ++i) {
+				const char * vertex = vertices + i * fixedSize;
+				if (littleEndianFloats) {
+					memcpy(&mesh.vertices[i].x, vertex + offsets[0], sizeof(float));
+					memcpy(&mesh.vertices[i].y, vertex + offsets[1], sizeof(float));
+					memcpy(&mesh.vertices[i].z, vertex + offsets[2], sizeof(float));
+				}
+				else {
+					for (int k = 0; k < 3; ++k) {
+						mesh.vertices[i][k] = static_cast<float>(ReadPlyScalar(vertex + offsets[k], types[k], bigEndian));
+					}
+				}
+				if (hasNormals) {
+					for (int k = 0; k < 3; ++k) {
+						mesh.normals[i][k] = static_cast<float>(ReadPlyScalar(vertex + offsets[3 + k], types[3 + k], bigEndian));
+					}
+				}
+			}
+			p += element.count * fixedSize;
+		}
+		else if (element.name == "face") {
+			// Find the vertex index list of the faces.
+			const PlyProperty * indexList = nullptr;
+			for (const PlyProperty & property : element.properties) {
+				if ((property.name == "vertex_indices" || property.name == "vertex_index") && property.countType != PlyType::INVALID) {
+					indexList = &property;
+					break;
+				}
+			}
+			if (indexList == nullptr || indexList->type == PlyType::FLOAT32 || indexList->type == PlyType::FLOAT64) {
+				std::cerr << "Could not load " << path << ": PLY faces need an integer vertex_indices list." << std::endl;
+				return false;
+			}
+			const size_t countSize = GetPlyTypeSize(indexList->countType), indexSize = GetPlyTypeSize(indexList->type);
+			const double vertexCount = static_cast<double>(mesh.vertices.size());
+
+			// If the faces are nothing but triangles, they have a fixed size and can be read in parallel.
+			const bool singleProperty = element.properties.size() == 1;
+			const size_t triangleSize = countSize + 3 * indexSize;
+			bool allTriangles = singleProperty && element.count < NO_INDEX && static_cast<size_t>(end - p) / triangleSize >= element.count;
+			if (allTriangles) {
+				const char * const faces = p;
+				const int faceCount = static_cast<int>(element.count);
+				int invalidFaces = 0;
+				mesh.indices.resize(element.count);
+#pragma omp parallel for reduction(+:invalidFaces)
+				for (int i = 0; i < faceCount; ++i) {
+					const char * face = faces + i * triangleSize;
+					if (ReadPlyScalar(face, indexList->countType, bigEndian) != 3.0) {
+						++invalidFaces;
+						continue;
+					}
+					for (int k = 0; k < 3; ++k) {
+						const double index = ReadPlyScalar(face + countSize + k * indexSize, indexList->type, bigEndian);
+						invalidFaces += index < 0.0 || index >= vertexCount ? 1 : 0;
+						mesh.indices[i][k] = static_cast<unsigned int>(index);
+					}
+				}
+				allTriangles = invalidFaces == 0;
+				if (allTriangles) {
+					p += element.count * triangleSize;
+				}
+				else {
+					mesh.indices.clear();
+				}
+			}
+			if (!allTriangles) {
+				// Otherwise walk the faces one by one, and triangulate the polygons as fans.
+				for (size_t i = 0; i < element.count; ++i) {
+					const size_t size = GetPlyElementSize(element, p, end, bigEndian);
+					if (size == 0) {
+						std::cerr << "Could not load " << path << ": the PLY file is truncated." << std::endl;
+						return false;
+					}
+					const char * list = p;
+					for (const PlyProperty * property = &element.properties[0]; property != indexList; ++property) {
+						list += property->countType == PlyType::INVALID ? GetPlyTypeSize(property->type) :
+							GetPlyTypeSize(property->countType) + static_cast<size_t>(ReadPlyScalar(list, property->countType, bigEndian)) * GetPlyTypeSize(property->type);
+					}
+					const size_t count = static_cast<size_t>(ReadPlyScalar(list, indexList->countType, bigEndian));
+					glm::uvec3 triangle;
+					for (size_t k = 0; k < count; ++k) {
+						const double index = ReadPlyScalar(list + countSize + k * indexSize, indexList->type, bigEndian);
+						if (index < 0.0 || index >= vertexCount) {
+							std::cerr << "Could not load " << path << ": PLY face " << i << " refers to a missing vertex." << std::endl;
+							return false;
+						}
+						triangle[std::min<size_t>(k, 2)] = static_cast<unsigned int>(index);
+						if (k >= 2) {
+							mesh.indices.push_back(triangle);
+							triangle[1] = triangle[2];
+						}
+					}
+					p += size;
+				}
+			}
+			hasFaces = true;
+		}
+		else if (fixedSize != 0) {
+			if (static_cast<size_t>(end - p) / fixedSize < element.count) {
+				std::cerr << "Could not load " << path << ": the PLY file is truncated." << std::endl;
+				return false;
+			}
+			p += element.count * fixedSize;
+		}
+		else {
+			for (size_t i = 0; i < element.count; ++i) {
+				const size_t size = GetPlyElementSize(element, p, end, bigEndian);
+				if (size == 0) {
+					std::cerr << "Could not load " << path << ": the PLY file is truncated." << std::endl;
+					return false;
+				}
+				p += size;
+			}
+		}
+		if (hasFaces) {
+			break;
+		}
+	}
+
+	if (mesh.indices.empty()) {
+		std::cerr << "Could not load " << path << ": the file has no faces." << std::endl;
+		return false;
+	}
+	groups.push_back(std::move(meshGroup));
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm.hpp>
+
+#include "../Geometry/TriangleMesh.h"
+
+/// <summary>
+/// Loads triangle meshes from Wavefront OBJ and binary PLY files. The files are memory mapped and parsed in place,
+/// in parallel chunks, straight into TriangleMesh storage (see SceneObjectFactory::AddMeshFile).
+/// </summary>
+namespace MeshImporter {
+	/// <summary> The triangles of a file which share a material. </summary>
+	struct MeshGroup {
+		/// <summary> The name of the material (usemtl in OBJ files), or empty if the file doesn't name one. </summary>
+		std::string materialName;
+
+		/// <summary> True if the material was found in a material library (mtllib in OBJ files). </summary>
+		bool hasMaterial = false;
+
+		/// <summary> The diffuse color (Kd) of the material. </summary>
+		glm::vec3 surfaceColor = glm::vec3(1.0f);
+
+		/// <summary> The emissivity of the material, the largest component of its emission color (Ke). </summary>
+		float emissivity = 0.0f;
+
+		TriangleMesh mesh;
+	};
+
+	/// <summary>
+	/// Loads an OBJ or a binary PLY file, depending on the file extension. Returns false (and writes the reason to
+	/// std::cerr) if the file couldn't be loaded.
+	/// </summary>
+	/// <param name='groups'> OUT: One group per material used in the file. </param>
+	bool Load(const std::string & path, std::vector<MeshGroup> & groups);
+
+	/// <summary>
+	/// Loads the triangles of an OBJ file (polygons are triangulated as fans). Faces are grouped by usemtl, and the
+	/// materials are looked up in the mtllib files. Vertex normals (vn) are kept if every face of a group has them.
+	/// </summary>
+	bool LoadOBJ(const std::string & path, std::vector<MeshGroup> & groups);
+
+	/// <summary>
+	/// Loads the triangles of a binary (little or big endian) PLY file into a single group, including the vertex
+	/// normals (nx, ny, nz) if there are any.
+	/// </summary>
+	bool LoadPLY(const std::string & path, std::vector<MeshGroup> & groups);
+}
@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <cassert>
 #include <iostream>
+#include <chrono>
 
 #include "../../includes/glm/gtx/norm.hpp"
 #include "../../includes/glm/gtx/rotate_vector.hpp"
@@ -14,19 +15,21 @@
 Scene::Scene() {}
 
 Scene::~Scene() {
-	for (auto& rg : renderGroups) {
-		for (auto primitive : rg.primitives) {
-			delete primitive;
-		}
-	}
 	for (auto m : materials) {
 		delete m;
 	}
+	for (auto mesh : triangleMeshes) {
+		delete mesh;
+	}
+	for (auto rg : sharedRenderGroups) {
+		delete rg;
+	}
 	delete photonMap;
 }
 
 Primitive & Scene::GetPrimitive(unsigned int renderGroupIndex, unsigned int primitiveIndex) {
 	assert(renderGroupIndex < renderGroups.size());
+	assert(renderGroups[renderGroupIndex].triangleMesh == nullptr);
 	assert(primitiveIndex < renderGroups[renderGroupIndex].primitives.size());
 	return *(renderGroups[renderGroupIndex].primitives[primitiveIndex]);
 }
@@ -50,64 +53,265 @@ void Scene::RecalculateAABB() {
 }
 
 void Scene::Initialize() {
+	assert(RayPacket::CheckSignedZeroDirections());
+
 	// Pre-store all emissive materials in a separate vector.
 	for (unsigned int i = 0; i < renderGroups.size(); ++i) {
 		if (renderGroups[i].material->IsEmissive()) {
+			// Light sources are sampled uniformly over their surface, which a non-uniform instance transform would distort.
+			assert(renderGroups[i].HasUniformScale());
 			emissiveRenderGroups.push_back(&renderGroups[i]);
 		}
 	}
-	RecalculateAABB();
+	BuildAccelerationStructures();
 }
 
-bool Scene::RayCast(const Ray & ray, unsigned int & intersectionRenderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const {
+void Scene::BuildAccelerationStructures() {
+	std::cout << "Building the acceleration structures (" << AccelerationStructure::GetTypeName(accelerationStructureSettings.type) << ", " <<
+		AccelerationStructure::GetBuildQualityName(accelerationStructureSettings.buildQuality) << ") ..." << std::endl;
+	auto startTime = std::chrono::high_resolution_clock::now();
+
+	// The render groups are independent, so they are built in parallel. Large groups are also built in parallel internally.
+	// The shared render groups are built first, since the AABBs of their instances depend on them.
+	const int sharedRenderGroupCount = static_cast<int>(sharedRenderGroups.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < sharedRenderGroupCount; ++i) {
+		sharedRenderGroups[i]->BuildAccelerationStructure(accelerationStructureSettings);
+	}
+	const int renderGroupCount = static_cast<int>(renderGroups.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < renderGroupCount; ++i) {
+		renderGroups[i].BuildAccelerationStructure(accelerationStructureSettings);
+	}
+	RecalculateAABB();
+	RebuildTopLevelAccelerationStructure();
 
-	float closestInterectionDistance = FLT_MAX;
+	auto timeElapsed = std::chrono::high_resolution_clock::now() - startTime;
+	accelerationStructureBuildSeconds = std::chrono::duration_cast<std::chrono::microseconds>(timeElapsed).count() / 1000000.0;
+	std::cout << "Acceleration structures built in " << accelerationStructureBuildSeconds << " seconds." << std::endl;
+}
 
-	// Check if the ray intersects with any enabled render group in the scene.
-	// TODO: Use the octree to speed up performance by firstly ray casting on AABBs.
+std::vector<AABB> Scene::GetRenderGroupAABBs() const {
+	std::vector<AABB> renderGroupAABBs(renderGroups.size(), AABB(glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)));
 	for (unsigned int i = 0; i < renderGroups.size(); ++i) {
-		if (!renderGroups[i].enabled) {
-			continue;
+		if (renderGroups[i].enabled) {
+			renderGroupAABBs[i] = renderGroups[i].axisAlignedBoundingBox;
 		}
-		for (unsigned int j = 0; j < renderGroups[i].primitives.size(); ++j) {
-			if (!renderGroups[i].primitives[j]->enabled) {
-				continue;
-			}
-			bool intersects = renderGroups[i].primitives[j]->RayIntersection(ray, intersectionDistance);
-			if (intersects) {
-				assert(intersectionDistance > FLT_EPSILON);
-				if (intersectionDistance < closestInterectionDistance) {
-					intersectionRenderGroupIndex = i;
-					intersectionPrimitiveIndex = j;
-					closestInterectionDistance = intersectionDistance;
-				}
-			}
+	}
+	return renderGroupAABBs;
+}
+
+void Scene::RebuildTopLevelAccelerationStructure() {
+	std::vector<unsigned int> allRenderGroups(renderGroups.size());
+	for (unsigned int i = 0; i < renderGroups.size(); ++i) {
+		allRenderGroups[i] = i;
+	}
+	topLevelAccelerationStructure.settings = accelerationStructureSettings;
+	topLevelAccelerationStructure.Build(GetRenderGroupAABBs(), allRenderGroups);
+	PackSpheres();
+}
+
+void Scene::PackSpheres() {
+	const std::vector<unsigned int> & itemIndices = topLevelAccelerationStructure.GetItemIndices();
+	std::vector<const Sphere *> singleSpheres(itemIndices.size(), nullptr);
+	for (unsigned int i = 0; i < itemIndices.size(); ++i) {
+		const RenderGroup & renderGroup = renderGroups[itemIndices[i]];
+		if (renderGroup.primitives.size() == 1 && renderGroup.primitives[0]->type == Primitive::Type::SPHERE) {
+			singleSpheres[i] = static_cast<const Sphere *>(renderGroup.primitives[0]);
 		}
 	}
+	packedSpheres.Pack(singleSpheres);
+}
+
+void Scene::RefitAccelerationStructures(const std::vector<unsigned int> & changedRenderGroups) {
+	const int changedRenderGroupCount = static_cast<int>(changedRenderGroups.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < changedRenderGroupCount; ++i) {
+		renderGroups[changedRenderGroups[i]].RefitAccelerationStructure();
+	}
+	RecalculateAABB();
+	topLevelAccelerationStructure.Refit(GetRenderGroupAABBs());
+	PackSpheres();
+}
 
-	intersectionDistance = closestInterectionDistance;
-	return closestInterectionDistance < FLT_MAX - FLT_EPSILON;
+void Scene::RefitAccelerationStructures() {
+	const int sharedRenderGroupCount = static_cast<int>(sharedRenderGroups.size());
+#pragma omp parallel for schedule(dynamic)
+	for (int i = 0; i < sharedRenderGroupCount; ++i) {
+		sharedRenderGroups[i]->RefitAccelerationStructure();
+	}
+	std::vector<unsigned int> allRenderGroups(renderGroups.size());
+	for (unsigned int i = 0; i < renderGroups.size(); ++i) {
+		allRenderGroups[i] = i;
+	}
+	RefitAccelerationStructures(allRenderGroups);
 }
 
-bool Scene::RenderGroupRayCast(const Ray & ray, unsigned int renderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const {
-	float closestInterectionDistance = FLT_MAX;
+size_t Scene::GetAccelerationStructureMemoryUsage() const {
+	size_t memoryUsage = topLevelAccelerationStructure.GetMemoryUsage() + packedSpheres.GetMemoryUsage();
+	for (const auto & rg : renderGroups) {
+		memoryUsage += rg.accelerationStructure.GetMemoryUsage();
+	}
+	for (const auto * rg : sharedRenderGroups) {
+		memoryUsage += rg->accelerationStructure.GetMemoryUsage();
+	}
+	return memoryUsage;
+}
 
-	const auto & renderGroup = renderGroups[renderGroupIndex];
+Scene::AccelerationStructureStatistics Scene::GetAccelerationStructureStatistics() const {
+	AccelerationStructureStatistics statistics;
+	statistics.buildSeconds = accelerationStructureBuildSeconds;
+	statistics.topLevel = topLevelAccelerationStructure.GetStatistics();
 
-	for (unsigned int j = 0; j < renderGroup.primitives.size(); ++j) {
-		if (!renderGroup.primitives[j]->enabled) {
+	BVH::Statistics & bottomLevel = statistics.bottomLevel;
+	float itemCount = 0.0f, totalArea = 0.0f;
+	std::vector<const RenderGroup *> bottomLevelRenderGroups(sharedRenderGroups.begin(), sharedRenderGroups.end());
+	for (const auto & rg : renderGroups) {
+		bottomLevelRenderGroups.push_back(&rg);
+	}
+	for (const auto * rg : bottomLevelRenderGroups) {
+		const BVH::Statistics & groupStatistics = rg->accelerationStructure.GetStatistics();
+		if (groupStatistics.nodeCount == 0) {
 			continue;
 		}
-		bool intersects = renderGroup.primitives[j]->RayIntersection(ray, intersectionDistance);
-		if (intersects) {
-			assert(intersectionDistance > FLT_EPSILON);
-			if (intersectionDistance < closestInterectionDistance) {
-				intersectionPrimitiveIndex = j;
-				closestInterectionDistance = intersectionDistance;
+		const float area = rg->axisAlignedBoundingBox.GetSurfaceArea();
+		bottomLevel.nodeCount += groupStatistics.nodeCount;
+		bottomLevel.leafCount += groupStatistics.leafCount;
+		bottomLevel.maxDepth = glm::max(bottomLevel.maxDepth, groupStatistics.maxDepth);
+		bottomLevel.maxLeafSize = glm::max(bottomLevel.maxLeafSize, groupStatistics.maxLeafSize);
+		bottomLevel.sahCost += groupStatistics.sahCost * area;
+		itemCount += groupStatistics.averageLeafSize * groupStatistics.leafCount;
+		totalArea += area;
+	}
+	if (bottomLevel.leafCount > 0) {
+		bottomLevel.averageLeafSize = itemCount / bottomLevel.leafCount;
+		bottomLevel.sahCost /= glm::max<float>(totalArea, FLT_EPSILON);
+	}
+	return statistics;
+}
+
+bool Scene::RayCast(const Ray & ray, unsigned int & intersectionRenderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const {
+
+	// The interval of this copy shrinks as closer intersections are found.
+	Ray closestRay = ray;
+	bool intersectionFound = false;
+
+	// Walk the top level structure (front to back when possible) and only walk the structures of the visited render groups.
+	topLevelAccelerationStructure.RayCastLeaves(closestRay, [&](unsigned int offset, unsigned int count, Ray & currentRay) {
+		bool leafIntersectionFound = false;
+		IntersectLeaf(currentRay, offset, count, [&](unsigned int item, float distance) {
+			intersectionRenderGroupIndex = item;
+			intersectionPrimitiveIndex = 0;
+			currentRay.tMax = distance;
+			leafIntersectionFound = true;
+			return false;
+		}, [&](unsigned int item) {
+			if (renderGroups[item].RayCast(currentRay, intersectionPrimitiveIndex)) {
+				intersectionRenderGroupIndex = item;
+				leafIntersectionFound = true;
+			}
+			return false;
+		});
+		intersectionFound = intersectionFound || leafIntersectionFound;
+		return leafIntersectionFound;
+	});
+
+	intersectionDistance = closestRay.tMax;
+	return intersectionFound;
+}
+
+RayPacket::Mask Scene::RayCast(RayPacket & packet, Intersection intersections[RayPacket::MAX_SIZE]) const {
+	RayPacket::Mask intersectionMask = 0;
+	if (!topLevelAccelerationStructure.SupportsRayPackets()) {
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			Intersection & intersection = intersections[i];
+			if (RayCast(packet.rays[i], intersection.renderGroupIndex, intersection.primitiveIndex, intersection.distance)) {
+				packet.rays[i].tMax = intersection.distance;
+				intersectionMask |= RayPacket::Mask(1) << i;
 			}
 		}
+		return intersectionMask;
 	}
 
-	intersectionDistance = closestInterectionDistance;
-	return closestInterectionDistance < FLT_MAX - FLT_EPSILON;
+	const std::vector<unsigned int> & itemIndices = topLevelAccelerationStructure.GetItemIndices();
+	topLevelAccelerationStructure.RayCastPacket(packet, packet.GetMask(), [&](unsigned int offset, unsigned int count, RayPacket::Mask leafMask) {
+		// The single sphere groups are tested ray by ray (but several spheres at a time).
+		for (unsigned int i = 0; i < packet.size; ++i) {
+			if (!RayPacket::Contains(leafMask, i)) {
+				continue;
+			}
+			Ray & ray = packet.rays[i];
+			IntersectSpheres(ray, offset, count, [&](unsigned int item, float distance) {
+				intersections[i] = { item, 0, distance };
+				ray.tMax = distance;
+				intersectionMask |= RayPacket::Mask(1) << i;
+				return false;
+			});
+		}
+		packet.UpdateIntervals(leafMask);
+
+		// The rays which enter a group walk its structure together.
+		for (unsigned int position = offset; position < offset + count; ++position) {
+			if (!packedSpheres.IsEmpty() && packedSpheres.IsPacked(position)) {
+				continue;
+			}
+			const unsigned int item = itemIndices[position];
+			const RenderGroup & renderGroup = renderGroups[item];
+			if (!renderGroup.enabled) {
+				continue;
+			}
+			const RayPacket::Mask renderGroupMask = packet.IntersectAABB(renderGroup.axisAlignedBoundingBox, leafMask);
+			if (renderGroupMask == 0) {
+				continue;
+			}
+			unsigned int primitiveIndices[RayPacket::MAX_SIZE];
+			const RayPacket::Mask renderGroupIntersectionMask = renderGroup.RayCastPacket(packet, renderGroupMask, primitiveIndices);
+			for (unsigned int i = 0; i < packet.size; ++i) {
+				if (RayPacket::Contains(renderGroupIntersectionMask, i)) {
+					intersections[i] = { item, primitiveIndices[i], packet.rays[i].tMax };
+				}
+			}
+			intersectionMask |= renderGroupIntersectionMask;
+			packet.UpdateIntervals(renderGroupIntersectionMask);
+		}
+	});
+	return intersectionMask;
+}
+
+bool Scene::Occluded(const Ray & ray) const {
+	return topLevelAccelerationStructure.AnyHitLeaves(ray, [&](unsigned int offset, unsigned int count) {
+		return IntersectLeaf(ray, offset, count, [](unsigned int, float) {
+			return true; // Any intersection will do.
+		}, [&](unsigned int item) {
+			return renderGroups[item].AnyHit(ray, [](unsigned int, float) {
+				return true;
+			});
+		});
+	});
+}
+
+void Scene::RayCastAll(const Ray & ray, std::vector<Intersection> & intersections) const {
+	intersections.clear();
+	topLevelAccelerationStructure.AnyHitLeaves(ray, [&](unsigned int offset, unsigned int count) {
+		return IntersectLeaf(ray, offset, count, [&](unsigned int item, float distance) {
+			intersections.push_back({ item, 0, distance });
+			return false; // Keep looking for more intersections.
+		}, [&](unsigned int item) {
+			renderGroups[item].AnyHit(ray, [&](unsigned int primitiveIndex, float distance) {
+				intersections.push_back({ item, primitiveIndex, distance });
+				return false;
+			});
+			return false;
+		});
+	});
+}
+
+bool Scene::RenderGroupRayCast(const Ray & ray, unsigned int renderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const {
+	Ray closestRay = ray;
+
+	// Only walk the acceleration structure of the given render group.
+	const bool intersectionFound = renderGroups[renderGroupIndex].RayCast(closestRay, intersectionPrimitiveIndex);
+
+	intersectionDistance = closestRay.tMax;
+	return intersectionFound;
 }
\ No newline at end of file
@@ -6,10 +6,17 @@
 #include <glm.hpp>
 
 #include "../Geometry/Ray.h"
+#include "../Geometry/RayPacket.h"
 #include "../Rendering/RenderGroup.h"
 #include "../Geometry/Triangle.h"
+#include "../Geometry/Sphere.h"
+#include "../Geometry/Quad.h"
+#include "../Geometry/PrimitivePool.h"
+#include "../Geometry/TriangleMesh.h"
+#include "../Geometry/PackedSpheres.h"
 #include "../PhotonMap/PhotonMap.h"
 #include "../Geometry/AABB.h"
+#include "../Acceleration/AccelerationStructure.h"
 
 class Scene {
 public:
@@ -18,25 +25,48 @@ public:
 	std::vector<Material*> materials;
 	std::vector<RenderGroup*> emissiveRenderGroups;
 
+	/// <summary> 
+	/// Render groups which are only rendered through instances (see RenderGroup::instancedRenderGroup), so that their
+	/// primitives and acceleration structures are shared by all instances. Deleted together with the scene.
+	/// </summary>
+	std::vector<RenderGroup*> sharedRenderGroups;
+
+	/// <summary> 
+	/// Storage of the primitives of the render groups, one pool per primitive type. Add primitives to the scene
+	/// through these (e.g. scene.triangles.Add(v1, v2, v3, normal)); they are destroyed together with the scene.
+	/// </summary>
+	PrimitivePool<Triangle> triangles;
+	PrimitivePool<Sphere> spheres;
+	PrimitivePool<Quad> quads;
+
+	/// <summary> The meshes of the triangle mesh render groups (see RenderGroup::triangleMesh). Deleted together with the scene. </summary>
+	std::vector<TriangleMesh*> triangleMeshes;
+
 	/// <summary> Boundaries of the scene. </summary>
 	AABB axisAlignedBoundingBox;
 
 	/// <summary> Photon Map. </summary>
 	PhotonMap* photonMap = nullptr;
 
+	/// <summary>
+	/// The acceleration structure used for ray casting, both within and between the render groups.
+	/// Call BuildAccelerationStructures after changing this.
+	/// </summary>
+	AccelerationStructure::Settings accelerationStructureSettings;
+
 	/// <summary> Call this after all primitives has been added to the scene (pre-render). </summary>
 	void Initialize();
 
 	Scene();
 	~Scene();
 
-	/// <summary> Returns a primitive given it's render group index and primitive index. </summary>
+	/// <summary> Returns a primitive given it's render group index and primitive index. Not available for triangle mesh groups. </summary>
 	Primitive & GetPrimitive(unsigned int renderGroupIndex, unsigned int primitiveIndex);
 
 	void RecalculateAABB();
 
 	/// <summary> 
-	/// Casts a ray through the scene. Returns true if there was an intersection.
+	/// Casts a ray through the scene. Returns true if there was an intersection within the ray interval.
 	/// </summary>
 	/// <param name='ray'> The ray which we cast. </param>
 	/// <param name='intersectionRenderGroupIndex'> 
@@ -50,8 +80,23 @@ public:
 	/// </param>
 	bool RayCast(const Ray & ray, unsigned int & intersectionRenderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const;
 
+	/// <summary> Describes an intersection between a ray and a primitive in the scene. </summary>
+	struct Intersection {
+		unsigned int renderGroupIndex, primitiveIndex;
+		float distance;
+	};
+
 	/// <summary> 
-	/// Casts a ray through a given render group. Returns true if there was an intersection.
+	/// Casts a packet of coherent rays (e.g. primary rays) through the scene. The rays share the node visits of
+	/// both levels of acceleration structures. Gives the same intersections as casting the rays one at a time.
+	/// Returns the rays which intersect something within their ray interval.
+	/// </summary>
+	/// <param name='packet'> The rays which we cast. The intervals of the rays are shrunk to their intersections. </param>
+	/// <param name='intersections'> OUT: The intersection of every returned ray. </param>
+	RayPacket::Mask RayCast(RayPacket & packet, Intersection intersections[RayPacket::MAX_SIZE]) const;
+
+	/// <summary> 
+	/// Casts a ray through a given render group. Returns true if there was an intersection within the ray interval.
 	/// </summary>
 	/// <param name='ray'> The ray which we cast. </param>
 	/// <param name='renderGroupIndex'> 
@@ -65,4 +110,160 @@ public:
 	/// OUT: The intersection point distance if there was an intersection.
 	/// </param>
 	bool RenderGroupRayCast(const Ray & ray, unsigned int renderGroupIndex, unsigned int & intersectionPrimitiveIndex, float & intersectionDistance) const;
-};
\ No newline at end of file
+
+	/// <summary> 
+	/// Returns true if the ray intersects anything within the ray interval.
+	/// Cheaper than RayCast since the traversal stops at the first intersection found.
+	/// Use this for shadow rays (with ray.tMax set to the distance to the light), which only need to know if anything blocks the light.
+	/// </summary>
+	/// <param name='ray'> The ray which we cast. </param>
+	bool Occluded(const Ray & ray) const;
+
+	/// <summary> 
+	/// Finds every intersection within the ray interval (in no particular order) using the same traversal as Occluded.
+	/// </summary>
+	/// <param name='ray'> The ray which we cast. </param>
+	/// <param name='intersections'> OUT: All intersections along the ray. </param>
+	void RayCastAll(const Ray & ray, std::vector<Intersection> & intersections) const;
+
+	/// <summary> 
+	/// Builds the two level acceleration structure: one structure per render group and one structure over the render groups.
+	/// The AABBs of the render groups and of the scene are recalculated as well, so primitives may have moved since the last build.
+	/// Called by Initialize.
+	/// </summary>
+	void BuildAccelerationStructures();
+
+	/// <summary> 
+	/// Rebuilds the top level acceleration structure over the render groups (disabled groups get empty bounds).
+	/// The per group structures are left untouched.
+	/// </summary>
+	void RebuildTopLevelAccelerationStructure();
+
+	/// <summary> 
+	/// Updates the acceleration structures after primitives have moved, or after primitives or render groups have been
+	/// enabled or disabled. The structures are refit bottom-up, and only subtrees which have degraded too much are rebuilt.
+	/// </summary>
+	/// <param name='changedRenderGroups'> 
+	/// The indices of the render groups in which primitives have moved or have been enabled or disabled.
+	/// Render groups which have just been enabled or disabled themselves do not need to be listed.
+	/// </param>
+	void RefitAccelerationStructures(const std::vector<unsigned int> & changedRenderGroups);
+
+	/// <summary> Same as above, but refits the structures of all render groups (including the shared render groups). </summary>
+	void RefitAccelerationStructures();
+
+	/// <summary> Returns the number of bytes used by all acceleration structures (both levels, including packed primitives). </summary>
+	size_t GetAccelerationStructureMemoryUsage() const;
+
+	/// <summary> Describes the acceleration structures built by the last call to BuildAccelerationStructures. </summary>
+	struct AccelerationStructureStatistics {
+		/// <summary> The time it took to build both levels. </summary>
+		double buildSeconds = 0.0;
+
+		/// <summary> The structure over the render groups. </summary>
+		BVH::Statistics topLevel;
+
+		/// <summary>
+		/// The structures of all render groups combined: counts are summed, maxima are taken over all groups
+		/// and the SAH cost is averaged, weighted by the surface area of each group.
+		/// </summary>
+		BVH::Statistics bottomLevel;
+	};
+
+	AccelerationStructureStatistics GetAccelerationStructureStatistics() const;
+
+private:
+	/// <summary> Top level acceleration structure over the AABBs of all render groups. </summary>
+	AccelerationStructure topLevelAccelerationStructure;
+
+	/// <summary> 
+	/// The render groups which consist of a single sphere (most spheres created by SceneObjectFactory),
+	/// in the item order of the top level acceleration structure.
+	/// </summary>
+	PackedSpheres packedSpheres;
+
+	/// <summary> Returns the AABB of every render group, or an empty AABB if the render group is disabled. </summary>
+	std::vector<AABB> GetRenderGroupAABBs() const;
+
+	/// <summary> Packs the single sphere render groups. Called whenever the top level structure has been built or refit. </summary>
+	void PackSpheres();
+
+	/// <summary> 
+	/// Intersects a ray with the single sphere render groups in a leaf of the top level acceleration structure,
+	/// PackedSpheres::WIDTH at a time. Stops and returns true as soon as onSphereIntersection returns true.
+	/// onSphereIntersection may decrease ray.tMax, which is respected by the remaining tests.
+	/// </summary>
+	/// <param name='offset'> The leaf is topLevelAccelerationStructure.GetItemIndices()[offset, offset + count). </param>
+	/// <param name='onSphereIntersection'> Callable on the form bool(unsigned int renderGroupIndex, float intersectionDistance). </param>
+	template<typename OnSphereIntersection>
+	bool IntersectSpheres(const Ray & ray, unsigned int offset, unsigned int count, OnSphereIntersection onSphereIntersection) const;
+
+	/// <summary> 
+	/// Intersects a ray with the render groups in a leaf of the top level acceleration structure. The single sphere
+	/// groups are handled by IntersectSpheres, and every other enabled group which the ray enters before ray.tMax
+	/// is passed to intersectRenderGroup. Stops and returns true as soon as a callback returns true.
+	/// The callbacks may decrease ray.tMax, which is respected by the remaining tests.
+	/// </summary>
+	/// <param name='offset'> The leaf is topLevelAccelerationStructure.GetItemIndices()[offset, offset + count). </param>
+	/// <param name='onSphereIntersection'> Callable on the form bool(unsigned int renderGroupIndex, float intersectionDistance). </param>
+	/// <param name='intersectRenderGroup'> Callable on the form bool(unsigned int renderGroupIndex). </param>
+	template<typename OnSphereIntersection, typename IntersectRenderGroup>
+	bool IntersectLeaf(const Ray & ray, unsigned int offset, unsigned int count,
+					   OnSphereIntersection onSphereIntersection, IntersectRenderGroup intersectRenderGroup) const;
+
+	/// <summary> The time it took to build the acceleration structures. </summary>
+	double accelerationStructureBuildSeconds = 0.0;
+};
+
+template<typename OnSphereIntersection>
+bool Scene::IntersectSpheres(const Ray & ray, unsigned int offset, unsigned int count, OnSphereIntersection onSphereIntersection) const {
+	if (packedSpheres.IsEmpty()) {
+		return false;
+	}
+	const std::vector<unsigned int> & itemIndices = topLevelAccelerationStructure.GetItemIndices();
+	const unsigned int end = offset + count;
+	for (unsigned int begin = offset; begin < end; begin += PackedSpheres::WIDTH) {
+		float distances[PackedSpheres::WIDTH];
+		const unsigned int laneCount = glm::min<unsigned int>(PackedSpheres::WIDTH, end - begin);
+		const unsigned int hitMask = packedSpheres.Intersect(ray, begin, laneCount, distances);
+		for (unsigned int lane = 0; hitMask >> lane != 0; ++lane) {
+			const unsigned int item = itemIndices[begin + lane];
+			if ((hitMask & (1u << lane)) != 0 && renderGroups[item].enabled && renderGroups[item].primitives[0]->enabled &&
+				distances[lane] < ray.tMax && onSphereIntersection(item, distances[lane])) {
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+template<typename OnSphereIntersection, typename IntersectRenderGroup>
+bool Scene::IntersectLeaf(const Ray & ray, unsigned int offset, unsigned int count,
+						  OnSphereIntersection onSphereIntersection, IntersectRenderGroup intersectRenderGroup) const {
+	if (IntersectSpheres(ray, offset, count, onSphereIntersection)) {
+		return true;
+	}
+
+	const std::vector<unsigned int> & itemIndices = topLevelAccelerationStructure.GetItemIndices();
+	const unsigned int end = offset + count;
+	for (unsigned int i = offset; i < end; ++i) {
+		if (!packedSpheres.IsEmpty() && packedSpheres.IsPacked(i)) {
+			continue;
+		}
+		const RenderGroup & renderGroup = renderGroups[itemIndices[i]];
+		if (!renderGroup.enabled) {
+			continue;
+		}
+
+		// Cull the render group if its AABB is missed or if it is further away than the closest intersection.
+		float aabbIntersectionDistance;
+		if (!renderGroup.axisAlignedBoundingBox.RayIntersection(ray, aabbIntersectionDistance) ||
+			aabbIntersectionDistance > ray.tMax) {
+			continue;
+		}
+		if (intersectRenderGroup(itemIndices[i])) {
+			return true;
+		}
+	}
+	return false;
+}
\ No newline at end of file
@@ -1,8 +1,14 @@
 #include "SceneObjectFactory.h"
 
+#include <utility>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+
 #include "../Rendering/Materials/LambertianMaterial.h"
 #include "../Rendering/Materials/OrenNayarMaterial.h"
 #include "../Geometry/Sphere.h"
+#include "MeshImporter.h"
 
 void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissiveCeiling) {
 	auto & materials = scene.materials;
@@ -50,11 +56,10 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 	glm::vec3 ceilingNormal(0.0, 0.0, -1.0);
 
 	if (addBackWalls) {
-		ceiling.primitives.push_back(new Triangle(cv1, cv2, cv6, ceilingNormal));
+		ceiling.primitives.push_back(scene.triangles.Add(cv1, cv2, cv6, ceilingNormal));
 	}
-	ceiling.primitives.push_back(new Triangle(cv2, cv3, cv5, ceilingNormal));
-	ceiling.primitives.push_back(new Triangle(cv2, cv5, cv6, ceilingNormal));
-	ceiling.primitives.push_back(new Triangle(cv3, cv4, cv5, ceilingNormal));
+	ceiling.primitives.push_back(scene.quads.Add(cv6, cv2 - cv6, cv5 - cv6, ceilingNormal));
+	ceiling.primitives.push_back(scene.triangles.Add(cv3, cv4, cv5, ceilingNormal));
 
 	ceiling.RecalculateAABB();
 
@@ -74,11 +79,10 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 	glm::vec3 floorNormal(0.0, 0.0, 1.0);
 
 	if (addBackWalls) {
-		floor.primitives.push_back(new Triangle(fv1, fv2, fv6, floorNormal));
+		floor.primitives.push_back(scene.triangles.Add(fv1, fv2, fv6, floorNormal));
 	}
-	floor.primitives.push_back(new Triangle(fv2, fv3, fv5, floorNormal));
-	floor.primitives.push_back(new Triangle(fv2, fv5, fv6, floorNormal));
-	floor.primitives.push_back(new Triangle(fv3, fv4, fv5, floorNormal));
+	floor.primitives.push_back(scene.quads.Add(fv6, fv2 - fv6, fv5 - fv6, floorNormal));
+	floor.primitives.push_back(scene.triangles.Add(fv3, fv4, fv5, floorNormal));
 
 	floor.RecalculateAABB();
 
@@ -93,8 +97,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 		glm::vec3 w1Normal = normalize(glm::vec3(2.0f, -1.0f, 0.0f));
 
-		wall1.primitives.push_back(new Triangle(fv1, cv1, cv2, w1Normal));
-		wall1.primitives.push_back(new Triangle(fv2, fv1, cv2, w1Normal));
+		wall1.primitives.push_back(scene.quads.Add(fv1, cv1 - fv1, fv2 - fv1, w1Normal));
 
 		wall1.RecalculateAABB();
 
@@ -108,8 +111,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 	glm::vec3 w2Normal = normalize(glm::vec3(0.0, -1.0, 0.0));
 
-	wall2.primitives.push_back(new Triangle(fv2, cv2, cv3, w2Normal));
-	wall2.primitives.push_back(new Triangle(fv3, fv2, cv3, w2Normal));
+	wall2.primitives.push_back(scene.quads.Add(fv2, cv2 - fv2, fv3 - fv2, w2Normal));
 
 	wall2.RecalculateAABB();
 
@@ -122,8 +124,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 	glm::vec3 w3Normal = normalize(glm::vec3(-2.0, -1.0, 0.0));
 
-	wall3.primitives.push_back(new Triangle(fv3, cv3, cv4, w3Normal));
-	wall3.primitives.push_back(new Triangle(fv4, fv3, cv4, w3Normal));
+	wall3.primitives.push_back(scene.quads.Add(fv3, cv3 - fv3, fv4 - fv3, w3Normal));
 
 	wall3.RecalculateAABB();
 
@@ -136,8 +137,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 	glm::vec3 w4Normal = normalize(glm::vec3(-2.0, 1.0, 0.0));
 
-	wall4.primitives.push_back(new Triangle(fv4, cv4, cv5, w4Normal));
-	wall4.primitives.push_back(new Triangle(fv5, fv4, cv5, w4Normal));
+	wall4.primitives.push_back(scene.quads.Add(fv4, cv4 - fv4, fv5 - fv4, w4Normal));
 
 	wall4.RecalculateAABB();
 
@@ -150,8 +150,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 	glm::vec3 w5Normal = normalize(glm::vec3(0.0, 1.0, 0.0));
 
-	wall5.primitives.push_back(new Triangle(fv5, cv5, cv6, w5Normal));
-	wall5.primitives.push_back(new Triangle(fv6, fv5, cv6, w5Normal));
+	wall5.primitives.push_back(scene.quads.Add(fv5, cv5 - fv5, fv6 - fv5, w5Normal));
 
 	wall5.RecalculateAABB();
 
@@ -166,8 +165,7 @@ void SceneObjectFactory::AddRoom(Scene & scene, bool addBackWalls, bool emissive
 
 		glm::vec3 w6Normal = normalize(glm::vec3(2.0, 1.0, 0.0));
 
-		wall6.primitives.push_back(new Triangle(fv6, cv6, cv1, w6Normal));
-		wall6.primitives.push_back(new Triangle(fv1, fv6, cv1, w6Normal));
+		wall6.primitives.push_back(scene.quads.Add(fv6, cv6 - fv6, fv1 - fv6, w6Normal));
 
 		wall6.RecalculateAABB();
 
@@ -186,7 +184,7 @@ void SceneObjectFactory::AddOrenNayarSphere(Scene & scene, float x, float y, flo
 
 	// Render group + primitive.
 	RenderGroup sphereGroup(sphereMaterial);
-	sphereGroup.primitives.push_back(new Sphere(glm::vec3(x, y, z), radius));
+	sphereGroup.primitives.push_back(scene.spheres.Add(glm::vec3(x, y, z), radius));
 	sphereGroup.RecalculateAABB();
 	renderGroups.push_back(sphereGroup);
 }
@@ -202,11 +200,75 @@ void SceneObjectFactory::AddTriangle(Scene & scene, glm::vec3 p1, glm::vec3 p2,
 
 	// Render group + primitive.
 	RenderGroup triangleGroup(sphereMaterial);
-	triangleGroup.primitives.push_back(new Triangle(p1, p2, p3, normal));
+	triangleGroup.primitives.push_back(scene.triangles.Add(p1, p2, p3, normal));
 	triangleGroup.RecalculateAABB();
 	renderGroups.push_back(triangleGroup);
 }
 
+void SceneObjectFactory::AddTriangleMesh(Scene & scene, TriangleMesh mesh, glm::vec3 surfaceColor, float emissivity) {
+	auto & materials = scene.materials;
+	auto & renderGroups = scene.renderGroups;
+
+	// Material.
+	const auto meshMaterial = new LambertianMaterial(surfaceColor, emissivity);
+	materials.push_back(meshMaterial);
+
+	// Mesh.
+	scene.triangleMeshes.push_back(new TriangleMesh(std::move(mesh)));
+
+	// Render group.
+	RenderGroup meshGroup(meshMaterial);
+	meshGroup.triangleMesh = scene.triangleMeshes.back();
+	meshGroup.convex = false;
+	meshGroup.RecalculateAABB();
+	renderGroups.push_back(meshGroup);
+}
+
+bool SceneObjectFactory::AddMeshFile(Scene & scene, const std::string & path, const glm::mat4 & transform, glm::vec3 surfaceColor) {
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	std::vector<MeshImporter::MeshGroup> groups;
+	if (!MeshImporter::Load(path, groups)) {
+		return false;
+	}
+
+	const glm::mat3 normalTransform = glm::transpose(glm::inverse(glm::mat3(transform)));
+	size_t triangleCount = 0;
+	for (auto & group : groups) {
+		auto & vertices = group.mesh.vertices;
+		auto & normals = group.mesh.normals;
+#pragma omp parallel for
+		for (int i = 0; i < static_cast<int>(vertices.size()); ++i) {
+			vertices[i] = glm::vec3(transform * glm::vec4(vertices[i], 1.0f));
+			if (!normals.empty()) {
+				normals[i] = glm::normalize(normalTransform * normals[i]);
+			}
+		}
+		triangleCount += group.mesh.GetTriangleCount();
+		AddTriangleMesh(scene, std::move(group.mesh), group.hasMaterial ? group.surfaceColor : surfaceColor, group.emissivity);
+	}
+
+	const auto time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+	std::cout << "Loaded " << triangleCount << " triangles in " << groups.size() << " render groups from " << path
+		<< " in " << time << " seconds." << std::endl;
+	return true;
+}
+
+const RenderGroup * SceneObjectFactory::ShareLastRenderGroup(Scene & scene) {
+	assert(!scene.renderGroups.empty() && scene.renderGroups.back().instancedRenderGroup == nullptr);
+	scene.sharedRenderGroups.push_back(new RenderGroup(std::move(scene.renderGroups.back())));
+	scene.renderGroups.pop_back();
+	return scene.sharedRenderGroups.back();
+}
+
+void SceneObjectFactory::AddInstance(Scene & scene, const RenderGroup * sharedRenderGroup, const glm::mat4 & transform, Material * material) {
+	RenderGroup instance(material != nullptr ? material : sharedRenderGroup->material);
+	instance.instancedRenderGroup = sharedRenderGroup;
+	instance.convex = sharedRenderGroup->convex;
+	instance.SetInstanceTransform(transform);
+	instance.RecalculateAABB();
+	scene.renderGroups.push_back(instance);
+}
+
 void SceneObjectFactory::Add2DQuad(Scene & scene, glm::vec2 corner1, glm::vec2 corner2, float height,
 								   glm::vec3 normal, glm::vec3 surfaceColor, float emissivity) {
 	auto & materials = scene.materials;
@@ -214,7 +276,6 @@ void SceneObjectFactory::Add2DQuad(Scene & scene, glm::vec2 corner1, glm::vec2 c
 
 	glm::vec3 c1 = glm::vec3(corner1.x, corner1.y, height);
 	glm::vec3 c2 = glm::vec3(corner1.x, corner2.y, height);
-	glm::vec3 c3 = glm::vec3(corner2.x, corner2.y, height);
 	glm::vec3 c4 = glm::vec3(corner2.x, corner1.y, height);
 
 	// Material.
@@ -222,12 +283,11 @@ void SceneObjectFactory::Add2DQuad(Scene & scene, glm::vec2 corner1, glm::vec2 c
 	materials.push_back(lightMaterial);
 
 	// Render group + primitive.
-	RenderGroup triangleGroup(lightMaterial);
+	RenderGroup quadGroup(lightMaterial);
 
-	triangleGroup.primitives.push_back(new Triangle(c1, c2, c3, normal));
-	triangleGroup.primitives.push_back(new Triangle(c3, c4, c1, normal));
-	triangleGroup.RecalculateAABB();
-	renderGroups.push_back(triangleGroup);
+	quadGroup.primitives.push_back(scene.quads.Add(c1, c2 - c1, c4 - c1, normal));
+	quadGroup.RecalculateAABB();
+	renderGroups.push_back(quadGroup);
 }
 
 void SceneObjectFactory::AddSphere(Scene & scene, float x, float y, float z,
@@ -241,7 +301,7 @@ void SceneObjectFactory::AddSphere(Scene & scene, float x, float y, float z,
 
 	// Render group + primitive.
 	RenderGroup sphereGroup(sphereMaterial);
-	sphereGroup.primitives.push_back(new Sphere(glm::vec3(x, y, z), radius));
+	sphereGroup.primitives.push_back(scene.spheres.Add(glm::vec3(x, y, z), radius));
 	sphereGroup.RecalculateAABB();
 	renderGroups.push_back(sphereGroup);
 }
@@ -259,7 +319,7 @@ void SceneObjectFactory::AddTransparentSphere(Scene & scene, float x, float y, f
 
 	// Render group + primitive.
 	RenderGroup sphereGroup(transparentMaterial);
-	sphereGroup.primitives.push_back(new Sphere(glm::vec3(x, y, z), radius));
+	sphereGroup.primitives.push_back(scene.spheres.Add(glm::vec3(x, y, z), radius));
 	sphereGroup.RecalculateAABB();
 	renderGroups.push_back(sphereGroup);
 }
@@ -290,10 +350,10 @@ void SceneObjectFactory::AddTetrahedron(Scene & scene, float x, float y, float z
 	RenderGroup tetrahedronGroup(tetraMaterial);
 
 	// Add triangles.
-	tetrahedronGroup.primitives.push_back(new Triangle(v1, v3, v2, n1));
-	tetrahedronGroup.primitives.push_back(new Triangle(v1, v4, v3, n2));
-	tetrahedronGroup.primitives.push_back(new Triangle(v2, v4, v1, n3));
-	tetrahedronGroup.primitives.push_back(new Triangle(v3, v4, v2, n4));
+	tetrahedronGroup.primitives.push_back(scene.triangles.Add(v1, v3, v2, n1));
+	tetrahedronGroup.primitives.push_back(scene.triangles.Add(v1, v4, v3, n2));
+	tetrahedronGroup.primitives.push_back(scene.triangles.Add(v2, v4, v1, n3));
+	tetrahedronGroup.primitives.push_back(scene.triangles.Add(v3, v4, v2, n4));
 
 	tetrahedronGroup.RecalculateAABB();
 
@@ -311,7 +371,7 @@ void SceneObjectFactory::AddEmissiveSphere(Scene & scene, float x, float y, floa
 
 	// Render group + primitive.
 	RenderGroup sphereGroup(mat);
-	sphereGroup.primitives.push_back(new Sphere(glm::vec3(x, y, z), radius));
+	sphereGroup.primitives.push_back(scene.spheres.Add(glm::vec3(x, y, z), radius));
 	sphereGroup.RecalculateAABB();
 	renderGroups.push_back(sphereGroup);
 }
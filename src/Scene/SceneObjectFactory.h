@@ -1,5 +1,7 @@
 #pragma once
 
+#include <string>
+
 #include "Scene.h"
 
 namespace SceneObjectFactory {
@@ -38,6 +40,35 @@ namespace SceneObjectFactory {
 	void AddTriangle(Scene & scene, glm::vec3 p1, glm::vec3 p2, glm::vec3 p3, glm::vec3 normal,
 					 glm::vec3 surfaceColor, float emissivity = 1.0f);
 
+	/// <summary> 
+	/// Adds a triangle mesh render group to the scene. The mesh is moved into the scene, which owns it from then on.
+	/// </summary>
+	void AddTriangleMesh(Scene & scene, TriangleMesh mesh, glm::vec3 surfaceColor = glm::vec3(1, 1, 1),
+						 float emissivity = 0.0f);
+
+	/// <summary> 
+	/// Loads an OBJ or binary PLY file (see MeshImporter) and adds a triangle mesh render group per material in it,
+	/// placed by the given transform. Faces without a material in the file get the given surface color.
+	/// Returns false if the file couldn't be loaded, in which case nothing is added.
+	/// </summary>
+	bool AddMeshFile(Scene & scene, const std::string & path, const glm::mat4 & transform = glm::mat4(1.0f),
+					 glm::vec3 surfaceColor = glm::vec3(1, 1, 1));
+
+	/// <summary> 
+	/// Moves the render group which was added last (e.g. by AddTetrahedron) to the shared render groups of the scene,
+	/// where it is no longer rendered by itself but can be instanced any number of times by AddInstance.
+	/// Returns the shared render group.
+	/// </summary>
+	const RenderGroup * ShareLastRenderGroup(Scene & scene);
+
+	/// <summary> 
+	/// Adds an instance of a shared render group to the scene, placed by the given transform (from the space of the shared
+	/// render group to world space). The instance uses the material of the shared render group unless another material
+	/// is given, which must be owned by the scene (see Scene::materials). If the instance is emissive, the transform must
+	/// have a uniform scale (see RenderGroup::HasUniformScale).
+	/// </summary>
+	void AddInstance(Scene & scene, const RenderGroup * sharedRenderGroup, const glm::mat4 & transform, Material * material = nullptr);
+
 	/// <summary> Creates a quad and adds it to the scene. </summary>
 	void Add2DQuad(Scene & scene, glm::vec2 corner1, glm::vec2 corner2, float height,
 				   glm::vec3 normal = glm::vec3(0, 0, -1),
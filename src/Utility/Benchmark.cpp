@@ -0,0 +1,106 @@
+#include "Benchmark.h"
+
+#include <random>
+#include <chrono>
+#include <iomanip>
+
+#include "../Scene/Scene.h"
+#include "../Scene/SceneObjectFactory.h"
+
+namespace {
+	/// <summary> Casts rays until all rays are cast or the time is up. Returns million rays per second. </summary>
+	double MeasureRaysPerSecond(const Scene & scene, const std::vector<Ray> & rays, const double MAX_SECONDS, unsigned int & hits) {
+		using clock = std::chrono::high_resolution_clock;
+		const auto start = clock::now();
+		unsigned int renderGroupIndex, primitiveIndex;
+		float distance;
+		unsigned int cast = 0;
+		hits = 0;
+		while (cast < rays.size()) {
+			hits += scene.RayCast(rays[cast], renderGroupIndex, primitiveIndex, distance) ? 1 : 0;
+			++cast;
+			if (cast % 1024 == 0 && std::chrono::duration<double>(clock::now() - start).count() > MAX_SECONDS) {
+				break;
+			}
+		}
+		const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+		return cast / glm::max<double>(seconds, 1e-9) / 1e6;
+	}
+}
+
+void Utility::Benchmark::RunAccelerationStructureBenchmark(std::ostream & out, const std::vector<unsigned int> & objectCounts,
+														   const unsigned int RAY_COUNT, const double MAX_SECONDS) {
+	const AccelerationStructure::Type types[] = {
+		AccelerationStructure::Type::LINEAR, AccelerationStructure::Type::BVH, AccelerationStructure::Type::WIDE_BVH,
+		AccelerationStructure::Type::QUANTIZED_WIDE_BVH_8, AccelerationStructure::Type::QUANTIZED_WIDE_BVH_16,
+		AccelerationStructure::Type::OCTREE
+	};
+	const unsigned int COL_WIDTH = 20;
+
+	for (unsigned int objectCount : objectCounts) {
+		// Create the scene. The random generator is seeded so that every run uses the same scene and rays.
+		std::mt19937 generator(1337);
+		std::uniform_real_distribution<float> randomX(0.5f, 11.5f), randomY(-5.5f, 5.5f), randomZ(-4.5f, 4.5f);
+		std::uniform_real_distribution<float> randomUnit(-1.0f, 1.0f), randomRadius(0.1f, 0.3f);
+
+		Scene scene;
+		SceneObjectFactory::AddRoom(scene, false);
+		SceneObjectFactory::Add2DQuad(scene, glm::vec2(5.0f, -1), glm::vec2(7.0f, 1), 4.99999f);
+		for (unsigned int i = 0; i < objectCount; ++i) {
+			const float x = randomX(generator), y = randomY(generator), z = randomZ(generator);
+			if (i % 2 == 0) {
+				SceneObjectFactory::AddSphere(scene, x, y, z, randomRadius(generator));
+			}
+			else {
+				SceneObjectFactory::AddTetrahedron(scene, x, y, z);
+			}
+		}
+		scene.RecalculateAABB();
+
+		unsigned int primitiveCount = 0;
+		for (const auto & rg : scene.renderGroups) {
+			primitiveCount += rg.GetPrimitiveCount();
+		}
+
+		// Primary rays from the default camera and incoherent rays inside the room.
+		std::vector<Ray> primaryRays(RAY_COUNT), incoherentRays(RAY_COUNT);
+		const glm::vec3 eye(-7, 0, 0);
+		for (unsigned int i = 0; i < RAY_COUNT; ++i) {
+			const glm::vec3 cameraPlanePosition(-5.0f, randomUnit(generator), randomUnit(generator));
+			primaryRays[i] = Ray(eye, glm::normalize(cameraPlanePosition - eye));
+
+			glm::vec3 direction;
+			do {
+				direction = glm::vec3(randomUnit(generator), randomUnit(generator), randomUnit(generator));
+			} while (glm::length(direction) < 0.1f || glm::length(direction) > 1.0f);
+			const glm::vec3 from(randomX(generator), randomY(generator), randomZ(generator));
+			incoherentRays[i] = Ray(from, glm::normalize(direction));
+		}
+
+		out << "-- " << objectCount << " OBJECTS, " << scene.renderGroups.size() << " RENDER GROUPS, " << primitiveCount << " PRIMITIVES --" << std::endl;
+		out << std::setw(COL_WIDTH) << std::left << "Structure:"
+			<< std::setw(COL_WIDTH) << std::left << "Build (s):"
+			<< std::setw(COL_WIDTH) << std::left << "Memory (KB):"
+			<< std::setw(COL_WIDTH) << std::left << "Primary Mrays/s:"
+			<< std::setw(COL_WIDTH) << std::left << "Random Mrays/s:"
+			<< "Hits (primary/random):" << std::endl;
+		for (auto type : types) {
+			const auto buildStart = std::chrono::high_resolution_clock::now();
+			scene.accelerationStructureSettings.type = type;
+			scene.BuildAccelerationStructures();
+			const double buildTime = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+			unsigned int primaryHits, incoherentHits;
+			const double primaryRate = MeasureRaysPerSecond(scene, primaryRays, MAX_SECONDS, primaryHits);
+			const double incoherentRate = MeasureRaysPerSecond(scene, incoherentRays, MAX_SECONDS, incoherentHits);
+
+			out << std::setw(COL_WIDTH) << std::left << AccelerationStructure::GetTypeName(type)
+				<< std::setw(COL_WIDTH) << std::left << buildTime
+				<< std::setw(COL_WIDTH) << std::left << scene.GetAccelerationStructureMemoryUsage() / 1024.0
+				<< std::setw(COL_WIDTH) << std::left << primaryRate
+				<< std::setw(COL_WIDTH) << std::left << incoherentRate
+				<< primaryHits << "/" << incoherentHits << std::endl;
+		}
+		out << std::endl;
+	}
+}
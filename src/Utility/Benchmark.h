@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include <ostream>
+
+namespace Utility {
+	namespace Benchmark {
+		/// <summary>
+		/// Compares the ray casting performance (in million rays per second) of every acceleration structure type.
+		/// The scene is the room from SceneObjectFactory::AddRoom scaled up with random spheres and tetrahedra.
+		/// Both coherent primary rays (from the default camera) and incoherent rays (random origins and directions
+		/// inside the room) are measured.
+		/// </summary>
+		/// <param name='out'> The stream to which the results are written. </param>
+		/// <param name='objectCounts'> The number of random objects added to the room, one scene per count. </param>
+		/// <param name='RAY_COUNT'> The number of rays of each kind. </param>
+		/// <param name='MAX_SECONDS'>
+		/// The maximum time spent casting each kind of ray per structure. Slow structures (i.e. the linear loop)
+		/// stop early, and their rate is measured over the rays cast so far.
+		/// </param>
+		void RunAccelerationStructureBenchmark(std::ostream & out,
+											   const std::vector<unsigned int> & objectCounts = { 0, 100, 1000, 10000 },
+											   const unsigned int RAY_COUNT = 200000, const double MAX_SECONDS = 5.0);
+	}
+}
@@ -0,0 +1,71 @@
+#include "MappedFile.h"
+
+#include <cstdint>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+Utility::MappedFile::MappedFile(const std::string & path) {
+	HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		return;
+	}
+	fileHandle = file;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0 || static_cast<unsigned long long>(fileSize.QuadPart) > SIZE_MAX) {
+		return;
+	}
+	mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (mappingHandle == nullptr) {
+		return;
+	}
+	data = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+	if (data != nullptr) {
+		size = static_cast<size_t>(fileSize.QuadPart);
+	}
+}
+
+Utility::MappedFile::~MappedFile() {
+	if (data != nullptr) {
+		UnmapViewOfFile(data);
+	}
+	if (mappingHandle != nullptr) {
+		CloseHandle(mappingHandle);
+	}
+	if (fileHandle != nullptr) {
+		CloseHandle(fileHandle);
+	}
+}
+#else
+Utility::MappedFile::MappedFile(const std::string & path) {
+	const int file = open(path.c_str(), O_RDONLY);
+	if (file < 0) {
+		return;
+	}
+	struct stat fileStatus;
+	if (fstat(file, &fileStatus) == 0 && fileStatus.st_size > 0) {
+		void * mapping = mmap(nullptr, static_cast<size_t>(fileStatus.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+		if (mapping != MAP_FAILED) {
+			data = static_cast<const char *>(mapping);
+			size = static_cast<size_t>(fileStatus.st_size);
+		}
+	}
+	close(file);
+}
+
+Utility::MappedFile::~MappedFile() {
+	if (data != nullptr) {
+		munmap(const_cast<char *>(data), size);
+	}
+}
+#endif
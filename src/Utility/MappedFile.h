@@ -0,0 +1,36 @@
+#pragma once
+
+#include <string>
+
+namespace Utility {
+	/// <summary>
+	/// A file mapped read-only into memory, so that it can be parsed in place (and in parallel) without being
+	/// copied into buffers first. The file is unmapped when the object is destroyed.
+	/// </summary>
+	class MappedFile {
+	public:
+		/// <summary> Maps the file at the given path. Check IsOpen afterwards. </summary>
+		explicit MappedFile(const std::string & path);
+		~MappedFile();
+
+		MappedFile(const MappedFile &) = delete;
+		MappedFile & operator=(const MappedFile &) = delete;
+
+		/// <summary> Returns true if the file was mapped (empty files are never mapped). </summary>
+		bool IsOpen() const { return data != nullptr; }
+
+		/// <summary> Returns the contents of the file. Note that they are not null terminated. </summary>
+		const char * GetData() const { return data; }
+
+		/// <summary> Returns the size of the file in bytes. </summary>
+		size_t GetSize() const { return size; }
+
+	private:
+		const char * data = nullptr;
+		size_t size = 0;
+#ifdef _WIN32
+		void * fileHandle = nullptr;
+		void * mappingHandle = nullptr;
+#endif
+	};
+}
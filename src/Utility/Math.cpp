@@ -38,10 +38,11 @@ glm::vec3 Utility::Math::NonParallellVector(const glm::vec3 & v) {
 	}
 }
 
-glm::vec3 Utility::Math::RandomHemishpereSampleDirection(const glm::vec3 & n) {
+glm::vec3 Utility::Math::RandomHemishpereSampleDirection(const glm::vec3 & n, Sampler & sampler) {
 	// Samples uniform angles.
-	float incl = (rand() / static_cast<float>(RAND_MAX)) * glm::half_pi<float>();
-	float azim = (rand() / static_cast<float>(RAND_MAX)) * glm::two_pi<float>();
+	const glm::vec2 sample = sampler.Next2D();
+	float incl = sample.x * glm::half_pi<float>();
+	float azim = sample.y * glm::two_pi<float>();
 	glm::vec3 nonParallellVector = Math::NonParallellVector(n);
 	assert(glm::length(glm::cross(nonParallellVector, n)) > FLT_EPSILON);
 	glm::vec3 rotationVector = glm::cross(nonParallellVector, n);
@@ -49,11 +50,12 @@ glm::vec3 Utility::Math::RandomHemishpereSampleDirection(const glm::vec3 & n) {
 	return glm::normalize(rotate(inclVector, azim, n));
 }
 
-glm::vec3 Utility::Math::CosineWeightedHemisphereSampleDirection(const glm::vec3 & n) {
+glm::vec3 Utility::Math::CosineWeightedHemisphereSampleDirection(const glm::vec3 & n, Sampler & sampler) {
 	// See https://pathtracing.wordpress.com/2011/03/03/cosine-weighted-hemisphere/.
 	// Samples cosine weighted positions.
-	float r1 = rand() / static_cast<float>(RAND_MAX);
-	float r2 = rand() / static_cast<float>(RAND_MAX);
+	const glm::vec2 sample = sampler.Next2D();
+	float r1 = sample.x;
+	float r2 = sample.y;
 
 	float theta = acos(sqrt(1.0f - r1));
 	float phi = 2.0f * glm::pi<float>() * r2;
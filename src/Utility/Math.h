@@ -5,6 +5,7 @@
 #include <glm.hpp>
 
 #include "../../includes/glm/gtc/constants.hpp"
+#include "Sampler.h"
 
 namespace Utility {
 	namespace Math {
@@ -47,12 +48,12 @@ namespace Utility {
 		/// Returns a random direction given a normal.
 		/// Uses cosine-weighted hemisphere sampling.
 		/// </summary>
-		glm::vec3 CosineWeightedHemisphereSampleDirection(const glm::vec3 & n);
+		glm::vec3 CosineWeightedHemisphereSampleDirection(const glm::vec3 & n, Sampler & sampler);
 
 		/// <summary>
 		/// Returns a random direction given a normal.
 		/// Uses uniform randomization.
 		/// </summary>
-		glm::vec3 RandomHemishpereSampleDirection(const glm::vec3 & n);
+		glm::vec3 RandomHemishpereSampleDirection(const glm::vec3 & n, Sampler & sampler);
 	}
 }
\ No newline at end of file
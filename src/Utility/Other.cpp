@@ -2,6 +2,22 @@
 
 #include <algorithm>
 #include <numeric>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+bool Utility::IsAVXSupported() {
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 1);
+	const bool osxsave = (info[2] & (1 << 27)) != 0;
+	const bool avx = (info[2] & (1 << 28)) != 0;
+	return osxsave && avx && (_xgetbv(0) & 6) == 6;
+#else
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx") != 0;
+#endif
+}
 
 std::vector<int> Utility::Math::GetSortedIndices(const std::vector<float>& values) {
 	std::vector<int> indices(values.size());
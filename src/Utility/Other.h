@@ -3,6 +3,9 @@
 #include <vector>
 
 namespace Utility {
+	/// <summary> Returns true if both the CPU and the operating system support AVX. </summary>
+	bool IsAVXSupported();
+
 	namespace Math {
 		/// <summary>
 		/// Returns a vector with indices sorted based on the values in the vector /values/.
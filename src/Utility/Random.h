@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+namespace Utility {
+	/// <summary>
+	/// A PCG32 random number generator (see http://www.pcg-random.org). It is a few instructions per number and has
+	/// no shared state, unlike rand() which takes a global lock on some platforms. Every thread uses its own generator
+	/// (see Sampler), and generators with different streams (e.g. one per pixel) are independent, so results don't
+	/// depend on the number of threads or on how work is scheduled between them.
+	/// </summary>
+	class Random {
+	public:
+		/// <summary> Creates a generator from a seed and a stream index. </summary>
+		explicit Random(uint64_t seed = 0, uint64_t stream = 0) : state(0), increment((stream << 1) | 1) {
+			NextUInt();
+			state += seed;
+			NextUInt();
+		}
+
+		/// <summary> Returns a uniformly distributed 32-bit integer. </summary>
+		uint32_t NextUInt() {
+			const uint64_t oldState = state;
+			state = oldState * 6364136223846793005ULL + increment;
+			const uint32_t xorShifted = static_cast<uint32_t>(((oldState >> 18) ^ oldState) >> 27);
+			const uint32_t rotation = static_cast<uint32_t>(oldState >> 59);
+			return (xorShifted >> rotation) | (xorShifted << ((32 - rotation) & 31));
+		}
+
+		/// <summary> Returns a uniformly distributed integer in [0, range). </summary>
+		uint32_t NextUInt(uint32_t range) {
+			// Lemire's multiply-shift, which is slightly biased for huge ranges but avoids a division.
+			return static_cast<uint32_t>((static_cast<uint64_t>(NextUInt()) * range) >> 32);
+		}
+
+		/// <summary> Returns a uniformly distributed float in [0, 1). </summary>
+		float NextFloat() {
+			return (NextUInt() >> 8) * (1.0f / 16777216.0f);
+		}
+
+	private:
+		uint64_t state, increment;
+	};
+}
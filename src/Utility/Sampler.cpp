@@ -0,0 +1,357 @@
+#include "Sampler.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	const unsigned int HALTON_PRIMES[] = {
+		2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113,
+		127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223, 227, 229, 233, 239, 241, 251
+	};
+	const unsigned int HALTON_DIMENSIONS = sizeof(HALTON_PRIMES) / sizeof(HALTON_PRIMES[0]) / 2;
+
+	const unsigned int BLUE_NOISE_SIZE = 64; // Power of two.
+	const unsigned int BLUE_NOISE_SEED = 0x2545F491;
+
+	/// <summary> Integer hash with good avalanche (lowbias32, see https://nullprogram.com/blog/2018/07/31/). </summary>
+	uint32_t Hash(uint32_t x) {
+		x ^= x >> 16;
+		x *= 0x7feb352du;
+		x ^= x >> 15;
+		x *= 0x846ca68bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	uint32_t HashCombine(uint32_t seed, uint32_t value) {
+		return Hash(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+	}
+
+	uint32_t ReverseBits(uint32_t x) {
+		x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+		x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+		x = ((x >> 4) & 0x0F0F0F0Fu) | ((x & 0x0F0F0F0Fu) << 4);
+		x = ((x >> 8) & 0x00FF00FFu) | ((x & 0x00FF00FFu) << 8);
+		return (x >> 16) | (x << 16);
+	}
+
+	/// <summary>
+	/// Owen scrambling: a random permutation of [0, 2^32) in which every bit is flipped depending on the bits above
+	/// it, so that stratification at every power of two is kept. See Burley, "Practical Hash-based Owen Scrambling" (2020).
+	/// </summary>
+	uint32_t OwenScramble(uint32_t x, uint32_t seed) {
+		x = ReverseBits(x);
+		x += seed;
+		x ^= x * 0x6c50b47cu;
+		x ^= x * 0xb82f1e52u;
+		x ^= x * 0xc7afe638u;
+		x ^= x * 0x8d22f6e6u;
+		return ReverseBits(x);
+	}
+
+	/// <summary>
+	/// The second dimension of the Sobol sequence XORs one direction number per set bit of the index. The table holds
+	/// the XOR of the direction numbers for every value of every byte of the index.
+	/// </summary>
+	std::vector<uint32_t> CreateSobolTable() {
+		std::vector<uint32_t> table(4 * 256, 0);
+		uint32_t directions[32];
+		directions[0] = 1u << 31;
+		for (int i = 1; i < 32; ++i) {
+			directions[i] = directions[i - 1] ^ (directions[i - 1] >> 1);
+		}
+		for (int byte = 0; byte < 4; ++byte) {
+			for (int value = 0; value < 256; ++value) {
+				for (int bit = 0; bit < 8; ++bit) {
+					if (value & (1 << bit)) {
+						table[byte * 256 + value] ^= directions[byte * 8 + bit];
+					}
+				}
+			}
+		}
+		return table;
+	}
+	const std::vector<uint32_t> SOBOL_TABLE = CreateSobolTable();
+
+	/// <summary> Returns the first two dimensions of the Sobol sequence, scaled to [0, 2^32). </summary>
+	void Sobol2D(uint32_t index, uint32_t & x, uint32_t & y) {
+		x = ReverseBits(index);
+		y = SOBOL_TABLE[index & 0xFF] ^ SOBOL_TABLE[256 + ((index >> 8) & 0xFF)] ^
+			SOBOL_TABLE[512 + ((index >> 16) & 0xFF)] ^ SOBOL_TABLE[768 + (index >> 24)];
+	}
+
+	/// <summary>
+	/// Returns 2D Sobol points which are shuffled (the sample index is Owen scrambled, which keeps every power of two
+	/// prefix of the sequence well stratified) and Owen scrambled.
+	/// </summary>
+	void ScrambledSobol2D(uint32_t index, uint32_t seed, uint32_t & x, uint32_t & y) {
+		Sobol2D(OwenScramble(index, seed), x, y);
+		x = OwenScramble(x, HashCombine(seed, 1));
+		y = OwenScramble(y, HashCombine(seed, 2));
+	}
+
+	/// <summary>
+	/// Returns a random permutation of [0, length) applied to i, which is a different permutation for every seed.
+	/// See Kensler, "Correlated Multi-Jittered Sampling" (2013).
+	/// </summary>
+	uint32_t Permute(uint32_t i, uint32_t length, uint32_t seed) {
+		uint32_t w = length - 1;
+		w |= w >> 1;
+		w |= w >> 2;
+		w |= w >> 4;
+		w |= w >> 8;
+		w |= w >> 16;
+		do {
+			i ^= seed; i *= 0xe170893du; i ^= seed >> 16; i ^= (i & w) >> 4;
+			i ^= seed >> 8; i *= 0x0929eb3fu; i ^= seed >> 23; i ^= (i & w) >> 1;
+			i *= 1 | seed >> 27; i *= 0x6935fa69u; i ^= (i & w) >> 11; i *= 0x74dcb303u;
+			i ^= (i & w) >> 2; i *= 0x9e501cc3u; i ^= (i & w) >> 2; i *= 0xc860a3dfu;
+			i &= w;
+			i ^= i >> 5;
+		} while (i >= length);
+		return (i + seed) % length;
+	}
+
+	/// <summary>
+	/// Returns the radical inverse of the index in the given base, Owen scrambled (every digit is permuted depending
+	/// on the digits before it), scaled to [0, 2^32).
+	/// </summary>
+	uint32_t ScrambledRadicalInverse(uint32_t base, uint32_t index, uint32_t seed) {
+		const double invBase = 1.0 / base;
+		double invBaseN = 1.0;
+		double result = 0.0;
+		uint64_t prefix = 0, baseN = 1;
+		uint32_t i = 0;
+		for (; index != 0; ++i) {
+			const uint32_t indexDigit = index % base;
+			const uint32_t digit = Permute(indexDigit, base, HashCombine(HashCombine(seed, i), static_cast<uint32_t>(prefix)));
+			prefix += indexDigit * baseN;
+			baseN *= base;
+			index /= base;
+			invBaseN *= invBase;
+			result += digit * invBaseN;
+		}
+
+		// The remaining digits of the index are zeros, whose permuted values only depend on the prefix. Together they
+		// are a uniformly distributed value below the last digit.
+		result += HashCombine(HashCombine(seed, i), static_cast<uint32_t>(prefix)) * (1.0 / 4294967296.0) * invBaseN;
+		return static_cast<uint32_t>(std::min(result * 4294967296.0, 4294967295.0));
+	}
+
+	/// <summary>
+	/// Creates a tileable blue noise mask using the void-and-cluster method (Ulichney, 1993): every position gets a
+	/// rank, and the positions with the lowest ranks are as evenly spread as possible for every threshold. The ranks
+	/// are returned scaled to [0, 2^32).
+	/// </summary>
+	std::vector<uint32_t> CreateBlueNoiseMask() {
+		const int SIZE = BLUE_NOISE_SIZE, MASK = SIZE - 1, COUNT = SIZE * SIZE;
+		const float SIGMA = 1.5f;
+
+		// The energy contributed by a point to every position, on a torus so that the mask tiles.
+		std::vector<float> kernel(COUNT);
+		for (int y = 0; y < SIZE; ++y) {
+			for (int x = 0; x < SIZE; ++x) {
+				const float dx = static_cast<float>(std::min(x, SIZE - x)), dy = static_cast<float>(std::min(y, SIZE - y));
+				kernel[y * SIZE + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * SIGMA * SIGMA));
+			}
+		}
+
+		std::vector<char> points(COUNT, 0);
+		std::vector<float> energy(COUNT, 0.0f);
+		const auto setPoint = [&](int i, bool value) {
+			points[i] = value;
+			const float sign = value ? 1.0f : -1.0f;
+			const int px = i % SIZE, py = i / SIZE;
+			for (int y = 0; y < SIZE; ++y) {
+				for (int x = 0; x < SIZE; ++x) {
+					energy[y * SIZE + x] += sign * kernel[((y - py) & MASK) * SIZE + ((x - px) & MASK)];
+				}
+			}
+		};
+		const auto findTightestCluster = [&]() {
+			int best = -1;
+			for (int i = 0; i < COUNT; ++i) {
+				if (points[i] && (best < 0 || energy[i] > energy[best])) {
+					best = i;
+				}
+			}
+			return best;
+		};
+		const auto findLargestVoid = [&]() {
+			int best = -1;
+			for (int i = 0; i < COUNT; ++i) {
+				if (!points[i] && (best < 0 || energy[i] < energy[best])) {
+					best = i;
+				}
+			}
+			return best;
+		};
+
+		// Start from random points, and move the point in the tightest cluster to the largest void until that doesn't change anything.
+		Utility::Random random(BLUE_NOISE_SEED);
+		const int INITIAL_POINTS = COUNT / 10;
+		for (int placed = 0; placed < INITIAL_POINTS;) {
+			const int i = static_cast<int>(random.NextUInt(COUNT));
+			if (!points[i]) {
+				setPoint(i, true);
+				++placed;
+			}
+		}
+		for (int iteration = 0; iteration < COUNT; ++iteration) {
+			const int cluster = findTightestCluster();
+			setPoint(cluster, false);
+			const int largestVoid = findLargestVoid();
+			setPoint(largestVoid, true);
+			if (largestVoid == cluster) {
+				break;
+			}
+		}
+
+		// Rank the initial points by removing the tightest clusters first, then the rest by filling the largest voids first.
+		// (Ulichney fills the second half by clusters of the inverted pattern, which differs little at this size.)
+		std::vector<int> ranks(COUNT);
+		const std::vector<char> initialPoints = points;
+		const std::vector<float> initialEnergy = energy;
+		for (int rank = INITIAL_POINTS - 1; rank >= 0; --rank) {
+			const int cluster = findTightestCluster();
+			setPoint(cluster, false);
+			ranks[cluster] = rank;
+		}
+		points = initialPoints;
+		energy = initialEnergy;
+		for (int rank = INITIAL_POINTS; rank < COUNT; ++rank) {
+			const int largestVoid = findLargestVoid();
+			setPoint(largestVoid, true);
+			ranks[largestVoid] = rank;
+		}
+
+		std::vector<uint32_t> mask(COUNT);
+		for (int i = 0; i < COUNT; ++i) {
+			mask[i] = static_cast<uint32_t>((ranks[i] + 0.5) / COUNT * 4294967296.0);
+		}
+		return mask;
+	}
+
+	const std::vector<uint32_t> & GetBlueNoiseMask() {
+		static const std::vector<uint32_t> mask = CreateBlueNoiseMask();
+		return mask;
+	}
+
+	float ToFloat(uint32_t x) {
+		return (x >> 8) * (1.0f / 16777216.0f);
+	}
+}
+
+const char * Utility::Sampler::GetTypeName(Type type) {
+	switch (type) {
+	case Type::HALTON:
+		return "Halton";
+	case Type::SOBOL:
+		return "Sobol";
+	case Type::BLUE_NOISE:
+		return "Blue noise";
+	default:
+		return "Random";
+	}
+}
+
+Utility::Sampler::Sampler(Type _type, uint32_t _seed) : type(_type), seed(_seed) {
+	if (type == Type::BLUE_NOISE) {
+		GetBlueNoiseMask(); // Created once, before rendering.
+	}
+}
+
+void Utility::Sampler::StartPixel(unsigned int x, unsigned int y) {
+	pixelX = x;
+	pixelY = y;
+	pixelSeed = HashCombine(HashCombine(Hash(seed), x), y);
+	StartSample(0);
+}
+
+void Utility::Sampler::StartSample(unsigned int index, unsigned int _dimension) {
+	sampleIndex = index;
+	dimension = _dimension;
+
+	// The random numbers only depend on the pixel, the sample and the dimension, like the low discrepancy samples.
+	// Otherwise a new sampler would repeat the samples of the previous one, e.g. in every progressive pass.
+	random = Random(HashCombine(HashCombine(pixelSeed, index), _dimension), (static_cast<uint64_t>(pixelY) << 32) | pixelX);
+}
+
+bool Utility::Sampler::CheckSampleIndices(Type type) {
+	// Every sample gets a new sampler, like the passes of a progressive render.
+	const unsigned int SAMPLES = 4, DIMENSIONS = HALTON_DIMENSIONS + 2;
+	for (unsigned int d = 0; d < DIMENSIONS; ++d) {
+		glm::vec2 samples[SAMPLES];
+		for (unsigned int i = 0; i < SAMPLES; ++i) {
+			Sampler sampler(type);
+			sampler.StartPixel(3, 5);
+			sampler.StartSample(i, d);
+			samples[i] = sampler.Next2D();
+			for (unsigned int j = 0; j < i; ++j) {
+				if (samples[i] == samples[j]) {
+					return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+float Utility::Sampler::Next1D() {
+	if (type == Type::RANDOM) {
+		return random.NextFloat();
+	}
+	uint32_t x, y;
+	Sample(dimension++, x, y);
+	return ToFloat(x);
+}
+
+glm::vec2 Utility::Sampler::Next2D() {
+	if (type == Type::RANDOM) {
+		const float x = random.NextFloat();
+		return glm::vec2(x, random.NextFloat());
+	}
+	uint32_t x, y;
+	Sample(dimension++, x, y);
+	return glm::vec2(ToFloat(x), ToFloat(y));
+}
+
+uint32_t Utility::Sampler::NextUInt(uint32_t range) {
+	return std::min(static_cast<uint32_t>(Next1D() * range), range - 1);
+}
+
+void Utility::Sampler::Sample(unsigned int _dimension, uint32_t & x, uint32_t & y) {
+	switch (type) {
+	case Type::HALTON:
+		if (_dimension < HALTON_DIMENSIONS) {
+			const uint32_t dimensionSeed = HashCombine(pixelSeed, _dimension);
+			x = ScrambledRadicalInverse(HALTON_PRIMES[2 * _dimension], sampleIndex, HashCombine(dimensionSeed, 0));
+			y = ScrambledRadicalInverse(HALTON_PRIMES[2 * _dimension + 1], sampleIndex, HashCombine(dimensionSeed, 1));
+		}
+		else {
+			x = random.NextUInt();
+			y = random.NextUInt();
+		}
+		break;
+	case Type::SOBOL:
+		ScrambledSobol2D(sampleIndex, HashCombine(pixelSeed, _dimension), x, y);
+		break;
+	case Type::BLUE_NOISE: {
+		// The points are the same in every pixel and are offset (modulo 1) by the mask, which is shifted differently
+		// for every dimension and coordinate so that the offsets of the dimensions are uncorrelated.
+		const uint32_t dimensionSeed = HashCombine(seed, _dimension);
+		ScrambledSobol2D(sampleIndex, dimensionSeed, x, y);
+		const std::vector<uint32_t> & mask = GetBlueNoiseMask();
+		const uint32_t shiftX = HashCombine(dimensionSeed, 3), shiftY = HashCombine(dimensionSeed, 4);
+		const uint32_t MASK = BLUE_NOISE_SIZE - 1;
+		x += mask[((pixelY + (shiftX >> 16)) & MASK) * BLUE_NOISE_SIZE + ((pixelX + shiftX) & MASK)];
+		y += mask[((pixelY + (shiftY >> 16)) & MASK) * BLUE_NOISE_SIZE + ((pixelX + shiftY) & MASK)];
+		break;
+	}
+	default:
+		x = random.NextUInt();
+		y = random.NextUInt();
+		break;
+	}
+}
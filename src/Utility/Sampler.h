@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+#include <glm.hpp>
+
+#include "Random.h"
+
+namespace Utility {
+	/// <summary>
+	/// Generates the sample values (pixel jitter, light surface positions, BSDF directions) of the samples of a pixel.
+	/// Every call to Next1D or Next2D uses the next dimension of the current sample, so a path consumes the same
+	/// dimension for the same decision in every sample. The low discrepancy types cover the dimensions of all the
+	/// samples of a pixel far more evenly than independent random numbers, which lowers the noise at equal sample counts.
+	/// Sample counts which are powers of two work best for SOBOL and BLUE_NOISE.
+	/// </summary>
+	class Sampler {
+	public:
+		/// <summary> The available sequences. </summary>
+		enum class Type {
+			/// <summary> Independent random numbers (PCG, one stream per pixel). </summary>
+			RANDOM,
+			/// <summary> The Halton sequence, Owen scrambled per pixel and dimension. </summary>
+			HALTON,
+			/// <summary> 2D Sobol points, Owen scrambled and shuffled per pixel and dimension. </summary>
+			SOBOL,
+			/// <summary>
+			/// The same Owen scrambled Sobol points in every pixel, offset by a blue noise mask. The error of
+			/// neighbouring pixels is negatively correlated, so the remaining noise is high frequency.
+			/// </summary>
+			BLUE_NOISE
+		};
+
+		/// <summary> The number of dimensions used for the pixel position, before the renderer's dimensions. </summary>
+		static const unsigned int CAMERA_DIMENSIONS = 1;
+
+		/// <summary> Returns a human readable name of a sampler type. </summary>
+		static const char * GetTypeName(Type type);
+
+		/// <summary>
+		/// Returns true if the samples with different indices of a pixel differ in every dimension that a path uses,
+		/// i.e. if adding samples to a pixel adds information. Checked by the camera in debug builds.
+		/// </summary>
+		static bool CheckSampleIndices(Type type);
+
+		/// <summary> Creates a sampler. Samplers with the same type and seed generate the same samples. </summary>
+		explicit Sampler(Type type = Type::SOBOL, uint32_t seed = 0);
+
+		/// <summary> Starts generating the samples of the pixel (x, y). </summary>
+		void StartPixel(unsigned int x, unsigned int y);
+
+		/// <summary> Starts generating a sample of the current pixel at the given dimension. </summary>
+		void StartSample(unsigned int index, unsigned int dimension = 0);
+
+		/// <summary> Returns the next dimension of the current sample, in [0, 1). </summary>
+		float Next1D();
+
+		/// <summary> Returns the next (2D) dimension of the current sample, in [0, 1)^2. </summary>
+		glm::vec2 Next2D();
+
+		/// <summary> Returns the next dimension of the current sample as an integer in [0, range). </summary>
+		uint32_t NextUInt(uint32_t range);
+
+	private:
+		Type type;
+		uint32_t seed;
+
+		/// <summary> Hash of the seed and the current pixel. </summary>
+		uint32_t pixelSeed = 0;
+		unsigned int pixelX = 0, pixelY = 0;
+		unsigned int sampleIndex = 0, dimension = 0;
+
+		/// <summary>
+		/// Used by RANDOM, and by HALTON for dimensions beyond its prime bases. Seeded by StartSample from the pixel, the
+		/// sample index and the dimension.
+		/// </summary>
+		Random random;
+
+		/// <summary> Returns both coordinates of the given dimension of the current sample, scaled to [0, 2^32). </summary>
+		void Sample(unsigned int dimension, uint32_t & x, uint32_t & y);
+	};
+}